@@ -37,6 +37,7 @@ namespace Plugin {
         _service = service;
         _skipURL = _service->WebPrefix().length();
         _config.FromString(_service->ConfigLine());
+        _updates.Interval(_config.UpdateInterval.Value());
         const char* driverMessage = ::construct_bluetooth_driver(_service->ConfigLine().c_str());
 
         // First see if we can bring up the Driver....
@@ -167,6 +168,7 @@ namespace Plugin {
 
         // We bring the interface up, so we should bring it down as well..
         _application.Close();
+        _updates.Revoke();
         ::destruct_bluetooth_driver();
     }
 
@@ -527,23 +529,48 @@ namespace Plugin {
             }
 
             ASSERT(impl != nullptr);
-            _devices.push_back(impl);
+            Added(impl);
         }
 
         _adminLock.Unlock();
 
         return (impl);
     }
+    void BluetoothControl::Added(DeviceImpl* device)
+    {
+        _devices.push_back(device);
+        _index.emplace(Key(device->Locator(), device->LowEnergy()), device);
+    }
+    void BluetoothControl::Changed(DeviceImpl* device)
+    {
+        _updates.Add(device);
+    }
+    /* static */ uint64_t BluetoothControl::Key(const Bluetooth::Address& address, const bool lowEnergy)
+    {
+        const uint8_t* data = address.Data()->b;
+        uint64_t result = (lowEnergy == true ? (1ULL << 48) : 0);
+
+        for (uint8_t index = 0; index < 6; index++) {
+            result |= (static_cast<uint64_t>(data[index]) << (index * 8));
+        }
+
+        return (result);
+    }
 
     void BluetoothControl::RemoveDevices(std::function<bool(DeviceImpl*)> filter)
     {
         _adminLock.Lock();
 
-        for (std::list<DeviceImpl*>::iterator index = _devices.begin(), end = _devices.end(); index != end; ++index) {
+        std::list<DeviceImpl*>::iterator index = _devices.begin();
+
+        while (index != _devices.end()) {
             // call the function passed into findMatchingAddresses and see if it matches
             if (filter(*index) == true) {
+                _index.erase(Key((*index)->Locator(), (*index)->LowEnergy()));
                 (*index)->Release();
                 index = _devices.erase(index);
+            } else {
+                index++;
             }
         }
 
@@ -566,34 +593,46 @@ namespace Plugin {
     }
     BluetoothControl::DeviceImpl* BluetoothControl::Find(const Bluetooth::Address& search) const
     {
-        std::list<DeviceImpl*>::const_iterator index = _devices.begin();
+        _adminLock.Lock();
 
-        while ((index != _devices.end()) && ((*index)->operator==(search) == false)) {
-            index++;
+        // A classic device takes precedence over a low energy one with the same address.
+        DeviceImpl* result = Find(search, false);
+
+        if (result == nullptr) {
+            result = Find(search, true);
         }
 
-        return (index != _devices.end() ? (*index) : nullptr);
+        _adminLock.Unlock();
+
+        return (result);
     }
     BluetoothControl::DeviceImpl* BluetoothControl::Find(const Bluetooth::Address& search, bool lowEnergy) const
     {
-        std::list<DeviceImpl*>::const_iterator index = _devices.begin();
+        _adminLock.Lock();
 
-        while ((index != _devices.end()) && ((*index)->operator==(std::make_pair(search, lowEnergy)) == false)) {
-            index++;
-        }
+        std::unordered_map<uint64_t, DeviceImpl*>::const_iterator index(_index.find(Key(search, lowEnergy)));
+        DeviceImpl* result = (index != _index.end() ? index->second : nullptr);
 
-        return (index != _devices.end() ? (*index) : nullptr);
+        _adminLock.Unlock();
+
+        return (result);
     }
     template<typename DEVICE=BluetoothControl::DeviceImpl>
     DEVICE* BluetoothControl::Find(const uint16_t handle) const
     {
+        _adminLock.Lock();
+
         std::list<DeviceImpl*>::const_iterator index = _devices.begin();
 
         while ((index != _devices.end()) && ((*index)->ConnectionId() != handle)) {
             index++;
         }
 
-        return (index != _devices.end() ? (*index) : nullptr);
+        DEVICE* result = (index != _devices.end() ? (*index) : nullptr);
+
+        _adminLock.Unlock();
+
+        return (result);
     }
 
     uint32_t BluetoothControl::LoadDevices(const string& devicePath, Bluetooth::ManagementSocket& administrator)
@@ -695,7 +734,7 @@ namespace Plugin {
 
                         if (device != nullptr) {
 
-                            _devices.push_back(device);
+                            Added(device);
 
                             result = Core::ERROR_NONE;
                         }
@@ -768,6 +807,52 @@ namespace Plugin {
         return (result);
     }
 
+    void BluetoothControl::UpdateBatch::Add(DeviceImpl* device)
+    {
+        _lock.Lock();
+
+        if (_pending.insert(device).second == true) {
+            device->AddRef();
+
+            // The first change of a batch starts the clock, the ones that follow ride along.
+            if (_pending.size() == 1) {
+                if (_interval == 0) {
+                    _job.Submit();
+                } else {
+                    _job.Reschedule(Core::Time::Now().Add(_interval));
+                }
+            }
+        }
+
+        _lock.Unlock();
+    }
+    void BluetoothControl::UpdateBatch::Revoke()
+    {
+        _job.Revoke();
+
+        _lock.Lock();
+
+        for (DeviceImpl* device : _pending) {
+            device->Release();
+        }
+        _pending.clear();
+
+        _lock.Unlock();
+    }
+    void BluetoothControl::UpdateBatch::Dispatch()
+    {
+        std::unordered_set<DeviceImpl*> batch;
+
+        _lock.Lock();
+        batch.swap(_pending);
+        _lock.Unlock();
+
+        for (DeviceImpl* device : batch) {
+            device->NotifyUpdated();
+            device->Release();
+        }
+    }
+
 } // namespace Plugin
 
 }
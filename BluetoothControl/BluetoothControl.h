@@ -25,6 +25,9 @@
 
 #include "Tracing.h"
 
+#include <unordered_map>
+#include <unordered_set>
+
 namespace WPEFramework {
 
 namespace Plugin {
@@ -104,6 +107,131 @@ class BluetoothControl : public PluginHost::IPlugin
             return ((buffer[2] << 16) | (buffer[1] << 8) | (buffer[0]));
         }
 
+        class DeviceImpl;
+
+        // Devices keep repeating the same advertisement (often several times a second), there is no
+        // need to process a report again if nothing changed since a moment ago. A report is a
+        // duplicate if the same device sent the same payload, as the same kind of report, within the
+        // window.
+        class ReportFilter {
+        private:
+            static constexpr uint16_t PruneInterval = 1024; // In reports
+
+            struct Report {
+                uint64_t Time; // In milliseconds
+                uint32_t Hash;
+            };
+
+        public:
+            ReportFilter(const ReportFilter&) = delete;
+            ReportFilter& operator=(const ReportFilter&) = delete;
+
+            ReportFilter()
+                : _window(0)
+                , _reports()
+                , _count(0)
+            {
+            }
+            ~ReportFilter() = default;
+
+        public:
+            inline void Window(const uint16_t window)
+            {
+                _window = window;
+                _reports.clear();
+            }
+            bool Duplicate(const le_advertising_info& info)
+            {
+                bool result = false;
+
+                if (_window != 0) {
+                    const uint64_t now = (Core::Time::Now().Ticks() / Core::Time::TicksPerMillisecond);
+                    uint64_t key = (static_cast<uint64_t>(info.evt_type) << 48);
+                    uint32_t hash = 2166136261; // FNV-1a
+
+                    for (uint8_t index = 0; index < sizeof(info.bdaddr.b); index++) {
+                        key |= (static_cast<uint64_t>(info.bdaddr.b[index]) << (index * 8));
+                    }
+                    for (uint8_t index = 0; index < info.length; index++) {
+                        hash = (hash ^ info.data[index]) * 16777619;
+                    }
+
+                    Report& entry(_reports[key]);
+
+                    result = ((entry.Hash == hash) && ((now - entry.Time) < _window));
+
+                    if (result == false) {
+                        entry.Time = now;
+                        entry.Hash = hash;
+                    }
+
+                    if (++_count == PruneInterval) {
+                        _count = 0;
+                        Prune(now);
+                    }
+                }
+
+                return (result);
+            }
+
+        private:
+            void Prune(const uint64_t now)
+            {
+                std::unordered_map<uint64_t, Report>::iterator index(_reports.begin());
+
+                while (index != _reports.end()) {
+                    if ((now - index->second.Time) >= _window) {
+                        index = _reports.erase(index);
+                    } else {
+                        index++;
+                    }
+                }
+            }
+
+        private:
+            uint16_t _window; // In milliseconds
+            std::unordered_map<uint64_t, Report> _reports;
+            uint16_t _count;
+        }; // class ReportFilter
+
+        // Collects the devices that changed and tells their callbacks in one go, once per interval,
+        // instead of a job per change.
+        class UpdateBatch {
+        public:
+            UpdateBatch(const UpdateBatch&) = delete;
+            UpdateBatch& operator=(const UpdateBatch&) = delete;
+
+            UpdateBatch()
+                : _lock()
+                , _interval(0)
+                , _pending()
+                , _job(*this)
+            {
+            }
+            ~UpdateBatch()
+            {
+                Revoke();
+            }
+
+        public:
+            inline void Interval(const uint16_t interval)
+            {
+                _interval = interval;
+            }
+            void Add(DeviceImpl* device);
+            void Revoke();
+
+        private:
+            friend Core::ThreadPool::JobType<UpdateBatch&>;
+            void Dispatch();
+
+        private:
+            Core::CriticalSection _lock;
+            uint16_t _interval; // In milliseconds
+            std::unordered_set<DeviceImpl*> _pending;
+            Core::WorkerPool::JobType<UpdateBatch&> _job;
+        }; // class UpdateBatch
+
         class ControlSocket : public Bluetooth::HCISocket {
         private:
             class ManagementSocket : public Bluetooth::ManagementSocket {
@@ -265,6 +393,7 @@ class BluetoothControl : public PluginHost::IPlugin
                 : Bluetooth::HCISocket()
                 , _parent(nullptr)
                 , _administrator(*this)
+                , _reports()
             {
             }
             ~ControlSocket() = default;
@@ -317,6 +446,7 @@ class BluetoothControl : public PluginHost::IPlugin
             {
                 ASSERT (IsOpen() == false);
                 _parent = &parent;
+                _reports.Window(parent._config.DuplicateWindow.Value());
                 Bluetooth::HCISocket::LocalNode(Core::NodeId(_administrator.DeviceId(), HCI_CHANNEL_RAW));
                 return (Bluetooth::HCISocket::Open(Core::infinite));
             }
@@ -411,13 +541,14 @@ class BluetoothControl : public PluginHost::IPlugin
             {
                 BT_TRACE(ControlFlow, info);
                 if ((Application() != nullptr) && (info.bdaddr_type == 0 /* public */)) {
-                    Bluetooth::EIR eir(info.data, info.length);
                     DeviceImpl* device = nullptr;
 
                     const uint8_t SCAN_RESPONSE = 4;
                     const uint8_t UNDIRECTED_CONNECTABLE_ADVERTISMENT = 0;
 
-                    if ((info.evt_type == SCAN_RESPONSE) || (info.evt_type == UNDIRECTED_CONNECTABLE_ADVERTISMENT)) {
+                    if (((info.evt_type == SCAN_RESPONSE) || (info.evt_type == UNDIRECTED_CONNECTABLE_ADVERTISMENT)) && (_reports.Duplicate(info) == false)) {
+                        Bluetooth::EIR eir(info.data, info.length);
+
                         device = Application()->Find(Bluetooth::Address(info.bdaddr));
 
                         if (device == nullptr) {
@@ -425,8 +556,8 @@ class BluetoothControl : public PluginHost::IPlugin
                         }
 
                         if (device != nullptr) {
-                            if ((device->Update(eir) == false) && (info.evt_type == UNDIRECTED_CONNECTABLE_ADVERTISMENT)) {
-                                device->UpdateListener();
+                            if ((device->Update(eir, false) == true) || (info.evt_type == UNDIRECTED_CONNECTABLE_ADVERTISMENT)) {
+                                Application()->Changed(device);
                             }
                         }
                     }
@@ -671,6 +802,7 @@ class BluetoothControl : public PluginHost::IPlugin
             BluetoothControl* _parent;
             DecoupledJob _scanJob;
             ManagementSocket _administrator;
+            ReportFilter _reports; // Only used on the socket thread
         }; // class ControlSocket
 
         class Config : public Core::JSON::Container {
@@ -684,12 +816,16 @@ class BluetoothControl : public PluginHost::IPlugin
                 , Class(0)
                 , AutoPasskeyConfirm(false)
                 , PersistMAC(false)
+                , DuplicateWindow(1000)
+                , UpdateInterval(250)
             {
                 Add(_T("interface"), &Interface);
                 Add(_T("name"), &Name);
                 Add(_T("class"), &Class);
                 Add(_T("autopasskeyconfirm"), &AutoPasskeyConfirm);
                 Add(_T("persistmac"), &PersistMAC);
+                Add(_T("duplicatewindow"), &DuplicateWindow);
+                Add(_T("updateinterval"), &UpdateInterval);
             }
             ~Config()
             {
@@ -701,6 +837,8 @@ class BluetoothControl : public PluginHost::IPlugin
             Core::JSON::HexUInt32 Class;
             Core::JSON::Boolean AutoPasskeyConfirm;
             Core::JSON::Boolean PersistMAC;
+            Core::JSON::DecUInt16 DuplicateWindow; // In milliseconds, 0 disables the filtering
+            Core::JSON::DecUInt16 UpdateInterval; // In milliseconds, 0 reports every change right away
         }; // class Config
 
         class Data : public Core::JSON::Container {
@@ -1457,7 +1595,7 @@ class BluetoothControl : public PluginHost::IPlugin
 
                 return (updated);
             }
-            bool Update(const Bluetooth::EIR& eir)
+            bool Update(const Bluetooth::EIR& eir, bool notifyListener = true)
             {
                 bool updated = false;
 
@@ -1480,12 +1618,19 @@ class BluetoothControl : public PluginHost::IPlugin
 
                 _state.Unlock();
 
-                if (updated == true) {
+                if ((updated == true) && (notifyListener == true)) {
                     UpdateListener();
                 }
 
                 return (updated);
             }
+            // Tell the callback right away, for batched updates that are already decoupled.
+            void NotifyUpdated()
+            {
+                Callback<IBluetooth::IDevice::ICallback>(Callback(), [](IBluetooth::IDevice::ICallback* cb) {
+                    cb->Updated();
+                });
+            }
             void Features(const uint8_t length, const uint8_t feature[])
             {
                 bool updated = false;
@@ -2086,7 +2231,9 @@ class BluetoothControl : public PluginHost::IPlugin
             , _btInterface(0)
             , _btAddress()
             , _devices()
+            , _index()
             , _observers()
+            , _updates()
         {
             RegisterAll();
         }
@@ -2164,6 +2311,9 @@ class BluetoothControl : public PluginHost::IPlugin
         DEVICE* Find(const Bluetooth::Address& address) const;
         void RemoveDevices(std::function<bool(DeviceImpl*)> filter);
         DeviceImpl* Discovered(const bool lowEnergy, const Bluetooth::Address& address);
+        void Added(DeviceImpl* device);
+        void Changed(DeviceImpl* device);
+        static uint64_t Key(const Bluetooth::Address& address, const bool lowEnergy);
         void Notification(const uint8_t subEvent, const uint16_t length, const uint8_t* dataFrame);
         void Capabilities(const Bluetooth::Address& device, const uint8_t capability, const uint8_t authentication, const uint8_t oob_data);
         void LoadController(const string& pathName, Data& data) const;
@@ -2211,13 +2361,15 @@ class BluetoothControl : public PluginHost::IPlugin
 
     private:
         uint8_t _skipURL;
-        Core::CriticalSection _adminLock;
+        mutable Core::CriticalSection _adminLock;
         PluginHost::IShell* _service;
         std::list<uint16_t> _adapters;
         uint16_t _btInterface;
         Bluetooth::Address _btAddress;
         std::list<DeviceImpl*> _devices;
+        std::unordered_map<uint64_t, DeviceImpl*> _index; // On address and type (Key)
         std::list<IBluetooth::INotification*> _observers;
+        UpdateBatch _updates;
         Config _config;
         ControlSocket _application;
         string _persistentStoragePath;
@@ -140,36 +140,18 @@ namespace Plugin {
                 GATTRemote& _parent;
             };
 
+            // Notifications are copied once, into a fixed set of slots, and handed to Message from there.
+            // Nothing is allocated per notification, which matters for the voice data that arrives at
+            // a high rate. If the slots run out, notifications spill over into a list until the worker
+            // catches up, so no notification (key presses in particular) is ever dropped.
             class Decoupling : public Core::Thread {
             private:
-                class Slot {
-                public:
-                    Slot() = delete;
-                    Slot& operator= (const Slot&) = delete;
-                    Slot(const uint16_t handle, const uint8_t length, const uint8_t data[])
-                        : _handle(handle)
-                        , _data(reinterpret_cast<const char*>(data), length) {
-                    }
-                    Slot(const Slot& copy)
-                        : _handle(copy._handle)
-                        , _data(copy._data) {
-                    }
-                    ~Slot() {
-                    }
-                public:
-                    uint16_t Handle() const {
-                        return (_handle);
-                    }
-                    uint8_t Length() const {
-                        return (static_cast<uint8_t>(_data.length()));
-                    }
-                    const uint8_t* Data() const {
-                        return (reinterpret_cast<const uint8_t*>(_data.c_str()));
-                    }
+                static constexpr uint32_t Slots = 64; // Power of 2, the indexes wrap around
 
-                private:
-                    uint16_t _handle;
-                    std::string _data;
+                struct Slot {
+                    uint16_t Handle;
+                    uint8_t Length;
+                    uint8_t Data[255];
                 };
 
             public:
@@ -178,7 +160,10 @@ namespace Plugin {
                 Decoupling(GATTRemote* parent)
                     : _parent(*parent)
                     , _adminLock()
-                    , _queue()
+                    , _slots()
+                    , _head(0)
+                    , _tail(0)
+                    , _overflow()
                 {
                     ASSERT(parent != nullptr);
                 }
@@ -192,7 +177,27 @@ namespace Plugin {
                     ASSERT (length > 0);
 
                     _adminLock.Lock();
-                    _queue.emplace_back(Slot(handle, length, buffer));
+
+                    // Once spilled over, keep appending to the list until it is drained to preserve the order.
+                    if ((_overflow.empty() == true) && ((_head - _tail) < Slots)) {
+                        Slot& slot(_slots[_head % Slots]);
+                        slot.Handle = handle;
+                        slot.Length = length;
+                        ::memcpy(slot.Data, buffer, length);
+                        _head++;
+                    }
+                    else {
+                        if (_overflow.empty() == true) {
+                            TRACE(Trace::Warning, (_T("Notification queue is full, spilling over notifications, starting with handle 0x%04X"), handle));
+                        }
+
+                        _overflow.emplace_back();
+                        Slot& slot(_overflow.back());
+                        slot.Handle = handle;
+                        slot.Length = length;
+                        ::memcpy(slot.Data, buffer, length);
+                    }
+
                     _adminLock.Unlock();
 
                     Run();
@@ -201,22 +206,48 @@ namespace Plugin {
                 {
                     Block();
 
-                    while (_queue.size() > 0) {
+                    _adminLock.Lock();
+
+                    while ((_tail != _head) || (_overflow.empty() == false)) {
+                        if (_tail != _head) {
+                            // The slot is not reused before _tail moves on, so it can be handled in place.
+                            const Slot& slot(_slots[_tail % Slots]);
+
+                            _adminLock.Unlock();
+                            _parent.Message(slot.Handle, slot.Length, slot.Data);
+                            _adminLock.Lock();
+
+                            _tail++;
+                        }
+                        else {
+                            // The slots are drained, so whatever spilled over is next in line. Submit only
+                            // appends, so the front entry stays put while it is being handled.
+                            const Slot& slot(_overflow.front());
 
-                        _adminLock.Lock();
-                        Slot entry (_queue.front());
-                        _queue.pop_front();
-                        _adminLock.Unlock();
-                        _parent.Message(entry.Handle(), entry.Length(), entry.Data());
+                            _adminLock.Unlock();
+                            _parent.Message(slot.Handle, slot.Length, slot.Data);
+                            _adminLock.Lock();
+
+                            _overflow.pop_front();
+
+                            if (_overflow.empty() == true) {
+                                TRACE(Trace::Information, (_T("Notification queue caught up")));
+                            }
+                        }
                     }
 
+                    _adminLock.Unlock();
+
                     return (Core::infinite);
                 }
 
             private:
                 GATTRemote& _parent;
                 Core::CriticalSection _adminLock;
-                std::list<Slot> _queue;
+                Slot _slots[Slots];
+                uint32_t _head;
+                uint32_t _tail;
+                std::list<Slot> _overflow;
             };
 
             class AudioProfile : public Exchange::IVoiceProducer::IProfile {
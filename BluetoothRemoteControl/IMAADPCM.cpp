@@ -0,0 +1,135 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "IMAADPCM.h"
+
+namespace WPEFramework {
+
+namespace Decoders {
+
+namespace {
+
+    class Tables {
+    public:
+        Tables(const Tables&) = delete;
+        Tables& operator=(const Tables&) = delete;
+
+        Tables()
+        {
+            static const int8_t IndexLUT[] = {
+                -1, -1, -1, -1, 2, 4, 6, 8,
+                -1, -1, -1, -1, 2, 4, 6, 8
+            };
+
+            static const uint16_t StepSizeLUT[] = {
+                7,     8,     9,     10,    11,    12,    13,    14,
+                16,    17,    19,    21,    23,    25,    28,    31,
+                34,    37,    41,    45,    50,    55,    60,    66,
+                73,    80,    88,    97,    107,   118,   130,   143,
+                157,   173,   190,   209,   230,   253,   279,   307,
+                337,   371,   408,   449,   494,   544,   598,   658,
+                724,   796,   876,   963,   1060,  1166,  1282,  1411,
+                1552,  1707,  1878,  2066,  2272,  2499,  2749,  3024,
+                3327,  3660,  4026,  4428,  4871,  5358,  5894,  6484,
+                7132,  7845,  8630,  9493,  10442, 11487, 12635, 13899,
+                15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
+                32767
+            };
+
+            static_assert((sizeof(StepSizeLUT) / sizeof(StepSizeLUT[0])) == Steps, "Step size table does not match");
+
+            for (uint8_t index = 0; index < Steps; index++) {
+                const int32_t step = StepSizeLUT[index];
+
+                for (uint8_t nibble = 0; nibble < 16; nibble++) {
+                    int32_t difference = (step >> 3);
+
+                    if ((nibble & 4) != 0) {
+                        difference += step;
+                    }
+                    if ((nibble & 2) != 0) {
+                        difference += (step >> 1);
+                    }
+                    if ((nibble & 1) != 0) {
+                        difference += (step >> 2);
+                    }
+
+                    const int16_t next = static_cast<int16_t>(index) + IndexLUT[nibble];
+
+                    Difference[index][nibble] = ((nibble & 8) != 0 ? -difference : difference);
+                    Next[index][nibble] = static_cast<uint8_t>(next < 0 ? 0 : (next >= Steps ? (Steps - 1) : next));
+                }
+            }
+        }
+
+    public:
+        static constexpr uint8_t Steps = 89;
+
+        int32_t Difference[Steps][16];
+        uint8_t Next[Steps][16];
+    };
+
+    static const Tables _tables;
+
+    inline int16_t Clamp(const int32_t value)
+    {
+        // Symmetrical, -32768 is never produced.
+        return (static_cast<int16_t>(value < -32767 ? -32767 : (value > 32767 ? 32767 : value)));
+    }
+
+}
+
+    uint16_t IMAADPCM::Decode(const uint16_t lengthIn, const uint8_t dataIn[], const uint16_t lengthOut, uint8_t dataOut[])
+    {
+        int16_t* output = reinterpret_cast<int16_t*>(dataOut);
+        const uint16_t samples = std::min(static_cast<uint32_t>(lengthOut / sizeof(int16_t)), static_cast<uint32_t>(lengthIn) * 2);
+        int32_t predicted = _predicted;
+        uint8_t stepIndex = _stepIndex;
+        uint16_t index = 0;
+
+        // Two samples per byte, the tail of a byte that does not fit completely is decoded separately.
+        for (; (index + 1) < samples; index += 2) {
+            const uint8_t low = (dataIn[index >> 1] & 0x0F);
+            const uint8_t high = (dataIn[index >> 1] >> 4);
+
+            predicted = Clamp(predicted + _tables.Difference[stepIndex][low]);
+            stepIndex = _tables.Next[stepIndex][low];
+            output[index] = static_cast<int16_t>(predicted);
+
+            predicted = Clamp(predicted + _tables.Difference[stepIndex][high]);
+            stepIndex = _tables.Next[stepIndex][high];
+            output[index + 1] = static_cast<int16_t>(predicted);
+        }
+
+        if (index < samples) {
+            const uint8_t low = (dataIn[index >> 1] & 0x0F);
+
+            predicted = Clamp(predicted + _tables.Difference[stepIndex][low]);
+            stepIndex = _tables.Next[stepIndex][low];
+            output[index] = static_cast<int16_t>(predicted);
+            index++;
+        }
+
+        _predicted = static_cast<int16_t>(predicted);
+        _stepIndex = stepIndex;
+
+        return (static_cast<uint16_t>(index * sizeof(int16_t)));
+    }
+
+} } // namespace WPEFramework::Decoders
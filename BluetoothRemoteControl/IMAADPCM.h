@@ -0,0 +1,71 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "Module.h"
+
+namespace WPEFramework {
+
+namespace Decoders {
+
+    // IMA ADPCM to 16 bits PCM, the low nibble of a byte holds the first sample. The step size and
+    // index adjustment of every (step index, nibble) pair are looked up in one go, leaving a single
+    // add and clamp per sample. A sample depends on the previous one, so there is nothing to gain
+    // from processing several samples side by side.
+    class IMAADPCM {
+    public:
+        IMAADPCM(const IMAADPCM&) = delete;
+        IMAADPCM& operator=(const IMAADPCM&) = delete;
+
+        IMAADPCM()
+            : _predicted(0)
+            , _stepIndex(0)
+        {
+        }
+        ~IMAADPCM()
+        {
+        }
+
+    public:
+        inline void Reset(const int16_t predicted, const uint8_t stepIndex)
+        {
+            _predicted = predicted;
+            _stepIndex = std::min(stepIndex, static_cast<uint8_t>(MaxStepIndex));
+        }
+        inline int16_t Predicted() const
+        {
+            return (_predicted);
+        }
+        inline uint8_t StepIndex() const
+        {
+            return (_stepIndex);
+        }
+
+        // Decodes as many samples as fit in dataOut, returns the number of bytes written.
+        uint16_t Decode(const uint16_t lengthIn, const uint8_t dataIn[], const uint16_t lengthOut, uint8_t dataOut[]);
+
+    private:
+        static constexpr uint8_t MaxStepIndex = 88;
+
+        int16_t _predicted;
+        uint8_t _stepIndex;
+    };
+
+} } // namespace WPEFramework::Decoders
@@ -37,7 +37,9 @@ public:
     Recorder& operator= (const Recorder&) = delete;
 
     Recorder()
-        : _file() {
+        : _file()
+        , _fileSize(0)
+        , _filled(0) {
     }
     ~Recorder() {
     }
@@ -71,12 +73,14 @@ public:
             _file.Write(reinterpret_cast<const uint8_t*>(_T("data")), 4);
             _file.Write(reinterpret_cast<const uint8_t*>(_T("    ")), 4);
             _fileSize = 0;
+            _filled = 0;
             result = Core::ERROR_NONE;
         }
         return (result);
     }
     void Close() {
         if (_file.IsOpen() == true) {
+            Flush();
             _file.Position(false, 4);
             Store<uint32_t>(_fileSize + 36);
             _file.Position(false, 40);
@@ -84,13 +88,30 @@ public:
             _file.Close();
         }
     }
+    // Frames are small and frequent, collect them and write them to the file in larger blocks.
     void Write (const uint16_t length, const uint8_t data[]) {
 
-        _file.Write(data, length);
+        if ((_filled + length) > sizeof(_buffer)) {
+            Flush();
+        }
+
+        if (length >= sizeof(_buffer)) {
+            _file.Write(data, length);
+        }
+        else {
+            ::memcpy(&(_buffer[_filled]), data, length);
+            _filled += length;
+        }
         _fileSize += length;
     }
 
 private:
+    void Flush() {
+        if (_filled > 0) {
+            _file.Write(_buffer, _filled);
+            _filled = 0;
+        }
+    }
     template<typename TYPE>
     void Store(const TYPE value) {
         TYPE store = value;
@@ -104,6 +125,8 @@ private:
 private:
     Core::File _file;
     uint32_t _fileSize;
+    uint16_t _filled;
+    uint8_t _buffer[4096];
 };
 
 } } // namespace WPEFramework::WAV
@@ -34,6 +34,12 @@ namespace Plugin {
     DHCPServer::DHCPServer()
         : _skipURL(0)
         , _servers()
+        , _persistentPath()
+        , _adminLock()
+        , _journals()
+        , _journalSize(0)
+        , _scheduled(false)
+        , _job(*this)
     {
         RegisterAll();
     }
@@ -58,6 +64,7 @@ namespace Plugin {
         Core::JSON::ArrayType<Config::Server>::Iterator index(config.Servers.Elements());
 
         _persistentPath = service->PersistentPath();
+        _journalSize = config.JournalSize.Value() * 1024;
 
         Core::Directory directory(_persistentPath.c_str());
         if (directory.CreatePath() == false) {
@@ -97,6 +104,14 @@ namespace Plugin {
             index++;
         }
 
+        _job.Revoke();
+
+        // All changes are in the lease files or the journals already, closing flushes what is pending.
+        _adminLock.Lock();
+        _journals.clear();
+        _scheduled = false;
+        _adminLock.Unlock();
+
         _servers.clear();
     }
 
@@ -201,7 +216,7 @@ namespace Plugin {
                 }        
             }
 
-            Core::File leasesFile(_persistentPath + interface + ".json");
+            Core::File leasesFile(LeaseFile(interface));
 
             if (leasesFile.Create() == true) {
                 leasesList.IElement::ToFile(leasesFile);
@@ -216,7 +231,7 @@ namespace Plugin {
     {
 
         if (_persistentPath.empty() == false) {
-            Core::File leasesFile(_persistentPath + interface + ".json");
+            Core::File leasesFile(LeaseFile(interface));
 
             if (leasesFile.Open(true) == true) {
                 Core::JSON::ArrayType<Data::Server::Lease> leases;
@@ -233,16 +248,144 @@ namespace Plugin {
                     dhcpServer.AddLease(iterator.Current().Get());
                 }
             } 
+
+            // Apply the changes made after the lease file was written. A rotated journal is only left
+            // behind if we went down while folding it into the lease file.
+            Restore restore(dhcpServer);
+            bool rotated = (LeaseJournal::Replay(RotatedJournalFile(interface), restore) > 0);
+            uint32_t replayed = LeaseJournal::Replay(JournalFile(interface), restore);
+
+            TRACE(Trace::Information, (_T("Replayed %d journaled lease changes on interface %s"), replayed, interface.c_str()));
+
+            _adminLock.Lock();
+
+            Journal& journal(_journals[interface]);
+
+            if (journal.Storage.Open(JournalFile(interface)) == true) {
+                journal.Rotated = rotated;
+
+                if ((rotated == true) || (journal.Storage.Size() >= _journalSize)) {
+                    ScheduleSync();
+                }
+            } else {
+                _journals.erase(interface);
+            }
+
+            _adminLock.Unlock();
+        }
+    }
+
+    // Fold the journal into the lease file, so the journal (and startup replay time) stays small.
+    void DHCPServer::CompactLeases(const string& interface, const DHCPServerImplementation& dhcpServer)
+    {
+        Core::JSON::ArrayType<Data::Server::Lease> leasesList;
+        bool rotated = false;
+
+        {
+            // Holding the iterator keeps the server from changing leases, so nothing gets journaled
+            // between taking this snapshot and starting the new journal.
+            DHCPServerImplementation::Iterator leases = dhcpServer.Leases();
+            while (leases.Next() && (leases.IsValid() == true)) {
+                leasesList.Add().Set(leases.Current());
+            }
+
+            _adminLock.Lock();
+
+            std::map<const string, Journal>::iterator journal(_journals.find(interface));
+            if (journal != _journals.end()) {
+                rotated = (journal->second.Storage.Rotate(RotatedJournalFile(interface)) || journal->second.Rotated);
+                journal->second.Rotated = rotated;
+            }
+
+            _adminLock.Unlock();
+        }
+
+        if (rotated == true) {
+            const string newFile(LeaseFile(interface) + _T(".new"));
+            Core::File leasesFile(newFile);
+
+            if (leasesFile.Create() == true) {
+                leasesList.IElement::ToFile(leasesFile);
+                leasesFile.Close();
+
+                // The rotated journal is the only other copy of its leases, so it may only go once both
+                // the new lease file and its rename are on storage.
+                if (LeaseJournal::SyncFile(newFile) == false) {
+                    SYSLOG(Logging::Notification, (_T("Could not flush lease file of interface %s"), interface.c_str()));
+                } else if ((::rename(newFile.c_str(), LeaseFile(interface).c_str()) == 0) && (LeaseJournal::SyncDirectory(LeaseFile(interface)) == true)) {
+                    Core::File(RotatedJournalFile(interface)).Destroy();
+
+                    _adminLock.Lock();
+                    std::map<const string, Journal>::iterator journal(_journals.find(interface));
+                    if (journal != _journals.end()) {
+                        journal->second.Rotated = false;
+                    }
+                    _adminLock.Unlock();
+                } else {
+                    SYSLOG(Logging::Notification, (_T("Could not update lease file of interface %s"), interface.c_str()));
+                }
+            }
+        }
+    }
+
+    // Must be called with the _adminLock taken.
+    void DHCPServer::ScheduleSync()
+    {
+        if (_scheduled == false) {
+            _scheduled = true;
+            _job.Schedule(Core::Time::Now().Add(SyncDelay));
+        }
+    }
+
+    void DHCPServer::Dispatch()
+    {
+        std::list<string> compact;
+
+        _adminLock.Lock();
+
+        _scheduled = false;
+
+        for (std::pair<const string, Journal>& journal : _journals) {
+            journal.second.Storage.Sync();
+
+            if ((journal.second.Rotated == true) || (journal.second.Storage.Size() >= _journalSize)) {
+                compact.push_back(journal.first);
+            }
+        }
+
+        _adminLock.Unlock();
+
+        for (const string& interface : compact) {
+            std::map<const string, DHCPServerImplementation>::const_iterator server(_servers.find(interface));
+
+            if (server != _servers.end()) {
+                CompactLeases(interface, server->second);
+            }
         }
     }
 
     void DHCPServer::OnNewIPRequest(const string& interface, const DHCPServerImplementation::Lease* lease) 
     {
-        TRACE(Trace::Information, ("DHCP server granted address %s on interface %s", lease->Address().HostAddress().c_str(), interface.c_str()));
+        TRACE(Trace::Information, ("DHCP server %s address %s on interface %s", (lease->IsExpired() == true ? "released" : "granted"), lease->Address().HostAddress().c_str(), interface.c_str()));
 
-        auto dhcpServer = _servers.find(interface);
-        if (dhcpServer != _servers.end()) {
-            SaveLeases(interface, dhcpServer->second);
+        bool journaled = false;
+
+        _adminLock.Lock();
+
+        std::map<const string, Journal>::iterator journal(_journals.find(interface));
+        if (journal != _journals.end()) {
+            journaled = journal->second.Storage.Append(lease->Id().Id(), lease->Id().Length(), lease->Raw(), lease->Expiration());
+            ScheduleSync();
+        }
+
+        _adminLock.Unlock();
+
+        if (journaled == false) {
+            // Without a journal, the only way to persist is writing it all out.
+            auto dhcpServer = _servers.find(interface);
+            if (dhcpServer != _servers.end()) {
+                SaveLeases(interface, dhcpServer->second);
+            }
         }
     }
 
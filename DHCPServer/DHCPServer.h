@@ -20,6 +20,7 @@
 #pragma once
 
 #include "DHCPServerImplementation.h"
+#include "LeaseJournal.h"
 #include <interfaces/json/JsonData_DHCPServer.h>
 #include "Module.h"
 
@@ -229,10 +230,12 @@ namespace Plugin {
                 , Name()
                 , DNS()
                 , Servers()
+                , JournalSize(64)
             {
                 Add(_T("name"), &Name);
                 Add(_T("dns"), &DNS);
                 Add(_T("servers"), &Servers);
+                Add(_T("journalsize"), &JournalSize);
             }
             ~Config()
             {
@@ -242,8 +245,48 @@ namespace Plugin {
             Core::JSON::String Name;
             Core::JSON::String DNS;
             Core::JSON::ArrayType<Server> Servers;
+            Core::JSON::DecUInt16 JournalSize; // Size in KB after which a journal is folded into the lease file
         };
 
+        // Applies journaled lease changes to a server while loading.
+        class Restore : public LeaseJournal::IReplay {
+        public:
+            Restore() = delete;
+            Restore(const Restore&) = delete;
+            Restore& operator=(const Restore&) = delete;
+
+            Restore(DHCPServerImplementation& server)
+                : _server(server)
+            {
+            }
+            ~Restore() override
+            {
+            }
+
+        public:
+            void Replay(const uint8_t id[], const uint8_t length, const uint32_t address, const uint64_t expiration) override
+            {
+                _server.AddLease(DHCPServerImplementation::Lease(DHCPServerImplementation::Identifier(id, length), address, expiration));
+            }
+
+        private:
+            DHCPServerImplementation& _server;
+        };
+
+        struct Journal {
+            Journal()
+                : Storage()
+                , Rotated(false)
+            {
+            }
+
+            LeaseJournal Storage;
+            bool Rotated; // A rotated journal is waiting to be folded into the lease file
+        };
+
+        // Time the changes of a burst of requests are collected before they are flushed to storage.
+        static constexpr uint16_t SyncDelay = 100; // ms
+
     private:
         DHCPServer(const DHCPServer&) = delete;
         DHCPServer& operator=(const DHCPServer&) = delete;
@@ -282,6 +325,23 @@ namespace Plugin {
         // -------------------------------------------------------------------------------------------------------
         void SaveLeases(const string& interface, const DHCPServerImplementation& dhcpServer) const;
         void LoadLeases(const string& interface, DHCPServerImplementation& dhcpServer);
+        void CompactLeases(const string& interface, const DHCPServerImplementation& dhcpServer);
+        inline string LeaseFile(const string& interface) const
+        {
+            return (_persistentPath + interface + _T(".json"));
+        }
+        inline string JournalFile(const string& interface) const
+        {
+            return (_persistentPath + interface + _T(".journal"));
+        }
+        inline string RotatedJournalFile(const string& interface) const
+        {
+            return (_persistentPath + interface + _T(".journal.old"));
+        }
+        void ScheduleSync();
+
+        friend Core::ThreadPool::JobType<DHCPServer&>;
+        void Dispatch();
 
         // Callbacks
         void OnNewIPRequest(const string& interface, const DHCPServerImplementation::Lease* lease);
@@ -289,6 +349,11 @@ namespace Plugin {
         uint16_t _skipURL;
         std::map<const string, DHCPServerImplementation> _servers;
         std::string _persistentPath;
+        Core::CriticalSection _adminLock;
+        std::map<const string, Journal> _journals;
+        uint32_t _journalSize;
+        bool _scheduled;
+        Core::WorkerPool::JobType<DHCPServer&> _job;
     };
 
 } // namespace Plugin
@@ -22,6 +22,12 @@
 
 #include "Module.h"
 
+#include <queue>
+
+#ifdef __WINDOWS__
+#include <intrin.h>
+#endif
+
 namespace WPEFramework {
 
 namespace Plugin {
@@ -259,6 +265,18 @@ namespace Plugin {
                 Core::ToHexString(Id(), _length, text);
                 return (text);
             }
+            // FNV-1a, identifiers are mostly MAC addresses, so no need for anything stronger.
+            inline size_t Hash() const
+            {
+                uint32_t hash = 2166136261u;
+                const uint8_t* data = Id();
+
+                for (uint8_t index = 0; index < _length; index++) {
+                    hash = (hash ^ data[index]) * 16777619u;
+                }
+
+                return (hash);
+            }
         public:
             static constexpr uint16_t maxLength = 16;
         private:
@@ -440,14 +458,45 @@ namespace Plugin {
             uint32_t _preferred;
             classifications _classification;
         };
+        // All leases, indexed on client and on address. Addresses of the pool that were never handed out
+        // are kept in a bitmap and expired leases are found through a min-heap on the expiration time,
+        // so picking an address for a client does not depend on the size of the pool.
         class LeaseList : public std::list<Lease> {
         private:
             LeaseList(const LeaseList&) = delete;
             LeaseList& operator=(const LeaseList&) = delete;
 
+            struct IdentifierHash {
+                inline size_t operator()(const Identifier& id) const
+                {
+                    return (id.Hash());
+                }
+            };
+
+            // The entry is outdated if the expiration of the lease changed after it was queued.
+            struct Expiry {
+                uint64_t Time;
+                Lease* Entry;
+
+                inline bool operator>(const Expiry& rhs) const
+                {
+                    return (Time > rhs.Time);
+                }
+            };
+
+            typedef std::priority_queue<Expiry, std::vector<Expiry>, std::greater<Expiry>> ExpiryHeap;
+
         public:
             LeaseList()
                 : std::list<Lease>()
+                , _adminLock()
+                , _byAddress()
+                , _byId()
+                , _expiries()
+                , _unused()
+                , _minAddress(0)
+                , _maxAddress(0)
+                , _hint(0)
             {
             }
             ~LeaseList()
@@ -472,8 +521,165 @@ namespace Plugin {
                 _adminLock.Unlock();
             }
 
+            // NOTE:
+            // All methods below need to be executed within the lock.
+            void Pool(const uint32_t minAddress, const uint32_t maxAddress)
+            {
+                ASSERT(minAddress <= maxAddress);
+
+                const uint32_t size = (maxAddress - minAddress) + 1;
+
+                _minAddress = minAddress;
+                _maxAddress = maxAddress;
+                _hint = 0;
+                _unused.assign((size + 63) / 64, ~static_cast<uint64_t>(0));
+
+                // Do not hand out the padding at the end of the last word.
+                if ((size % 64) != 0) {
+                    _unused.back() = ((static_cast<uint64_t>(1) << (size % 64)) - 1);
+                }
+
+                for (const std::pair<const uint32_t, Lease*>& entry : _byAddress) {
+                    Taken(entry.first);
+                }
+            }
+            inline Lease* Find(const uint32_t address)
+            {
+                std::unordered_map<uint32_t, Lease*>::iterator index(_byAddress.find(address));
+                return (index != _byAddress.end() ? index->second : nullptr);
+            }
+            inline Lease* Find(const Identifier& id)
+            {
+                std::unordered_map<Identifier, Lease*, IdentifierHash>::iterator index(_byId.find(id));
+                return (index != _byId.end() ? index->second : nullptr);
+            }
+            Lease* Create(const Identifier& id, const uint32_t address)
+            {
+                ASSERT(Find(address) == nullptr);
+
+                push_back(Lease(id, address));
+
+                Lease* result = &(back());
+
+                _byAddress.emplace(address, result);
+                _byId[id] = result;
+                Taken(address);
+
+                return (result);
+            }
+            // Loaded leases, a later one for the same address (e.g. from the journal) replaces the earlier one.
+            void Add(const Lease& lease)
+            {
+                Lease* result = Find(lease.Raw());
+
+                if (result == nullptr) {
+                    result = Create(lease.Id(), lease.Raw());
+                } else if (result->Id() != lease.Id()) {
+                    Update(*result, lease.Id());
+                }
+
+                Expiration(*result, lease.Expiration());
+            }
+            // Hand over an (expired) lease to another client.
+            void Update(Lease& lease, const Identifier& id)
+            {
+                std::unordered_map<Identifier, Lease*, IdentifierHash>::iterator index(_byId.find(lease.Id()));
+
+                if ((index != _byId.end()) && (index->second == &lease)) {
+                    _byId.erase(index);
+                }
+
+                lease.Update(id);
+                _byId[id] = &lease;
+            }
+            void Expiration(Lease& lease, const uint64_t time)
+            {
+                lease.Expiration(time);
+
+                // Outdated entries are skipped when they surface, but do not let them pile up.
+                if (_expiries.size() > ((size() * 4) + 64)) {
+                    Rebuild();
+                } else {
+                    _expiries.push({ time, &lease });
+                }
+            }
+            // Index of the lowest bit set, the value must not be 0.
+            static inline uint32_t LowestBit(const uint64_t value)
+            {
+                ASSERT(value != 0);
+#ifdef __WINDOWS__
+                unsigned long index;
+                _BitScanForward64(&index, value);
+                return (static_cast<uint32_t>(index));
+#else
+                return (static_cast<uint32_t>(__builtin_ctzll(value)));
+#endif
+            }
+            // An address of the pool that was never handed out, 0 if there are none left.
+            uint32_t Unused()
+            {
+                uint32_t result = 0;
+
+                while ((_hint < _unused.size()) && (_unused[_hint] == 0)) {
+                    _hint++;
+                }
+
+                if (_hint < _unused.size()) {
+                    result = _minAddress + (_hint * 64) + LowestBit(_unused[_hint]);
+                }
+
+                return (result);
+            }
+            // The lease that expired first, nullptr if none has expired.
+            Lease* Expired()
+            {
+                Lease* result = nullptr;
+
+                while ((_expiries.empty() == false) && (result == nullptr)) {
+                    const Expiry& top(_expiries.top());
+
+                    if (top.Time != top.Entry->Expiration()) {
+                        _expiries.pop();
+                    } else if (top.Entry->IsExpired() == true) {
+                        result = top.Entry;
+                    } else {
+                        break;
+                    }
+                }
+
+                return (result);
+            }
+
+        private:
+            inline void Taken(const uint32_t address)
+            {
+                if ((address >= _minAddress) && (address <= _maxAddress) && (_unused.empty() == false)) {
+                    const uint32_t offset = address - _minAddress;
+                    _unused[offset / 64] &= ~(static_cast<uint64_t>(1) << (offset % 64));
+                }
+            }
+            void Rebuild()
+            {
+                std::vector<Expiry> entries;
+
+                entries.reserve(size());
+
+                for (Lease& lease : *this) {
+                    entries.push_back({ lease.Expiration(), &lease });
+                }
+
+                _expiries = ExpiryHeap(std::greater<Expiry>(), std::move(entries));
+            }
+
         private:
             mutable Core::CriticalSection _adminLock;
+            std::unordered_map<uint32_t, Lease*> _byAddress;
+            std::unordered_map<Identifier, Lease*, IdentifierHash> _byId;
+            ExpiryHeap _expiries;
+            std::vector<uint64_t> _unused; // Bit set: address was never handed out
+            uint32_t _minAddress;
+            uint32_t _maxAddress;
+            uint32_t _hint; // Words before this one have no unused addresses left
         };
 
         class Response {
@@ -678,7 +884,6 @@ namespace Plugin {
             , _poolSize(poolSize)
             , _minAddress(0)
             , _maxAddress(0)
-            , _nextFreeIp(0)
             , _server(0)
             , _router(router)
             , _dns(~0)
@@ -727,7 +932,7 @@ namespace Plugin {
         inline void AddLease(const Lease& lease)
         {
             _leases.Lock();
-            _leases.push_back(lease);
+            _leases.Add(lease);
             _leases.Unlock();
         }
 
@@ -744,47 +949,22 @@ namespace Plugin {
         uint32_t Close();
 
     private:
-        // NOTE:
-        // The next three methods, Find,Find and Create need to be executed within the lock.
-        inline Lease* Find(const uint32_t address)
-        {
-            LeaseList::iterator index(_leases.begin());
-            while ((index != _leases.end()) && (index->Raw() != address)) {
-                index++;
-            }
-
-            return (index != _leases.end() ? &(*index) : nullptr);
-        }
-        inline Lease* Find(const Identifier& id)
-        {
-            LeaseList::iterator index(_leases.begin());
-            while ((index != _leases.end()) && (index->Id() != id)) {
-                index++;
-            }
-
-            return (index != _leases.end() ? &(*index) : nullptr);
-        }
-        inline Lease* Create(const Identifier& id, const uint32_t address)
-        {
-            _leases.push_back(Lease(id, address));
-            return &(_leases.back());
-        }
         void Discover(Response& response, const ScratchPad& scratchPad)
         {
             _leases.Lock();
-            Lease* result = Find(scratchPad.Id());
+            Lease* result = _leases.Find(scratchPad.Id());
 
             // RFC 2131 section 4.3.1
             if ((result == nullptr) && (scratchPad.RequestedIP() != 0)) {
                 // Make sure the preferred IP address is within the pool, otherwise offer a correct one anyway
                 if ((scratchPad.RequestedIP() >= _minAddress) && (scratchPad.RequestedIP() <= _maxAddress)) {
-                    result = Find(scratchPad.RequestedIP());
+                    result = _leases.Find(scratchPad.RequestedIP());
 
                     if (result == nullptr) {
                         // Ip address has not been taken yet, time to "assign" it to this client.
-                        result = Create(scratchPad.Id(), scratchPad.RequestedIP());
+                        result = _leases.Create(scratchPad.Id(), scratchPad.RequestedIP());
                     } else if (result->IsExpired() == true) {
-                        result->Update(scratchPad.Id());
+                        _leases.Update(*result, scratchPad.Id());
                     } else {
                         // IP address is taken
                         result = nullptr;
@@ -794,24 +974,16 @@ namespace Plugin {
 
             if (result == nullptr) {
                 // First look in previously unallocated IP slots
-                uint32_t ip;
-                for (ip = _nextFreeIp; ip <= _maxAddress; ip++) {
-                    if (Find(ip) == nullptr) {
-                        result = Create(scratchPad.Id(), ip);
-                        _nextFreeIp = (ip + 1);
-                        break;
-                    }
-                }
+                uint32_t ip = _leases.Unused();
 
-                if (result == nullptr) {
+                if (ip != 0) {
+                    result = _leases.Create(scratchPad.Id(), ip);
+                } else {
                     // Still not found a free IP slot, attempt picking up one of the expired ones
-                    for (ip = _minAddress; ip <= _maxAddress ; ip++) {
-                        Lease* lease = Find(ip);
-                        if ((lease != nullptr) && (lease->IsExpired() == true)) {
-                            result = lease;
-                            result->Update(scratchPad.Id());
-                            break;
-                        }
+                    result = _leases.Expired();
+
+                    if (result != nullptr) {
+                        _leases.Update(*result, scratchPad.Id());
                     }
                 }
             }
@@ -823,7 +995,7 @@ namespace Plugin {
                     // Temporarily lock out the offered IP address until the client actually requests it
                     Core::Time timeout = Core::Time::Now();
                     timeout.Add(60 /* sec */ * 1000);
-                    result->Expiration(timeout.Ticks());
+                    _leases.Expiration(*result, timeout.Ticks());
                 }
 
                 response.Offer(result->Raw());
@@ -837,7 +1009,7 @@ namespace Plugin {
             _leases.Lock();
 
             // RFC 2131 section 4.3.2 Determine requested IP address
-            Lease* result = Find(scratchPad.Id());
+            Lease* result = _leases.Find(scratchPad.Id());
             uint32_t serverId = scratchPad.ServerIdentifier();
             uint32_t requested = scratchPad.RequestedIP();
             
@@ -848,16 +1020,30 @@ namespace Plugin {
                 Core::Time leaseExp = Core::Time::Now();
                 leaseExp.Add(DefaultLeaseTime * (60 /* min */ * 60 * 1000));
                 response.LeaseTime(DefaultLeaseTime);
-                result->Expiration(leaseExp.Ticks());
+                _leases.Expiration(*result, leaseExp.Ticks());
                 _ipRequestCallback(_interfaceName, result);
             } else {
                 if (result != nullptr) {
-                    result->Expiration(0); // Invalidate
+                    _leases.Expiration(*result, 0); // Invalidate
                 }
             }
 
             _leases.Unlock();
         }
+        // RFC 2131 section 4.3.4, the address is free to be handed out again.
+        void Release(const ScratchPad& scratchPad)
+        {
+            _leases.Lock();
+
+            Lease* result = _leases.Find(scratchPad.Id());
+
+            if ((result != nullptr) && (result->IsExpired() == false)) {
+                _leases.Expiration(*result, 0);
+                _ipRequestCallback(_interfaceName, result);
+            }
+
+            _leases.Unlock();
+        }
         void Submit(const Core::ProxyType<Response> entry)
         {
             _responses.push_back(entry);
@@ -924,9 +1110,10 @@ namespace Plugin {
                         Request(*response, scratchPad);
                         break;
                     case CLASSIFICATION_DECLINE:
-                        // Fall-through
+                        // UNSUPPORTED: Mark address as in use by someone else
+                        break;
                     case CLASSIFICATION_RELEASE:
-                        // UNSUPPORTED: Mark address as unused
+                        Release(scratchPad);
                         break;
                     case CLASSIFICATION_INFORM:
                         // Unsupported DHCP message type - fail silently
@@ -956,7 +1143,6 @@ namespace Plugin {
         uint32_t _poolSize;
         uint32_t _minAddress;
         uint32_t _maxAddress;
-        uint32_t _nextFreeIp;
         uint32_t _server;
         uint32_t _router;
         uint32_t _dns;
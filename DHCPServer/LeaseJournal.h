@@ -0,0 +1,171 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __LEASEJOURNAL_H__
+#define __LEASEJOURNAL_H__
+
+#include "Module.h"
+
+#include "../helpers/JournalFile.h"
+
+namespace WPEFramework {
+namespace Plugin {
+
+    // Append-only log of lease changes (ACK and RELEASE) of one interface. A change costs a single
+    // write, the data is flushed to storage in batches (Sync). Periodically the journal is folded
+    // into the JSON lease file and restarted.
+    //
+    // Record layout (host byte order):
+    //   [marker:1][identifier length:1][reserved:2][address:4][expiration:8][identifier]
+    class LeaseJournal {
+    private:
+        static constexpr uint8_t RecordMarker = 0xD4;
+        static constexpr uint32_t HeaderSize = 1 + 1 + 2 + 4 + 8;
+
+    public:
+        struct IReplay {
+            virtual ~IReplay() {}
+            virtual void Replay(const uint8_t id[], const uint8_t length, const uint32_t address, const uint64_t expiration) = 0;
+        };
+
+    private:
+        class Record : public JournalFile::IRecord {
+        public:
+            Record() = delete;
+            Record(const Record&) = delete;
+            Record& operator=(const Record&) = delete;
+
+            Record(IReplay& sink)
+                : _sink(sink)
+            {
+            }
+            ~Record() override
+            {
+            }
+
+        public:
+            uint32_t Length(const uint8_t data[], const uint32_t available) const override
+            {
+                uint32_t result = 0;
+
+                if ((available >= HeaderSize) && (data[0] == RecordMarker) && ((HeaderSize + data[1]) <= available)) {
+                    result = HeaderSize + data[1];
+                }
+
+                return (result);
+            }
+            void Replay(const uint8_t data[], const uint32_t /* length */) override
+            {
+                uint32_t address;
+                uint64_t expiration;
+
+                ::memcpy(&address, &data[4], sizeof(address));
+                ::memcpy(&expiration, &data[8], sizeof(expiration));
+
+                _sink.Replay(&data[HeaderSize], data[1], address, expiration);
+            }
+
+        private:
+            IReplay& _sink;
+        };
+
+    public:
+        LeaseJournal(const LeaseJournal&) = delete;
+        LeaseJournal& operator=(const LeaseJournal&) = delete;
+
+        LeaseJournal()
+            : _file()
+        {
+        }
+        ~LeaseJournal()
+        {
+        }
+
+    public:
+        inline bool IsOpen() const
+        {
+            return (_file.IsOpen());
+        }
+        // Number of bytes appended since the journal was (re)started.
+        inline uint32_t Size() const
+        {
+            return (_file.Size());
+        }
+        inline bool Open(const string& fileName)
+        {
+            return (_file.Open(fileName));
+        }
+        inline void Close()
+        {
+            _file.Close();
+        }
+        bool Append(const uint8_t id[], const uint8_t length, const uint32_t address, const uint64_t expiration)
+        {
+            uint8_t header[HeaderSize];
+
+            header[0] = RecordMarker;
+            header[1] = length;
+            header[2] = 0;
+            header[3] = 0;
+            ::memcpy(&header[4], &address, sizeof(address));
+            ::memcpy(&header[8], &expiration, sizeof(expiration));
+
+            const JournalFile::Part parts[] = {
+                { header, sizeof(header) },
+                { id, length }
+            };
+
+            return (_file.Append(parts, sizeof(parts) / sizeof(JournalFile::Part)));
+        }
+        // Flush whatever was appended since the last call to storage.
+        inline void Sync()
+        {
+            _file.Sync();
+        }
+        // Move the current journal aside (to be deleted once the lease file containing its changes is
+        // written) and start a fresh one.
+        inline bool Rotate(const string& oldFileName)
+        {
+            return (_file.Rotate(oldFileName));
+        }
+
+        // Flush the content of a (closed) file to storage.
+        static bool SyncFile(const string& fileName)
+        {
+            return (JournalFile::SyncFile(fileName));
+        }
+        // Flush a rename into the directory holding the file to storage.
+        static bool SyncDirectory(const string& fileName)
+        {
+            return (JournalFile::SyncDirectory(fileName));
+        }
+        static uint32_t Replay(const string& fileName, IReplay& sink)
+        {
+            Record record(sink);
+
+            return (JournalFile::Replay(fileName, record));
+        }
+
+    private:
+        JournalFile _file;
+    };
+}
+}
+
+#endif // __LEASEJOURNAL_H__
@@ -0,0 +1,185 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Replays, tears and compacts a lease journal in a scratch directory. Returns the number of failed
+// checks, so it can be run as is from a test script.
+
+#include "../LeaseJournal.h"
+
+#include <cstdio>
+#include <fcntl.h>
+#include <map>
+#include <unistd.h>
+
+MODULE_NAME_DECLARATION(BUILD_REFERENCE)
+
+namespace WPEFramework {
+
+class Collector : public Plugin::LeaseJournal::IReplay {
+public:
+    Collector(const Collector&) = delete;
+    Collector& operator=(const Collector&) = delete;
+
+    Collector()
+        : Leases()
+    {
+    }
+    ~Collector() override
+    {
+    }
+
+public:
+    // An expiration of 0 is a released lease.
+    void Replay(const uint8_t id[], const uint8_t length, const uint32_t address, const uint64_t expiration) override
+    {
+        const string identifier(reinterpret_cast<const char*>(id), length);
+
+        if (expiration == 0) {
+            Leases.erase(identifier);
+        } else {
+            Leases[identifier] = std::make_pair(address, expiration);
+        }
+    }
+
+public:
+    std::map<string, std::pair<uint32_t, uint64_t>> Leases;
+};
+
+}
+
+using namespace WPEFramework;
+
+static uint32_t _failures = 0;
+
+#define CHECK(condition)                                                                   \
+    do {                                                                                   \
+        if ((condition) == false) {                                                        \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            _failures++;                                                                   \
+        }                                                                                  \
+    } while (false)
+
+static void AppendRaw(const string& fileName, const uint8_t data[], const uint32_t length)
+{
+    int fd = ::open(fileName.c_str(), O_WRONLY | O_APPEND);
+
+    if (fd != -1) {
+        CHECK(::write(fd, data, length) == static_cast<ssize_t>(length));
+        ::close(fd);
+    }
+}
+
+static uint32_t FileSize(const string& fileName)
+{
+    Core::File file(fileName);
+
+    return (file.Exists() == true ? static_cast<uint32_t>(file.Size()) : 0);
+}
+
+int main(int argc, char* argv[])
+{
+    const string directory(argc > 1 ? argv[1] : "/tmp");
+    const string journalName(directory + "/DHCPServerLeaseJournalTest.journal");
+    const string oldName(journalName + ".old");
+    const uint8_t first[] = { 0x00, 0x11, 0x22, 0x33, 0x44, 0x55 };
+    const uint8_t second[] = { 0x66, 0x77, 0x88, 0x99, 0xAA, 0xBB, 0xCC };
+    const string firstId(reinterpret_cast<const char*>(first), sizeof(first));
+    const string secondId(reinterpret_cast<const char*>(second), sizeof(second));
+
+    ::unlink(journalName.c_str());
+    ::unlink(oldName.c_str());
+
+    // Replay hands back the ACKs and RELEASEs in order, synced or not.
+    {
+        Plugin::LeaseJournal journal;
+
+        CHECK(journal.Open(journalName) == true);
+        CHECK(journal.Append(first, sizeof(first), 0xC0A80064, 1000) == true);
+        CHECK(journal.Append(second, sizeof(second), 0xC0A80065, 2000) == true);
+        journal.Sync();
+        CHECK(journal.Append(first, sizeof(first), 0xC0A80064, 0) == true);
+        CHECK(journal.Append(second, sizeof(second), 0xC0A80065, 3000) == true);
+        journal.Close();
+    }
+    {
+        Collector collector;
+
+        CHECK(Plugin::LeaseJournal::Replay(journalName, collector) == 4);
+        CHECK(collector.Leases.size() == 1);
+        CHECK(collector.Leases.find(firstId) == collector.Leases.end());
+        CHECK(collector.Leases[secondId] == std::make_pair(static_cast<uint32_t>(0xC0A80065), static_cast<uint64_t>(3000)));
+    }
+
+    // A torn tail ends the replay, and is cut off so records appended after it replay again.
+    const uint32_t intact = FileSize(journalName);
+    const uint8_t torn[] = { 0xD4, sizeof(first), 0x00, 0x00, 0x64, 0x00 };
+
+    AppendRaw(journalName, torn, sizeof(torn));
+    {
+        Collector collector;
+
+        CHECK(Plugin::LeaseJournal::Replay(journalName, collector) == 4);
+        CHECK(FileSize(journalName) == intact);
+    }
+    {
+        Plugin::LeaseJournal journal;
+
+        CHECK(journal.Open(journalName) == true);
+        CHECK(journal.Size() == intact);
+        CHECK(journal.Append(first, sizeof(first), 0xC0A80066, 4000) == true);
+        journal.Close();
+    }
+    {
+        Collector collector;
+
+        CHECK(Plugin::LeaseJournal::Replay(journalName, collector) == 5);
+        CHECK(collector.Leases.size() == 2);
+        CHECK(collector.Leases[firstId].first == 0xC0A80066);
+    }
+
+    // Compaction: the journal is rotated aside, a fresh one takes the new records.
+    {
+        Plugin::LeaseJournal journal;
+
+        CHECK(journal.Open(journalName) == true);
+        CHECK(journal.Rotate(oldName) == true);
+        CHECK(journal.IsOpen() == true);
+        CHECK(journal.Size() == 0);
+        CHECK(journal.Append(second, sizeof(second), 0xC0A80065, 0) == true);
+        journal.Close();
+    }
+    {
+        Collector collector;
+
+        // Replaying the rotated journal before the fresh one gives the state after both.
+        CHECK(Plugin::LeaseJournal::Replay(oldName, collector) == 5);
+        CHECK(Plugin::LeaseJournal::Replay(journalName, collector) == 1);
+        CHECK(collector.Leases.size() == 1);
+        CHECK(collector.Leases.find(secondId) == collector.Leases.end());
+    }
+
+    ::unlink(oldName.c_str());
+    ::unlink(journalName.c_str());
+
+    printf("DHCPServerLeaseJournalTest: %s\n", (_failures == 0 ? "passed" : "FAILED"));
+
+    Core::Singleton::Dispose();
+
+    return (static_cast<int>(_failures));
+}
@@ -46,7 +46,7 @@ namespace Plugin {
         bool correctStructure(true);
         Core::JSON::ArrayType<NameSpace::Entry>::ConstIterator keyIndex(current.Dictionary.Elements());
         Core::JSON::ArrayType<NameSpace>::ConstIterator spaceIndex(current.Spaces.Elements());
-        std::list<RuntimeEntry>* currentList = NULL;
+        Entries* currentList = NULL;
 
         // Fill in the keys from this name space...
         while ((correctStructure == true) && (keyIndex.Next() == true)) {
@@ -61,7 +61,13 @@ namespace Plugin {
                     ASSERT(currentList != NULL);
                 }
 
-                currentList->push_back(RuntimeEntry(key, keyIndex.Current().Value.Value(), keyIndex.Current().Type.Value()));
+                RuntimeEntry* entry = currentList->Find(key);
+
+                if (entry == nullptr) {
+                    currentList->Add(key, keyIndex.Current().Value.Value(), keyIndex.Current().Type.Value());
+                } else {
+                    entry->Value(keyIndex.Current().Value.Value());
+                }
             }
         }
 
@@ -74,42 +80,63 @@ namespace Plugin {
         return (correctStructure);
     }
 
-    void Dictionary::CreateExternalDictionary(const string& currentSpace, NameSpace& current) const
+    bool Dictionary::CreateModifications(const string& currentSpace, const NameSpace& current, Modifications& batch) const
     {
-        Core::TextFragment requiredSpace(currentSpace);
-        DictionaryMap::const_iterator index(_dictionary.begin());
+        bool correctStructure(true);
+        Core::JSON::ArrayType<NameSpace::Entry>::ConstIterator keyIndex(current.Dictionary.Elements());
+        Core::JSON::ArrayType<NameSpace>::ConstIterator spaceIndex(current.Spaces.Elements());
 
-        while (index != _dictionary.end()) {
-            // Vallidate if the given path does include this namespace..
-            if ((currentSpace.empty() == true) || (requiredSpace.EqualText(index->first.c_str(), 0, requiredSpace.Length(), true) == true)) {
-                // Seems like we need to report this space, build it up
-                NameSpace& blockToFill(current[index->first]);
+        while ((correctStructure == true) && (keyIndex.Next() == true)) {
+            const string& key(keyIndex.Current().Key.Value());
+
+            correctStructure = IsValidName(key);
 
-                // No we got the namespace bloc, fill in the keys..
-                const std::list<RuntimeEntry>& keyList(index->second);
-                std::list<RuntimeEntry>::const_iterator keyIndex(keyList.begin());
+            if (correctStructure == true) {
+                batch.push_back({ currentSpace, key, keyIndex.Current().Value.Value() });
+            }
+        }
 
-                while (keyIndex != keyList.end()) {
-                    NameSpace::Entry& entry(blockToFill.Dictionary.Add(NameSpace::Entry()));
-                    entry.Key = keyIndex->Key();
-                    entry.Value = keyIndex->Value();
+        while ((correctStructure == true) && (spaceIndex.Next() == true)) {
+            string nameSpace(spaceIndex.Current().Name.Value());
+            correctStructure = IsValidName(nameSpace);
+            correctStructure = correctStructure && CreateModifications(currentSpace + NameSpaceDelimiter + nameSpace, spaceIndex.Current(), batch);
+        }
 
-                    if (keyIndex->Type() != entry.Type.Default()) {
-                        entry.Type = keyIndex->Type();
-                    }
+        return (correctStructure);
+    }
 
-                    keyIndex++;
-                }
+    void Dictionary::CreateExternalDictionary(const string& currentSpace, NameSpace& current) const
+    {
+        const string* lastSpace = nullptr;
+        NameSpace* blockToFill = nullptr;
+
+        // The keys of a namespace are visited one after the other, so the block is only looked up when
+        // the namespace changes.
+        Scan(currentSpace, [&](const string& nameSpace, const RuntimeEntry& runtimeEntry) {
+            if ((lastSpace == nullptr) || (*lastSpace != nameSpace)) {
+                // Names are relative to the requested namespace, so the result can be fed back as is by
+                // a POST on the same namespace.
+                lastSpace = &nameSpace;
+                blockToFill = &(current[nameSpace.substr(currentSpace.length())]);
             }
-            index++;
-        }
+
+            NameSpace::Entry& entry(blockToFill->Dictionary.Add(NameSpace::Entry()));
+            entry.Key = runtimeEntry.Key();
+            entry.Value = runtimeEntry.Value();
+
+            if (runtimeEntry.Type() != entry.Type.Default()) {
+                entry.Type = runtimeEntry.Type();
+            }
+        });
     }
 
     /* virtual */ const string Dictionary::Initialize(PluginHost::IShell* service)
     {
         _config.FromString(service->ConfigLine());
 
-        Core::File dictionaryFile(service->PersistentPath() + _config.Storage.Value());
+        _storageFile = service->PersistentPath() + _config.Storage.Value();
+
+        Core::File dictionaryFile(_storageFile);
 
         if (dictionaryFile.Open(true) == true) {
             NameSpace dictionary;
@@ -121,6 +148,20 @@ namespace Plugin {
             CreateInternalDictionary(EMPTY_STRING, dictionary);
         }
 
+        // Apply the modifications that were made after the storage file was written. A rotated journal
+        // is only left behind if we went down while folding it into the storage file.
+        bool rotated = (Journal::Replay(RotatedJournalFile(), *this) > 0);
+        uint32_t replayed = Journal::Replay(JournalFile(), *this);
+
+        TRACE(Trace::Information, (_T("Replayed %d journaled modifications"), replayed));
+
+        _journal.Open(JournalFile());
+
+        if ((rotated == true) || (_journal.Size() >= (_config.JournalSize.Value() * 1024))) {
+            _compacting = true;
+            _compactor.Submit();
+        }
+
         _skipURL = static_cast<uint8_t>(service->WebPrefix().length());
 
         // On succes return a name as a Callsign to be used in the URL, after the "service"prefix
@@ -129,13 +170,82 @@ namespace Plugin {
 
     /* virtual */ void Dictionary::Deinitialize(PluginHost::IShell* service)
     {
+        _compactor.Revoke();
 
-        Core::File dictionaryFile(service->PersistentPath() + _config.Storage.Value());
+        _adminLock.Lock();
 
-        if (dictionaryFile.Open(true) == true) {
-            NameSpace dictionary;
+        if (_journal.IsOpen() == true) {
+            // All modifications are already in the storage file or the journal, there is nothing
+            // left to serialize here.
+            _journal.Close();
+        } else {
+            // Without a journal, the only way to persist is writing it all out.
+            Core::File dictionaryFile(_storageFile);
+
+            if (dictionaryFile.Create() == true) {
+                NameSpace dictionary;
+                CreateExternalDictionary(EMPTY_STRING, dictionary);
+                dictionary.IElement::ToFile(dictionaryFile);
+            }
+        }
+
+        _compacting = false;
+
+        _adminLock.Unlock();
+    }
+
+    // Fold the journal into the storage file, so the journal (and startup replay time) stays small.
+    void Dictionary::Dispatch()
+    {
+        NameSpace dictionary;
+        bool rotated = false;
+
+        _adminLock.Lock();
+
+        if (_compacting == true) {
             CreateExternalDictionary(EMPTY_STRING, dictionary);
-            dictionary.IElement::ToFile(dictionaryFile);
+
+            // From here on, modifications go into a new journal. The old one is kept until the storage
+            // file holding its changes is safely written.
+            rotated = _journal.Rotate(RotatedJournalFile());
+        }
+
+        _adminLock.Unlock();
+
+        if (rotated == true) {
+            const string newStorage(_storageFile + _T(".new"));
+            Core::File dictionaryFile(newStorage);
+
+            if (dictionaryFile.Create() == true) {
+                dictionary.IElement::ToFile(dictionaryFile);
+                dictionaryFile.Close();
+
+                // The rotated journal is the only other copy of its changes, so it may only go once both
+                // the new storage file and its rename are on disk.
+                if (Journal::Sync(newStorage) == false) {
+                    SYSLOG(Logging::Notification, (_T("Could not flush dictionary storage [%s]"), newStorage.c_str()));
+                } else if (::rename(newStorage.c_str(), _storageFile.c_str()) != 0) {
+                    SYSLOG(Logging::Notification, (_T("Could not update dictionary storage [%s]"), _storageFile.c_str()));
+                } else if (Journal::SyncDirectory(_storageFile) == true) {
+                    Core::File(RotatedJournalFile()).Destroy();
+                }
+            }
+        }
+
+        _adminLock.Lock();
+        _compacting = false;
+        _adminLock.Unlock();
+    }
+
+    void Dictionary::Replay(const string& nameSpace, const string& key, const string& value)
+    {
+        Entries& container(_dictionary[nameSpace]);
+        RuntimeEntry* entry = container.Find(key);
+
+        if (entry == nullptr) {
+            container.Add(key, value, VOLATILE);
+        } else {
+            entry->Value(value);
         }
     }
 
@@ -147,12 +257,18 @@ namespace Plugin {
 
     /* virtual */ void Dictionary::Inbound(Web::Request& request)
     {
-        // There are no requests coming in with a body that require a JSON body. So continue without action here.
-        request.Body(Core::ProxyType<Web::IBody>(textBodyDataFactory.Element()));
+        if ((request.Path.empty() == false) && (request.Path[request.Path.length() - 1] == '/')) {
+            // A whole (nested) namespace is set at once.
+            request.Body(Core::ProxyType<Web::IBody>(jsonBodyDataFactory.Element()));
+        } else {
+            request.Body(Core::ProxyType<Web::IBody>(textBodyDataFactory.Element()));
+        }
     }
 
     // <GET> ../[namespace/]{Key}
+    // <GET> ../[namespace/]               returns all keys of the namespace and its nested namespaces
     // <PUT> ../[namespace/]{Key}?Type=[persistent|volatile|closure]
+    // <POST> ../[namespace/]              sets all keys in the body (dictionary format) in one go
     /* virtual */ Core::ProxyType<Web::Response> Dictionary::Process(const Web::Request& request)
     {
         ASSERT(_skipURL <= request.Path.length());
@@ -171,14 +287,33 @@ namespace Plugin {
         string key = index.Current().Text();
 
         while (index.Next() == true) {
-            if (nameSpace.empty() == true) {
-                nameSpace += NameSpaceDelimiter;
-            }
+            nameSpace += NameSpaceDelimiter;
             nameSpace += key;
             key = index.Current().Text();
         }
 
-        if (request.Verb == Web::Request::HTTP_GET) {
+        if ((request.Verb == Web::Request::HTTP_GET) && (key.empty() == true)) {
+            Core::ProxyType<Web::JSONBodyType<Dictionary::NameSpace>> spaceBody(jsonBodyDataFactory.Element());
+
+            spaceBody->Clear();
+
+            _adminLock.Lock();
+            CreateExternalDictionary(nameSpace, *spaceBody);
+            _adminLock.Unlock();
+
+            result->Body(Core::proxy_cast<Web::IBody>(spaceBody));
+        } else if ((request.Verb == Web::Request::HTTP_POST) && (key.empty() == true) && (request.HasBody() == true)) {
+            Core::ProxyType<const Web::JSONBodyType<Dictionary::NameSpace>> spaceBody(request.Body<Web::JSONBodyType<Dictionary::NameSpace>>());
+            Modifications batch;
+
+            if ((spaceBody.IsValid() == false) || (CreateModifications(nameSpace, *spaceBody, batch) == false)) {
+                result->ErrorCode = Web::STATUS_BAD_REQUEST;
+                result->Message = _T("Invalid key or namespace name.");
+            } else {
+                TRACE(Trace::Information, (_T("SetKeys ( %s, %d keys)"), nameSpace.c_str(), static_cast<uint32_t>(batch.size())));
+                Set(batch);
+            }
+        } else if (request.Verb == Web::Request::HTTP_GET) {
             string value;
             Core::ProxyType<Web::TextBody> valueBody(textBodyDataFactory.Element());
 
@@ -221,16 +356,11 @@ namespace Plugin {
         DictionaryMap::const_iterator index(_dictionary.find(nameSpace));
 
         if (index != _dictionary.end()) {
-            const std::list<RuntimeEntry>& container(index->second);
-            std::list<RuntimeEntry>::const_iterator listIndex(container.begin());
-
-            while ((listIndex != container.end()) && (listIndex->Key() != key)) {
-                listIndex++;
-            }
+            const RuntimeEntry* entry = index->second.Find(key);
 
-            if (listIndex != container.end()) {
+            if (entry != nullptr) {
                 result = true;
-                value = listIndex->Value();
+                value = entry->Value();
             }
         }
 
@@ -253,7 +383,7 @@ namespace Plugin {
         if (index != _dictionary.end()) {
             Core::ProxyType<Iterator> entries(iterators.Element());
 
-            entries->Load(InternalIterator(index->second));
+            entries->Load(InternalIterator(index->second.List()));
 
             result = &(*entries);
             result->AddRef();
@@ -273,22 +403,25 @@ namespace Plugin {
 
         _adminLock.Lock();
 
-        std::list<RuntimeEntry>& container(_dictionary[nameSpace]);
-        std::list<RuntimeEntry>::iterator listIndex(container.begin());
-
-        while ((listIndex != container.end()) && (listIndex->Key() != key)) {
-            listIndex++;
-        }
+        Entries& container(_dictionary[nameSpace]);
+        RuntimeEntry* entry = container.Find(key);
 
-        if (listIndex == container.end()) {
+        if (entry == nullptr) {
             result = true;
-            container.push_back(RuntimeEntry(key, value, VOLATILE));
-        } else if (listIndex->Value() != value) {
+            container.Add(key, value, VOLATILE);
+        } else if (entry->Value() != value) {
             result = true;
-            listIndex->Value(value);
+            entry->Value(value);
         }
 
         if (result == true) {
+            _journal.Append(nameSpace, key, value);
+
+            if ((_compacting == false) && (_journal.Size() >= (_config.JournalSize.Value() * 1024))) {
+                _compacting = true;
+                _compactor.Submit();
+            }
+
             ObserverMap::iterator index(_observers.begin());
 
             // Right, we updated send out the modification !!!
@@ -305,6 +438,61 @@ namespace Plugin {
         return (result);
     }
 
+    uint32_t Dictionary::Set(const Modifications& batch)
+    {
+        // Only the last modification of a key within the batch is reported.
+        std::unordered_map<string, const Modification*> modified;
+        std::list<const Modification*> order;
+
+        _adminLock.Lock();
+
+        for (const Modification& change : batch) {
+            Entries& container(_dictionary[change.NameSpace]);
+            RuntimeEntry* entry = container.Find(change.Key);
+            bool changed = false;
+
+            if (entry == nullptr) {
+                changed = true;
+                container.Add(change.Key, change.Value, VOLATILE);
+            } else if (entry->Value() != change.Value) {
+                changed = true;
+                entry->Value(change.Value);
+            }
+
+            if (changed == true) {
+                _journal.Append(change.NameSpace, change.Key, change.Value);
+
+                std::pair<std::unordered_map<string, const Modification*>::iterator, bool> slot(modified.emplace(change.NameSpace + NameSpaceDelimiter + change.Key, &change));
+
+                if (slot.second == true) {
+                    order.push_back(&change);
+                } else {
+                    // Keep the position of the first change, report the latest value.
+                    std::replace(order.begin(), order.end(), slot.first->second, &change);
+                    slot.first->second = &change;
+                }
+            }
+        }
+
+        if ((_compacting == false) && (_journal.Size() >= (_config.JournalSize.Value() * 1024))) {
+            _compacting = true;
+            _compactor.Submit();
+        }
+
+        // Right, we updated send out the modifications, observer by observer !!!
+        for (const std::pair<const string, struct Exchange::IDictionary::INotification*>& observer : _observers) {
+            for (const Modification* change : order) {
+                if (observer.first == change->NameSpace) {
+                    observer.second->Modified(change->NameSpace, change->Key, change->Value);
+                }
+            }
+        }
+
+        _adminLock.Unlock();
+
+        return (static_cast<uint32_t>(order.size()));
+    }
+
     /* virtual */ void Dictionary::Register(const string& nameSpace, struct Exchange::IDictionary::INotification* sink)
     {
         _adminLock.Lock();
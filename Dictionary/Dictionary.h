@@ -20,13 +20,14 @@
 #ifndef __DICTIONARY_H
 #define __DICTIONARY_H
 
+#include "Journal.h"
 #include "Module.h"
 #include <interfaces/IDictionary.h>
 
 namespace WPEFramework {
 namespace Plugin {
 
-    class Dictionary : public PluginHost::IPlugin, public PluginHost::IWeb, public Exchange::IDictionary {
+    class Dictionary : public PluginHost::IPlugin, public PluginHost::IWeb, public Exchange::IDictionary, private Journal::IReplay {
     public:
         static const TCHAR NameSpaceDelimiter = '/';
         enum enumType {
@@ -101,7 +102,65 @@ namespace Plugin {
             bool _dirty;
         };
 
-        typedef std::map<const string, std::list<RuntimeEntry>> DictionaryMap;
+        // The keys of a namespace, kept in insertion order for iteration and hashed for lookup.
+        class Entries {
+        private:
+            typedef std::unordered_map<string, std::list<RuntimeEntry>::iterator> Index;
+
+        public:
+            Entries(const Entries&) = delete;
+            Entries& operator=(const Entries&) = delete;
+
+            Entries()
+                : _list()
+                , _index()
+            {
+            }
+            ~Entries()
+            {
+            }
+
+        public:
+            inline const std::list<RuntimeEntry>& List() const
+            {
+                return (_list);
+            }
+            inline const RuntimeEntry* Find(const string& key) const
+            {
+                Index::const_iterator index(_index.find(key));
+
+                return (index != _index.end() ? &(*(index->second)) : nullptr);
+            }
+            inline RuntimeEntry* Find(const string& key)
+            {
+                Index::iterator index(_index.find(key));
+
+                return (index != _index.end() ? &(*(index->second)) : nullptr);
+            }
+            inline void Add(const string& key, const string& value, const enumType type)
+            {
+                ASSERT(_index.find(key) == _index.end());
+
+                _list.push_back(RuntimeEntry(key, value, type));
+                _index.emplace(key, std::prev(_list.end()));
+            }
+
+        private:
+            std::list<RuntimeEntry> _list;
+            Index _index;
+        };
+
+        typedef std::unordered_map<string, Entries> DictionaryMap;
+
+    public:
+        struct Modification {
+            string NameSpace;
+            string Key;
+            string Value;
+        };
+        typedef std::list<Modification> Modifications;
+
+    private:
         typedef std::list<std::pair<const string, struct Exchange::IDictionary::INotification*>> ObserverMap;
         typedef Core::IteratorType<const std::list<RuntimeEntry>, const RuntimeEntry&, std::list<RuntimeEntry>::const_iterator> InternalIterator;
 
@@ -328,9 +387,11 @@ namespace Plugin {
                 : Core::JSON::Container()
                 , Storage(_T("dictionary.json"))
                 , LingerTime(10)
+                , JournalSize(64)
             { // Time in minutes.
                 Add(_T("storage"), &Storage);
                 Add(_T("lingertime"), &LingerTime);
+                Add(_T("journalsize"), &JournalSize);
             }
             ~Config()
             {
@@ -339,16 +400,28 @@ namespace Plugin {
         public:
             Core::JSON::String Storage;
             Core::JSON::DecUInt16 LingerTime;
+            Core::JSON::DecUInt16 JournalSize; // Size in KB after which the journal is folded into the storage file
         };
 
     public:
+#ifdef __WINDOWS__
+#pragma warning(disable : 4355)
+#endif
         Dictionary()
             : _adminLock()
             , _skipURL(0)
             , _config()
             , _dictionary()
+            , _observers()
+            , _storageFile()
+            , _journal()
+            , _compacting(false)
+            , _compactor(*this)
         {
         }
+#ifdef __WINDOWS__
+#pragma warning(default : 4355)
+#endif
         virtual ~Dictionary()
         {
         }
@@ -406,9 +479,52 @@ namespace Plugin {
         virtual void Register(const string& nameSpace, struct Exchange::IDictionary::INotification* sink);
         virtual void Unregister(const string& nameSpace, struct Exchange::IDictionary::INotification* sink);
 
+        // Set many keys (in possibly many namespaces) under one lock. Observers are notified once per
+        // modified key, after the whole batch has been applied. Returns the number of modified keys.
+        uint32_t Set(const Modifications& batch);
+
+        // Visit every key of the given namespace and all its nested namespaces in place, without copying
+        // them into an intermediate list. The action is called with the lock held, so keep it short.
+        template <typename ACTION>
+        void Scan(const string& prefix, ACTION&& action) const
+        {
+            _adminLock.Lock();
+
+            for (const std::pair<const string, Entries>& space : _dictionary) {
+                if (IsWithin(prefix, space.first) == true) {
+                    for (const RuntimeEntry& entry : space.second.List()) {
+                        action(space.first, entry);
+                    }
+                }
+            }
+
+            _adminLock.Unlock();
+        }
+
     private:
         bool CreateInternalDictionary(const string& currentSpace, const NameSpace& data);
         void CreateExternalDictionary(const string& currentSpace, NameSpace& data) const;
+        bool CreateModifications(const string& currentSpace, const NameSpace& data, Modifications& batch) const;
+
+        static inline bool IsWithin(const string& prefix, const string& nameSpace)
+        {
+            return ((prefix.empty() == true) || ((nameSpace.compare(0, prefix.length(), prefix) == 0) && ((nameSpace.length() == prefix.length()) || (nameSpace[prefix.length()] == NameSpaceDelimiter))));
+        }
+
+        // Journal::IReplay, apply a journaled modification while loading.
+        void Replay(const string& nameSpace, const string& key, const string& value) override;
+
+        inline string JournalFile() const
+        {
+            return (_storageFile + _T(".journal"));
+        }
+        inline string RotatedJournalFile() const
+        {
+            return (_storageFile + _T(".journal.old"));
+        }
+
+        friend Core::ThreadPool::JobType<Dictionary&>;
+        void Dispatch();
 
     private:
         mutable Core::CriticalSection _adminLock;
@@ -416,6 +532,10 @@ namespace Plugin {
         Config _config;
         DictionaryMap _dictionary;
         ObserverMap _observers;
+        string _storageFile;
+        Journal _journal;
+        bool _compacting;
+        Core::WorkerPool::JobType<Dictionary&> _compactor;
     };
 }
 }
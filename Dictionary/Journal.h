@@ -0,0 +1,182 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "Module.h"
+
+#include "../helpers/JournalFile.h"
+
+namespace WPEFramework {
+namespace Plugin {
+
+    // Append-only log of dictionary modifications. Every Set is appended as a single record, so
+    // persisting a change costs one write, independent of the size of the dictionary. The journal
+    // is periodically folded into the (JSON) snapshot and restarted.
+    //
+    // Record layout (host byte order):
+    //   [marker:1][namespace length:2][key length:2][value length:4][namespace][key][value]
+    class Journal {
+    private:
+        static constexpr uint8_t RecordMarker = 0xD1;
+        static constexpr uint32_t HeaderSize = 1 + 2 + 2 + 4;
+
+    public:
+        struct IReplay {
+            virtual ~IReplay() {}
+            virtual void Replay(const string& nameSpace, const string& key, const string& value) = 0;
+        };
+
+    private:
+        class Record : public JournalFile::IRecord {
+        public:
+            Record() = delete;
+            Record(const Record&) = delete;
+            Record& operator=(const Record&) = delete;
+
+            Record(IReplay& sink)
+                : _sink(sink)
+            {
+            }
+            ~Record() override
+            {
+            }
+
+        public:
+            uint32_t Length(const uint8_t data[], const uint32_t available) const override
+            {
+                uint32_t result = 0;
+
+                if ((available >= HeaderSize) && (data[0] == RecordMarker)) {
+                    uint16_t nameSpaceLength;
+                    uint16_t keyLength;
+                    uint32_t valueLength;
+
+                    ::memcpy(&nameSpaceLength, &data[1], sizeof(nameSpaceLength));
+                    ::memcpy(&keyLength, &data[3], sizeof(keyLength));
+                    ::memcpy(&valueLength, &data[5], sizeof(valueLength));
+
+                    const uint64_t length = static_cast<uint64_t>(HeaderSize) + nameSpaceLength + keyLength + valueLength;
+
+                    if (length <= available) {
+                        result = static_cast<uint32_t>(length);
+                    }
+                }
+
+                return (result);
+            }
+            void Replay(const uint8_t data[], const uint32_t /* length */) override
+            {
+                uint16_t nameSpaceLength;
+                uint16_t keyLength;
+                uint32_t valueLength;
+
+                ::memcpy(&nameSpaceLength, &data[1], sizeof(nameSpaceLength));
+                ::memcpy(&keyLength, &data[3], sizeof(keyLength));
+                ::memcpy(&valueLength, &data[5], sizeof(valueLength));
+
+                const char* text = reinterpret_cast<const char*>(&data[HeaderSize]);
+
+                _sink.Replay(string(text, nameSpaceLength), string(&text[nameSpaceLength], keyLength), string(&text[nameSpaceLength + keyLength], valueLength));
+            }
+
+        private:
+            IReplay& _sink;
+        };
+
+    public:
+        Journal(const Journal&) = delete;
+        Journal& operator=(const Journal&) = delete;
+
+        Journal()
+            : _file()
+        {
+        }
+        ~Journal()
+        {
+        }
+
+    public:
+        inline bool IsOpen() const
+        {
+            return (_file.IsOpen());
+        }
+        // Number of bytes appended since the journal was (re)started.
+        inline uint32_t Size() const
+        {
+            return (_file.Size());
+        }
+        inline bool Open(const string& fileName)
+        {
+            return (_file.Open(fileName));
+        }
+        inline void Close()
+        {
+            _file.Close();
+        }
+        bool Append(const string& nameSpace, const string& key, const string& value)
+        {
+            const uint16_t nameSpaceLength = static_cast<uint16_t>(nameSpace.length());
+            const uint16_t keyLength = static_cast<uint16_t>(key.length());
+            const uint32_t valueLength = static_cast<uint32_t>(value.length());
+            uint8_t header[HeaderSize];
+
+            header[0] = RecordMarker;
+            ::memcpy(&header[1], &nameSpaceLength, sizeof(nameSpaceLength));
+            ::memcpy(&header[3], &keyLength, sizeof(keyLength));
+            ::memcpy(&header[5], &valueLength, sizeof(valueLength));
+
+            const JournalFile::Part parts[] = {
+                { header, sizeof(header) },
+                { nameSpace.data(), nameSpaceLength },
+                { key.data(), keyLength },
+                { value.data(), valueLength }
+            };
+
+            return (_file.Append(parts, sizeof(parts) / sizeof(JournalFile::Part)));
+        }
+        // Move the current journal aside (to be deleted once the snapshot containing its changes is
+        // written) and start a fresh one.
+        inline bool Rotate(const string& oldFileName)
+        {
+            return (_file.Rotate(oldFileName));
+        }
+
+        // Flush the content of a (closed) file to the disk.
+        static bool Sync(const string& fileName)
+        {
+            return (JournalFile::SyncFile(fileName));
+        }
+        // Flush a rename into the directory holding the file to the disk.
+        static bool SyncDirectory(const string& fileName)
+        {
+            return (JournalFile::SyncDirectory(fileName));
+        }
+        static uint32_t Replay(const string& fileName, IReplay& sink)
+        {
+            Record record(sink);
+
+            return (JournalFile::Replay(fileName, record));
+        }
+
+    private:
+        JournalFile _file;
+    };
+}
+}
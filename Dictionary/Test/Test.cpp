@@ -0,0 +1,180 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Replays, tears and compacts a dictionary journal in a scratch directory. Returns the number of
+// failed checks, so it can be run as is from a test script.
+
+#include "../Journal.h"
+
+#include <cstdio>
+#include <fcntl.h>
+#include <map>
+#include <unistd.h>
+
+MODULE_NAME_DECLARATION(BUILD_REFERENCE)
+
+namespace WPEFramework {
+
+class Collector : public Plugin::Journal::IReplay {
+public:
+    Collector(const Collector&) = delete;
+    Collector& operator=(const Collector&) = delete;
+
+    Collector()
+        : Keys()
+    {
+    }
+    ~Collector() override
+    {
+    }
+
+public:
+    void Replay(const string& nameSpace, const string& key, const string& value) override
+    {
+        Keys[nameSpace + '/' + key] = value;
+    }
+
+public:
+    std::map<string, string> Keys;
+};
+
+}
+
+using namespace WPEFramework;
+
+static uint32_t _failures = 0;
+
+#define CHECK(condition)                                                                   \
+    do {                                                                                   \
+        if ((condition) == false) {                                                        \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            _failures++;                                                                   \
+        }                                                                                  \
+    } while (false)
+
+static void AppendRaw(const string& fileName, const char data[], const uint32_t length)
+{
+    int fd = ::open(fileName.c_str(), O_WRONLY | O_APPEND);
+
+    if (fd != -1) {
+        CHECK(::write(fd, data, length) == static_cast<ssize_t>(length));
+        ::close(fd);
+    }
+}
+
+static uint32_t FileSize(const string& fileName)
+{
+    Core::File file(fileName);
+
+    return (file.Exists() == true ? static_cast<uint32_t>(file.Size()) : 0);
+}
+
+int main(int argc, char* argv[])
+{
+    const string directory(argc > 1 ? argv[1] : "/tmp");
+    const string journalName(directory + "/DictionaryJournalTest.journal");
+    const string oldName(journalName + ".old");
+
+    ::unlink(journalName.c_str());
+    ::unlink(oldName.c_str());
+
+    // Replay hands back what was appended, in order, the last value of a key wins.
+    {
+        Plugin::Journal journal;
+
+        CHECK(journal.Open(journalName) == true);
+        CHECK(journal.Append("system", "volume", "10") == true);
+        CHECK(journal.Append("system/audio", "mute", "false") == true);
+        CHECK(journal.Append("system", "volume", "20") == true);
+        CHECK(journal.Append("", "empty", "") == true);
+        journal.Close();
+    }
+    {
+        Collector collector;
+
+        CHECK(Plugin::Journal::Replay(journalName, collector) == 4);
+        CHECK(collector.Keys.size() == 3);
+        CHECK(collector.Keys["system/volume"] == "20");
+        CHECK(collector.Keys["system/audio/mute"] == "false");
+        CHECK(collector.Keys["/empty"] == "");
+    }
+
+    // A torn tail ends the replay, and is cut off so records appended after it replay again.
+    const uint32_t intact = FileSize(journalName);
+    const char torn[] = { static_cast<char>(0xD1), 0x06, 0x00, 0x03 };
+
+    AppendRaw(journalName, torn, sizeof(torn));
+    {
+        Collector collector;
+
+        CHECK(Plugin::Journal::Replay(journalName, collector) == 4);
+        CHECK(FileSize(journalName) == intact);
+    }
+    {
+        Plugin::Journal journal;
+
+        CHECK(journal.Open(journalName) == true);
+        CHECK(journal.Size() == intact);
+        CHECK(journal.Append("system", "volume", "30") == true);
+        journal.Close();
+    }
+    {
+        Collector collector;
+
+        CHECK(Plugin::Journal::Replay(journalName, collector) == 5);
+        CHECK(collector.Keys["system/volume"] == "30");
+    }
+
+    // Compaction: the journal is rotated aside, a fresh one takes the new records.
+    {
+        Plugin::Journal journal;
+
+        CHECK(journal.Open(journalName) == true);
+        CHECK(journal.Rotate(oldName) == true);
+        CHECK(journal.IsOpen() == true);
+        CHECK(journal.Size() == 0);
+        CHECK(journal.Append("system", "volume", "40") == true);
+        journal.Close();
+    }
+    {
+        Collector previous;
+        Collector current;
+
+        CHECK(Plugin::Journal::Replay(oldName, previous) == 5);
+        CHECK(previous.Keys["system/volume"] == "30");
+        CHECK(Plugin::Journal::Replay(journalName, current) == 1);
+        CHECK(current.Keys["system/volume"] == "40");
+    }
+
+    // A missing journal has nothing to replay.
+    ::unlink(oldName.c_str());
+    {
+        Collector collector;
+
+        CHECK(Plugin::Journal::Replay(oldName, collector) == 0);
+    }
+
+    ::unlink(journalName.c_str());
+
+    printf("DictionaryJournalTest: %s\n", (_failures == 0 ? "passed" : "FAILED"));
+
+    Core::Singleton::Dispose();
+
+    return (static_cast<int>(_failures));
+}
@@ -30,14 +30,27 @@ namespace Plugin {
         config.FromString(service->ConfigLine());
 
         _logOutput.SetDestination(config.Destination.Binding.Value(), config.Destination.Port.Value());
-        _observer.Register(config.FilePath.Value(), &_fileUpdate, config.FullFile.Value());
+
+        _observers.emplace_back();
+        _observers.back().Register(config.FilePath.Value(), &_fileUpdate, config.FullFile.Value());
+
+        Core::JSON::ArrayType<Core::JSON::String>::Iterator index(config.Files.Elements());
+        while (index.Next() == true) {
+            if ((index.Current().Value().empty() == false) && (index.Current().Value() != config.FilePath.Value())) {
+                _observers.emplace_back();
+                _observers.back().Register(index.Current().Value(), &_fileUpdate, config.FullFile.Value());
+            }
+        }
 
         return string();
     }
 
     void FileTransfer::Deinitialize(PluginHost::IShell* service)
     {
-        _observer.Unregister();
+        for (FileObserver& observer : _observers) {
+            observer.Unregister();
+        }
+        _observers.clear();
     }
 
     string FileTransfer::Information() const
@@ -19,9 +19,10 @@
  
 #pragma once
 #include <sys/inotify.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <unordered_map>
-#include <iostream>
-#include <fstream>
 #include "../FileTransfer/Module.h"
 
 namespace WPEFramework {
@@ -31,7 +32,8 @@ namespace Core {
             struct ICallback
             {
                 virtual ~ICallback() {}
-                virtual void Updated() = 0;
+                // For a watched directory, the name of the entry created in (or moved into) it, otherwise empty.
+                virtual void Updated(const string& name) = 0;
             };
 
         private:
@@ -64,11 +66,11 @@ namespace Core {
                             _callbacks.erase(index);
                         }
                     }
-                    void Notify()
+                    void Notify(const string& name)
                     {
                         std::list<ICallback *>::iterator index(_callbacks.begin());
                         while (index != _callbacks.end()) {
-                            (*index)->Updated();
+                            (*index)->Updated(name);
                             index++;
                         }
                     }
@@ -108,11 +110,15 @@ namespace Core {
             {
                 return (_notifyFd != -1);
             }
-            bool Register(ICallback *callback, const string &filename)
+            // Watches a file for changes, or a directory for entries created in or moved into it. Returns
+            // false if the watch could not be set, e.g. because the file does not exist (yet).
+            bool Register(ICallback *callback, const string &filename, const bool directory = false)
             {
                 ASSERT(_notifyFd != -1);
                 ASSERT(callback != nullptr);
 
+                bool result = false;
+
                 _adminLock.Lock();
 
                 Files::iterator index = _files.find(filename);
@@ -121,11 +127,15 @@ namespace Core {
                     ASSERT(loop != _observers.end());
 
                     loop->second.Register(callback);
+                    result = true;
                 }
                 else
                 {
-                    int fileFd = inotify_add_watch(_notifyFd, filename.c_str(), IN_CLOSE_WRITE);
+                    const uint32_t mask = (directory == true ? (IN_CREATE | IN_MOVED_TO) : (IN_MODIFY | IN_CLOSE_WRITE | IN_MOVE_SELF | IN_DELETE_SELF));
+                    int fileFd = inotify_add_watch(_notifyFd, filename.c_str(), mask);
                     if (fileFd >= 0) {
+                        result = true;
+
                         _files.emplace(std::piecewise_construct,
                                        std::forward_as_tuple(filename),
                                        std::forward_as_tuple(fileFd));
@@ -142,7 +152,7 @@ namespace Core {
 
                 _adminLock.Unlock();
 
-                return (IsValid());
+                return (result);
             }
             void Unregister(ICallback *callback, const string &filename)
             {
@@ -188,24 +198,29 @@ namespace Core {
             void Handle(const uint16_t events) override
             {
                 if ((events & POLLIN) != 0) {
-                    uint8_t eventBuffer[(sizeof(struct inotify_event) + NAME_MAX + 1)];
+                    // Room for a number of events per read, a busy file easily queues more than one.
+                    uint8_t eventBuffer[16 * (sizeof(struct inotify_event) + NAME_MAX + 1)] __attribute__((aligned(__alignof__(struct inotify_event))));
                     int length;
                     do
                     {
                         length = ::read(_notifyFd, eventBuffer, sizeof(eventBuffer));
-                        if (length > 0) {
-                            const struct inotify_event *event = reinterpret_cast<const struct inotify_event *>(eventBuffer);
+                        int offset = 0;
 
-                            _adminLock.Lock();
+                        _adminLock.Lock();
+
+                        while ((offset + static_cast<int>(sizeof(struct inotify_event))) <= length) {
+                            const struct inotify_event *event = reinterpret_cast<const struct inotify_event *>(&eventBuffer[offset]);
 
                             // Check if we have this entry..
                             Observers::iterator loop = _observers.find(event->wd);
                             if (loop != _observers.end()) {
-                                loop->second.Notify();
+                                loop->second.Notify(event->len > 0 ? string(event->name) : EMPTY_STRING);
                             }
 
-                            _adminLock.Unlock();
+                            offset += sizeof(struct inotify_event) + event->len;
                         }
+
+                        _adminLock.Unlock();
                     } while (length > 0);
                 }
             }
@@ -220,9 +235,13 @@ namespace Core {
 
 namespace Plugin
 {
+    // Follows a (log) file: new lines are read in large blocks from a file that stays open, and
+    // handed over one by one. Rotation and truncation of the file are dealt with.
     class FileObserver {
         private:
-            class Sink : public Core::FileSystemMonitor::ICallback, public Core::IDispatch {
+            static constexpr uint32_t ReadSize = 16 * 1024;
+
+            class Sink : public Core::FileSystemMonitor::ICallback {
                 public:
                     Sink() = delete;
                     Sink(const Sink &) = delete;
@@ -236,13 +255,9 @@ namespace Plugin
                     }
 
                 public:
-                    void Updated() override
-                    {
-                        _parent.Updated();
-                    }
-                    void Dispatch() override
+                    void Updated(const string& name) override
                     {
-                        _parent.Dispatch();
+                        _parent.Updated(name);
                     }
 
                 private:
@@ -253,17 +268,25 @@ namespace Plugin
             struct ICallback
             {
                 virtual ~ICallback() {}
-                virtual void NewLine(const string &) = 0;
+                // Without the line ending, only valid during the call.
+                virtual void NewLine(const char text[], const uint32_t length) = 0;
             };
 
         public:
             FileObserver(const FileObserver &) = delete;
             FileObserver &operator=(const FileObserver &) = delete;
             FileObserver()
-                : _job(Core::ProxyType<Sink>::Create(this))
+                : _sink(this)
+                , _job(*this)
                 , _callback(nullptr)
                 , _position(0)
                 , _path()
+                , _directory()
+                , _name()
+                , _fd(-1)
+                , _inode(0)
+                , _watching(false)
+                , _pending()
             {
             }
             ~FileObserver()
@@ -281,86 +304,208 @@ namespace Plugin
             {
                 ASSERT((_callback == nullptr) && (callback != nullptr));
 
-                if (fullFile == false) {
-                    _position = GetCurrentPosition(entry);
-                } else {
-                    _position = 0;
-                }
+                const size_t slash = entry.find_last_of('/');
 
                 _path = entry;
+                _directory = (slash == string::npos ? string(_T(".")) : (slash == 0 ? string(_T("/")) : entry.substr(0, slash)));
+                _name = (slash == string::npos ? entry : entry.substr(slash + 1));
                 _callback = callback;
-                Core::FileSystemMonitor::Instance().Register(&(*_job), _path);
+
+                // The directory reports the (re)appearance of the file, when it is rotated or not there yet.
+                Core::FileSystemMonitor::Instance().Register(&_sink, _directory, true);
+
+                Open(fullFile == false);
+                Watch();
             }
             void Unregister()
             {
                 ASSERT(_callback != nullptr);
 
                 // First make sure the dispatcher Job will longer be fired
-                Core::FileSystemMonitor::Instance().Unregister(&(*_job), _path);
+                Unwatch();
+                Core::FileSystemMonitor::Instance().Unregister(&_sink, _directory);
 
                 // Potentially the Job might still be waiting, let’s kill it
-                Core::IWorkerPool::Instance().Revoke(Core::proxy_cast<Core::IDispatchType<void> >(_job));
+                _job.Revoke();
 
+                Close();
                 _path = EMPTY_STRING;
-                _position = 0;
+                _directory = EMPTY_STRING;
+                _name = EMPTY_STRING;
+                _pending.clear();
                 _callback = nullptr;
             }
 
         private:
-            long int GetCurrentPosition(const string &filePath) const
+            // The file stays open in between changes. Without a file (yet), the next change opens it.
+            void Open(const bool atEnd)
             {
-                long int pos = 0;
-                std::ifstream file(filePath.c_str());
-                if (file) {
-                    file.seekg(0, file.end);
-                    pos = file.tellg();
+                struct stat info;
+
+                _fd = ::open(_path.c_str(), O_RDONLY | O_CLOEXEC);
+                _position = 0;
+                _inode = 0;
+
+                if ((_fd != -1) && (::fstat(_fd, &info) == 0)) {
+                    _inode = info.st_ino;
+                    if (atEnd == true) {
+                        _position = info.st_size;
+                    }
                 }
-                return pos;
             }
+            void Close()
+            {
+                if (_fd != -1) {
+                    ::close(_fd);
+                    _fd = -1;
+                }
+            }
+            // The watch on the file itself can only be set once the file exists.
+            void Watch()
+            {
+                if ((_watching == false) && (_fd != -1)) {
+                    _watching = Core::FileSystemMonitor::Instance().Register(&_sink, _path);
+                }
+            }
+            void Unwatch()
+            {
+                if (_watching == true) {
+                    Core::FileSystemMonitor::Instance().Unregister(&_sink, _path);
+                    _watching = false;
+                }
+            }
+            // Runs as a job, so never concurrently: changes reported while it runs submit it once more.
+            friend Core::ThreadPool::JobType<FileObserver&>;
             void Dispatch()
             {
-                std::ifstream file(_path);
-                if (file) {
-                    file.seekg(_position, file.beg);
-                    std::string str;
-                    while ((std::getline(file, str)) && (str.size() > 0)) {
-                        ASSERT(_callback != nullptr);
-                        _callback->NewLine(str);
+                struct stat info;
+
+                if (_fd == -1) {
+                    Open(false);
+                    Watch();
+                }
+
+                if (_fd != -1) {
+                    if ((::fstat(_fd, &info) == 0) && (info.st_size < _position)) {
+                        // Truncated, start all over.
+                        _position = 0;
+                        _pending.clear();
                     }
+
+                    Read();
+
+                    // If the file is moved away and its successor is not there yet, keep the old one. The
+                    // directory watch reports the successor once it is created or moved in.
+                    if ((::stat(_path.c_str(), &info) == 0) && (info.st_ino != _inode)) {
+                        // Rotated, the old file is read up to its end. Continue with the new one, from its start.
+                        if (_pending.empty() == false) {
+                            Line(_pending.data(), static_cast<uint32_t>(_pending.size()));
+                            _pending.clear();
+                        }
+
+                        // The watch went along with the old file.
+                        Unwatch();
+                        Close();
+                        Open(false);
+                        Watch();
+
+                        if (_fd != -1) {
+                            Read();
+                        }
+                    }
+                }
+            }
+            void Read()
+            {
+                char buffer[ReadSize];
+                ssize_t length;
+
+                while ((length = ::pread(_fd, buffer, sizeof(buffer), _position)) > 0) {
+                    const char* start = buffer;
+                    const char* const end = &(buffer[length]);
+                    const char* newline;
+
+                    _position += length;
+
+                    while ((newline = static_cast<const char*>(::memchr(start, '\n', (end - start)))) != nullptr) {
+                        if (_pending.empty() == true) {
+                            Line(start, static_cast<uint32_t>(newline - start));
+                        } else {
+                            _pending.append(start, (newline - start));
+                            Line(_pending.data(), static_cast<uint32_t>(_pending.size()));
+                            _pending.clear();
+                        }
+                        start = newline + 1;
+                    }
+
+                    // Keep an unfinished line for the next round, unless it keeps on growing.
+                    _pending.append(start, (end - start));
+
+                    if (_pending.size() >= ReadSize) {
+                        Line(_pending.data(), static_cast<uint32_t>(_pending.size()));
+                        _pending.clear();
+                    }
+                }
+            }
+            void Line(const char text[], uint32_t length)
+            {
+                if ((length > 0) && (text[length - 1] == '\r')) {
+                    length--;
+                }
+                if (length > 0) {
+                    ASSERT(_callback != nullptr);
+                    _callback->NewLine(text, length);
                 }
-                _position = GetCurrentPosition(_path);
             }
-            void Updated()
+            void Updated(const string& name)
             {
-                Core::IWorkerPool::Instance().Submit(Core::proxy_cast<Core::IDispatchType<void> >(_job));
+                // Of the directory, only the entry of the observed file is of interest. One job in flight
+                // is enough, it reads whatever was added in the mean time.
+                if ((name.empty() == true) || (name == _name)) {
+                    _job.Submit();
+                }
             }
 
         private:
-            const Core::ProxyType<Sink> _job;
+            Sink _sink;
+            Core::WorkerPool::JobType<FileObserver&> _job;
             ICallback *_callback;
-            long int _position;
+            off_t _position;
             string _path;
+            string _directory;
+            string _name;
+            int _fd;
+            ino_t _inode;
+            bool _watching;
+            string _pending;
         };
 
     class FileTransfer : public PluginHost::IPlugin {
         private:
 
-            static constexpr uint16_t MAX_BUFFER_LENGHT = 1024;
+            static constexpr uint16_t DATAGRAM_SIZE = 1472; // Fits an Ethernet MTU, after the IP and UDP headers
+            static constexpr uint32_t QUEUE_SIZE = 64 * 1024; // Power of 2, the offsets wrap around
             static constexpr uint16_t TIMEOUT_MS = 0;
 
+            // Lines, each followed by the terminator, are queued in a ring and sent packed: a datagram
+            // holds as many complete lines as fit. A line is only split over datagrams if it does not
+            // fit in one by itself. If the destination can not keep up, new lines are dropped.
             class TextChannel : public Core::SocketDatagram
             {
                 public:
                     TextChannel()
-                        : Core::SocketDatagram(false, Core::NodeId().Origin(), Core::NodeId(), MAX_BUFFER_LENGHT, 0)
-                        , _sendQueue()
-                        , _offset(0)
+                        : Core::SocketDatagram(false, Core::NodeId().Origin(), Core::NodeId(), DATAGRAM_SIZE, 0)
+                        , _adminLock()
+                        , _head(0)
+                        , _tail(0)
+                        , _dropped(0)
+                        , _terminator()
                     {
                     }
                     virtual ~TextChannel()
                     {
-                        _sendQueue.clear();
-                        _offset = 0;
+                        _head = 0;
+                        _tail = 0;
                         Close(Core::infinite);
                     }
 
@@ -373,12 +518,27 @@ namespace Plugin
                         Open(TIMEOUT_MS);
                     }
 
-                    void NewLine(const string& text)
+                    void NewLine(const char text[], const uint32_t length)
                     {
+                        const uint32_t markerSize = (static_cast<uint32_t>(_terminator.SizeOf()) * sizeof(TCHAR));
+                        bool trigger = false;
+
                         _adminLock.Lock();
 
-                        _sendQueue.emplace_back(text);
-                        bool trigger = (_sendQueue.size() == 1);
+                        if ((QUEUE_SIZE - (_head - _tail)) < (length + markerSize)) {
+                            _dropped++;
+                        }
+                        else {
+                            if (_dropped != 0) {
+                                TRACE_L1("Dropped %d lines, the destination can not keep up", _dropped);
+                                _dropped = 0;
+                            }
+
+                            trigger = (_head == _tail);
+
+                            Store(reinterpret_cast<const uint8_t*>(text), length);
+                            Store(reinterpret_cast<const uint8_t*>(_terminator.Marker()), markerSize);
+                        }
 
                         _adminLock.Unlock();
 
@@ -391,48 +551,35 @@ namespace Plugin
                     // Methods to extract and insert data into the socket buffers
                     uint16_t SendData(uint8_t *dataFrame, const uint16_t maxSendSize) override
                     {
-                        uint16_t result = 0;
-
                         _adminLock.Lock();
 
-                        if (_offset == static_cast<uint32_t>(~0)) {
-                            // We are done with this entry it has been sent!!! discard it.
-                            _sendQueue.pop_front();
-                            _offset = 0;
-                        }
-
-                        if (_sendQueue.size() > 0) {
-                            const string& sendObject = _sendQueue.front();
+                        const uint32_t available = (_head - _tail);
+                        uint32_t result = std::min(available, static_cast<uint32_t>(maxSendSize));
 
-                            // Do we still need to send data from the text..
-                            if (_offset < (sendObject.size() * sizeof(TCHAR))) {
-                                result = (((sendObject.size() * sizeof(TCHAR)) - _offset) > maxSendSize ? maxSendSize : ((sendObject.size() * sizeof(TCHAR)) - _offset));
+                        if (result < available) {
+                            // Only send complete lines, if there is at least one that fits.
+                            const uint8_t boundary = reinterpret_cast<const uint8_t*>(_terminator.Marker())[(_terminator.SizeOf() * sizeof(TCHAR)) - 1];
+                            uint32_t size = result;
 
-                                _offset += SendCharacters(dataFrame, &(sendObject.c_str()[(_offset / sizeof(TCHAR))]), (_offset % sizeof(TCHAR)), result);
+                            while ((size > 0) && (_queue[(_tail + size - 1) % QUEUE_SIZE] != boundary)) {
+                                size--;
                             }
+                            if (size > 0) {
+                                result = size;
+                            }
+                        }
 
-                            // See if we can write the closing marker
-                            if ((maxSendSize != result) && (_offset >= (sendObject.size() * sizeof(TCHAR))) && (_offset < ((sendObject.size() + (_terminator.SizeOf())) * sizeof(TCHAR)))) {
-                                uint8_t markerSize = (static_cast<uint8_t>(_terminator.SizeOf()) * sizeof(TCHAR));
-                                uint8_t markerOffset = ((sendObject.size() * sizeof(TCHAR)) - _offset);
-                                uint16_t size = ((markerSize - markerOffset) > (maxSendSize - result) ? (maxSendSize - result) : (markerSize - markerOffset));
-
-                                _offset += SendCharacters(&(dataFrame[result]), &(_terminator.Marker()[(markerOffset / sizeof(TCHAR))]), (markerOffset % sizeof(TCHAR)), size);
-                                result += size;
+                        const uint32_t start = (_tail % QUEUE_SIZE);
+                        const uint32_t first = std::min(result, (QUEUE_SIZE - start));
 
-                                if ((size + markerOffset) == markerSize) {
-                                    // Report as completed on the next run
-                                    _offset = static_cast<uint32_t>(~0);
-                                }
-                            }
+                        ::memcpy(dataFrame, &(_queue[start]), first);
+                        ::memcpy(&(dataFrame[first]), _queue, (result - first));
 
-                            // If we went through this entry we must have processed something....
-                            ASSERT(result != 0);
-                        }
+                        _tail += result;
 
                         _adminLock.Unlock();
 
-                        return (result);
+                        return (static_cast<uint16_t>(result));
                     }
                     uint16_t ReceiveData(uint8_t *dataFrame, const uint16_t receivedSize) override
                     {
@@ -444,18 +591,23 @@ namespace Plugin
                     {
                     }
 
-                    uint16_t SendCharacters(uint8_t *dataFrame, const TCHAR stream[], const uint8_t delta, const uint16_t total)
+                    void Store(const uint8_t data[], const uint32_t length)
                     {
-                        ASSERT(delta == 0);
-                        // Copying from an aligned position..
-                        ::memcpy(dataFrame, stream, total);
-                        return (total);
+                        const uint32_t start = (_head % QUEUE_SIZE);
+                        const uint32_t first = std::min(length, (QUEUE_SIZE - start));
+
+                        ::memcpy(&(_queue[start]), data, first);
+                        ::memcpy(_queue, &(data[first]), (length - first));
+
+                        _head += length;
                     }
 
                 private:
                     Core::CriticalSection _adminLock;
-                    std::list<string> _sendQueue;
-                    uint32_t _offset;
+                    uint8_t _queue[QUEUE_SIZE];
+                    uint32_t _head;
+                    uint32_t _tail;
+                    uint32_t _dropped;
                     Core::TerminatorCarriageReturn _terminator;
             };
 
@@ -474,11 +626,11 @@ namespace Plugin
                     OnChangeFile(const OnChangeFile &) = delete;
                     OnChangeFile &operator=(const OnChangeFile &) = delete;
 
-                    void NewLine(const string &text) override
+                    void NewLine(const char text[], const uint32_t length) override
                     {
                         _adminLock.Lock();
 
-                        _parent.NewLine(text);
+                        _parent.NewLine(text, length);
 
                         _adminLock.Unlock();
                     }
@@ -525,9 +677,10 @@ namespace Plugin
 
                 public:
                     Config()
-                        : FilePath(_T("/var/log/messages")), FullFile(false), Destination()
+                        : FilePath(_T("/var/log/messages")), Files(), FullFile(false), Destination()
                     {
                         Add(_T("filepath"), &FilePath);
+                        Add(_T("files"), &Files);
                         Add(_T("fullfile"), &FullFile);
                         Add(_T("destination"), &Destination);
                     }
@@ -535,6 +688,7 @@ namespace Plugin
 
                 public:
                     Core::JSON::String FilePath;
+                    Core::JSON::ArrayType<Core::JSON::String> Files; // Next to FilePath, sent over the same channel
                     Core::JSON::Boolean FullFile;
                     NetworkNode Destination;
             };
@@ -544,7 +698,7 @@ namespace Plugin
                 FileTransfer &operator=(const FileTransfer &) = delete;
                 FileTransfer()
                     : _logOutput()
-                    , _observer()
+                    , _observers()
                     , _fileUpdate(&_logOutput)
                 {
                 }
@@ -563,7 +717,7 @@ namespace Plugin
 
             private:
                 TextChannel _logOutput;
-                FileObserver _observer;
+                std::list<FileObserver> _observers;
                 OnChangeFile _fileUpdate;
     };
 } // namespace Plugin
@@ -55,6 +55,7 @@ namespace PluginHost {
             , _progressWaitTime(0)
             , _checkHash(false)
             , _isResumeSupported(false)
+            , _size(0)
             , _activity(*this)
         {
             // If we are going for HMAC, here we could set our secret...
@@ -116,16 +117,44 @@ namespace PluginHost {
         {
             return _isResumeSupported;
         }
+        // Size of the file, as reported by the server when the info was collected (0 if unknown).
+        uint64_t Size() const
+        {
+            return _size;
+        }
+
+        static bool HashStringToBytes(const string& hash, uint8_t hashHex[Crypto::HASH_SHA256])
+        {
+            bool status = true;
+
+            for (uint8_t i = 0; i < Crypto::HASH_SHA256; i++) {
+                char highNibble = hash.c_str()[i * 2];
+                char lowNibble = hash.c_str()[(i * 2) + 1];
+                if (isxdigit(highNibble) && isxdigit(lowNibble)) {
+                    std::string byteStr = hash.substr(i * 2, 2);
+                    hashHex[i] = static_cast<uint8_t>(strtol(byteStr.c_str(), nullptr, 16));
+                }
+                else {
+                    status = false;
+                    break;
+                }
+            }
+            return status;
+        }
 
     private:
         void InfoCollected(const uint32_t result, const Core::ProxyType<Web::Response>& info) override
         {
             _isResumeSupported = false;
+            _size = 0;
             if (result == Core::ERROR_NONE) {
                 if (info.IsValid() == true) {
                     if (info->AcceptRange.IsSet() == true && (info->AcceptRange.Value() == "bytes")) {
                         _isResumeSupported = true;
                     }
+                    if (info->ContentLength.IsSet() == true) {
+                        _size = info->ContentLength.Value();
+                    }
                     info.Release();
                 }
             }
@@ -168,25 +197,6 @@ namespace PluginHost {
             return (result);
         }
 
-        inline bool HashStringToBytes(const string& hash, uint8_t hashHex[Crypto::HASH_SHA256])
-        {
-            bool status = true;
-
-            for (uint8_t i = 0; i < Crypto::HASH_SHA256; i++) {
-                char highNibble = hash.c_str()[i * 2];
-                char lowNibble = hash.c_str()[(i * 2) + 1];
-                if (isxdigit(highNibble) && isxdigit(lowNibble)) {
-                    std::string byteStr = hash.substr(i * 2, 2);
-                    hashHex[i] = static_cast<uint8_t>(strtol(byteStr.c_str(), nullptr, 16));
-                }
-                else {
-                    status = false;
-                    break;
-                }
-            }
-	    return status;
-        }
-
         friend Core::ThreadPool::JobType<DownloadEngine&>;
         void Dispatch()
         {
@@ -234,6 +244,7 @@ namespace PluginHost {
 
         bool _checkHash;
         bool _isResumeSupported;
+        uint64_t _size;
         uint8_t _HMAC[Crypto::HASH_SHA256];
         Core::WorkerPool::JobType<DownloadEngine&> _activity;
     };
@@ -40,6 +40,37 @@ namespace Plugin {
         if (config.WaitTime.IsSet() == true) {
             _waitTime = config.WaitTime.Value();
         }
+        if (config.Connections.IsSet() == true) {
+            _connections = config.Connections.Value();
+        }
+        if ((config.ChunkSize.IsSet() == true) && (config.ChunkSize.Value() != 0)) {
+            _chunkSize = config.ChunkSize.Value() * 1024;
+        }
+        if (config.Flash.IsSet() == true) {
+            _flash = config.Flash.Value();
+            TRACE_L1("Flash location : [%s]\n", _flash.c_str());
+        }
+        if ((config.Buffers.IsSet() == true) && (config.Buffers.Value() != 0)) {
+            _buffers = config.Buffers.Value();
+        }
+
+        // The marker has to survive a reboot to be of any use, so it lives on persistent storage.
+        Core::Directory markerPath(service->PersistentPath().c_str());
+        if (markerPath.CreatePath() == true) {
+            _marker = service->PersistentPath() + FlashMarker;
+
+            if (Core::File(_marker).Exists() == true) {
+                if (_flash.empty() == true) {
+                    SYSLOG(Logging::Startup, (_T("An earlier firmware upgrade did not complete, no flash location to roll back")));
+                } else if (Flash(_flash, _marker).Rollback() == true) {
+                    SYSLOG(Logging::Startup, (_T("An earlier firmware upgrade of %s did not complete, it is rolled back"), _flash.c_str()));
+                } else {
+                    SYSLOG(Logging::Startup, (_T("An earlier firmware upgrade of %s did not complete, it could not be rolled back"), _flash.c_str()));
+                }
+            }
+        } else if (_flash.empty() == false) {
+            SYSLOG(Logging::Startup, (_T("No persistent storage, firmware will not be flashed while downloading")));
+        }
 
         string message;
         uint32_t status = ConvertMfrStatusToCore(mfrFWUpgradeInit());
@@ -85,6 +116,12 @@ namespace Plugin {
             _position = _storage.Core::File::Size() - 1;
         } else {
             _position = 0;
+
+            // Starting over, so whatever a segmented download left behind is of no use.
+            Core::File journal(_destination + Name + JournalExtension);
+            if (journal.Exists() == true) {
+                journal.Destroy();
+            }
         }
 
         _type = type;
@@ -108,18 +145,45 @@ namespace Plugin {
             Notifier notifier(this);
             PluginHost::DownloadEngine downloadEngine(&notifier, "", _interval);
 
-            status = (_position != 0)? Resume(downloadEngine):Download(downloadEngine);
+            // Flashing while downloading and fetching over several connections both need ranges, the
+            // server is asked only once whether it hands them out.
+            const bool flash = ((_flash.empty() == false) && (_marker.empty() == false));
+            const bool probe = ((flash == true) || (_connections > 1));
+            const uint32_t probed = (probe == true ? Probe(downloadEngine) : Core::ERROR_UNAVAILABLE);
+            const bool ranged = ((probed == Core::ERROR_NONE) && (downloadEngine.IsResumeSupported() == true));
+            const bool streamed = ((ranged == true) && (flash == true) && (downloadEngine.Size() != 0));
+
+            if (streamed == true) {
+                status = Stream(notifier, downloadEngine.Size());
+            } else if ((ranged == true) && (_connections > 1) && (downloadEngine.Size() > _chunkSize)) {
+                PluginHost::SegmentedDownloadEngine segmented(&notifier, _connections, _chunkSize, _interval);
+
+                status = Download(segmented, downloadEngine.Size());
+                segmented.Close();
+            } else if ((_position == 0) || (ranged == true)) {
+                status = Download(downloadEngine);
+            } else if (probe == false) {
+                status = Resume(downloadEngine);
+            } else {
+                status = (probed == Core::ERROR_NONE ? Core::ERROR_NOT_SUPPORTED : probed);
+                Status(UpgradeStatus::DOWNLOAD_ABORTED, status, 0);
+            }
             downloadEngine.Close();
 
-            if (status == Core::ERROR_NONE && (Status() != UpgradeStatus::UPGRADE_CANCELLED)) {
-                Install();
+            if ((status == Core::ERROR_NONE) && (Status() != UpgradeStatus::UPGRADE_CANCELLED)) {
+                if (streamed == true) {
+                    // The verified image is in the inactive slot already, writing it there was the installation.
+                    Status(UpgradeStatus::UPGRADE_COMPLETED, Core::ERROR_NONE, 100);
+                } else {
+                    Install(Name, _destination);
+                }
             }
         } else {
             Status(UpgradeStatus::DOWNLOAD_ABORTED, Core::ERROR_NOT_EXIST, 0);
         }
     }
 
-    void FirmwareControl::Install() {
+    void FirmwareControl::Install(const string& name, const string& path) {
         TRACE(Trace::Information, (string(__FUNCTION__)));
         //Setup callback handler;
         mfrUpgradeStatusNotify_t mfrNotifier;
@@ -128,7 +192,7 @@ namespace Plugin {
         mfrNotifier.cb = Callback;
 
         // Initiate image install
-        mfrError_t mfrStatus = mfrWriteImage(Name, _destination.c_str(), static_cast<mfrImageType_t>(_type), mfrNotifier);
+        mfrError_t mfrStatus = mfrWriteImage(name.c_str(), path.c_str(), static_cast<mfrImageType_t>(_type), mfrNotifier);
         if (mfrERR_NONE != mfrStatus) {
             Status(UpgradeStatus::INSTALL_ABORTED, ConvertMfrStatusToCore(mfrStatus), 0);
         } else {
@@ -186,5 +250,78 @@ namespace Plugin {
         return status;
     }
 
+    // Fetches the image over several connections, the server is known to hand out ranges.
+    uint32_t FirmwareControl::Download(PluginHost::SegmentedDownloadEngine& engine, const uint64_t size) {
+
+        TRACE(Trace::Information, (string(__FUNCTION__)));
+
+        // The chunk journal next to the image takes care of resuming.
+        uint32_t status = engine.Start(_source, _destination + Name, _hash, size);
+        if ((status == Core::ERROR_NONE) || (status == Core::ERROR_INPROGRESS)) {
+
+            Status(UpgradeStatus::DOWNLOAD_STARTED, ErrorType::ERROR_NONE, 0);
+            status = WaitForCompletion(_waitTime * 1000);
+        }
+
+        status = ((status != Core::ERROR_NONE)? status: DownloadStatus());
+        if (status == Core::ERROR_NONE) {
+            Status(UpgradeStatus::DOWNLOAD_COMPLETED, ErrorType::ERROR_NONE, 100);
+        } else {
+            Status(UpgradeStatus::DOWNLOAD_ABORTED, status, 0);
+        }
+        return status;
+    }
+
+    // Flash while downloading: the image never lands in the download directory, the chunks go
+    // from the buffers straight to the inactive slot. If the image is not complete, or its hash
+    // does not match, the slot is rolled back.
+    uint32_t FirmwareControl::Stream(Notifier& notifier, const uint64_t size) {
+
+        TRACE(Trace::Information, (string(__FUNCTION__)));
+
+        uint32_t status = Core::ERROR_OPENING_FAILED;
+        Flash flash(_flash, _marker);
+
+        if (flash.Open(_source) == true) {
+            PluginHost::SegmentedDownloadEngine streamer(&notifier, _connections, _chunkSize, _interval);
+
+            status = streamer.Stream(_source, _hash, size, flash, _buffers);
+            if ((status == Core::ERROR_NONE) || (status == Core::ERROR_INPROGRESS)) {
+
+                Status(UpgradeStatus::DOWNLOAD_STARTED, ErrorType::ERROR_NONE, 0);
+                status = WaitForCompletion(_waitTime * 1000);
+            }
+
+            status = ((status != Core::ERROR_NONE)? status: DownloadStatus());
+            streamer.Close();
+
+            if ((status == Core::ERROR_NONE) && (flash.Commit() == false)) {
+                status = Core::ERROR_WRITE_ERROR;
+            }
+            if (status != Core::ERROR_NONE) {
+                flash.Rollback();
+            }
+        }
+
+        if (status == Core::ERROR_NONE) {
+            Status(UpgradeStatus::DOWNLOAD_COMPLETED, ErrorType::ERROR_NONE, 100);
+        } else {
+            Status(UpgradeStatus::DOWNLOAD_ABORTED, status, 0);
+        }
+        return status;
+    }
+
+    uint32_t FirmwareControl::Probe(PluginHost::DownloadEngine& engine) {
+
+        uint32_t status = engine.CollectInfo(_source);
+        if ((status == Core::ERROR_NONE) || (status == Core::ERROR_INPROGRESS)) {
+
+            status = WaitForCompletion(_waitTime * 1000);
+            status = ((status != Core::ERROR_NONE)? status: DownloadStatus());
+        }
+
+        return status;
+    }
+
 } // namespace Plugin
 } // namespace WPEFramework
@@ -21,6 +21,7 @@
 
 #include "Module.h"
 #include "DownloadEngine.h"
+#include "SegmentedDownload.h"
 #include <interfaces/json/JsonData_FirmwareControl.h>
 
 #ifdef __cplusplus
@@ -73,7 +74,12 @@ namespace Plugin {
         };
     private:
         static constexpr const TCHAR* Name = "imageTemp";
+        static constexpr const TCHAR* JournalExtension = ".chunks";
+        static constexpr const TCHAR* FlashMarker = "imageFlash.pending";
         static int32_t constexpr WaitTime = Core::infinite;
+        static uint8_t constexpr Connections = 4;
+        static uint32_t constexpr ChunkSize = 4096; // In KB
+        static uint8_t constexpr Buffers = 4;
 
     private:
         class Config : public Core::JSON::Container {
@@ -86,10 +92,18 @@ namespace Plugin {
                 , Source()
                 , Download()
                 , WaitTime()
+                , Connections()
+                , ChunkSize()
+                , Flash()
+                , Buffers()
             {
                 Add(_T("source"), &Source);
                 Add(_T("download"), &Download);
                 Add(_T("waittime"), &WaitTime);
+                Add(_T("connections"), &Connections);
+                Add(_T("chunksize"), &ChunkSize);
+                Add(_T("flash"), &Flash);
+                Add(_T("buffers"), &Buffers);
             }
 
             ~Config() {}
@@ -98,6 +112,10 @@ namespace Plugin {
             Core::JSON::String Source;
             Core::JSON::String Download;
             Core::JSON::DecSInt32 WaitTime;
+            Core::JSON::DecUInt8 Connections;
+            Core::JSON::DecUInt32 ChunkSize;
+            Core::JSON::String Flash;
+            Core::JSON::DecUInt8 Buffers;
         };
 
         class Notifier : public INotifier {
@@ -128,6 +146,137 @@ namespace Plugin {
             FirmwareControl& _parent;
         };
 
+        // Writes a streamed image to its partition, the inactive slot, so nothing that is booted is touched
+        // while the image is downloading. Writing the slot is the installation, the image is not written a
+        // second time. The marker (on persistent storage) is put down before the first write and only
+        // removed once the whole image is written and verified. A slot that can not be trusted (failed
+        // download, bad hash, or a marker found at start up after a power loss) is rolled back: its start
+        // is wiped, so the platform does not take it for a bootable image, and the marker is removed.
+        class Flash : public PluginHost::SegmentedDownloadEngine::ISink {
+        private:
+            static constexpr uint32_t WipeSize = 4096;
+
+        public:
+            Flash() = delete;
+            Flash(const Flash&) = delete;
+            Flash& operator=(const Flash&) = delete;
+
+            Flash(const string& device, const string& marker)
+                : _device(device)
+                , _marker(marker)
+                , _fd(-1)
+            {
+            }
+            ~Flash() override
+            {
+                Close();
+            }
+
+        public:
+            bool Open(const string& source)
+            {
+                ASSERT(_fd == -1);
+
+                int fd = ::open(_marker.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+
+                if (fd != -1) {
+                    const bool marked = ((::write(fd, source.c_str(), source.length()) == static_cast<ssize_t>(source.length())) && (::fsync(fd) == 0));
+
+                    ::close(fd);
+
+                    if ((marked == true) && (SyncDirectory() == true)) {
+                        _fd = ::open(_device.c_str(), O_WRONLY | O_CLOEXEC);
+                    }
+                }
+                if (_fd == -1) {
+                    TRACE(Trace::Error, (_T("Could not prepare %s for flashing [%d]"), _device.c_str(), errno));
+                }
+
+                return (_fd != -1);
+            }
+            bool Write(const uint64_t offset, const uint8_t data[], const uint32_t length) override
+            {
+                uint32_t written = 0;
+
+                while (written < length) {
+                    const ssize_t size = ::pwrite(_fd, &data[written], length - written, offset + written);
+
+                    if (size > 0) {
+                        written += static_cast<uint32_t>(size);
+                    } else if ((size < 0) && (errno != EINTR)) {
+                        break;
+                    }
+                }
+
+                return (written == length);
+            }
+            // The image is complete and verified.
+            bool Commit()
+            {
+                const bool result = ((_fd != -1) && (::fsync(_fd) == 0));
+
+                Close();
+
+                if (result == true) {
+                    ::unlink(_marker.c_str());
+                    SyncDirectory();
+                }
+
+                return (result);
+            }
+            // The image is incomplete or did not verify.
+            bool Rollback()
+            {
+                uint8_t block[WipeSize];
+
+                Close();
+
+                ::memset(block, 0, sizeof(block));
+                _fd = ::open(_device.c_str(), O_WRONLY | O_CLOEXEC);
+
+                const bool result = ((_fd != -1) && (Write(0, block, sizeof(block)) == true) && (::fsync(_fd) == 0));
+
+                Close();
+
+                if (result == true) {
+                    ::unlink(_marker.c_str());
+                    SyncDirectory();
+                } else {
+                    TRACE(Trace::Error, (_T("Could not roll back %s [%d]"), _device.c_str(), errno));
+                }
+
+                return (result);
+            }
+            void Close()
+            {
+                if (_fd != -1) {
+                    ::close(_fd);
+                    _fd = -1;
+                }
+            }
+
+        private:
+            // Creating or removing the marker only counts once its directory entry is on storage.
+            bool SyncDirectory() const
+            {
+                const string::size_type slash = _marker.find_last_of('/');
+                const string directory(slash == string::npos ? string(_T(".")) : (slash == 0 ? string(_T("/")) : _marker.substr(0, slash)));
+                int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+                const bool result = ((fd != -1) && (::fsync(fd) == 0));
+
+                if (fd != -1) {
+                    ::close(fd);
+                }
+
+                return (result);
+            }
+
+        private:
+            const string _device;
+            const string _marker;
+            int _fd;
+        };
+
         class Upgrader : public Core::IDispatch {
         public:
             Upgrader() = delete;
@@ -172,6 +321,11 @@ namespace Plugin {
             , _interval(0)
             , _position(0)
             , _waitTime(WaitTime)
+            , _connections(Connections)
+            , _chunkSize(ChunkSize * 1024)
+            , _buffers(Buffers)
+            , _flash()
+            , _marker()
             , _downloadStatus(Core::ERROR_NONE)
             , _upgradeStatus(UpgradeStatus::NONE)
             , _installStatus()
@@ -261,9 +415,12 @@ namespace Plugin {
 
     private:
         void Upgrade();
-        void Install();
+        void Install(const string& name, const string& path);
         uint32_t Resume(PluginHost::DownloadEngine& engine);
         uint32_t Download(PluginHost::DownloadEngine& engine);
+        uint32_t Download(PluginHost::SegmentedDownloadEngine& engine, const uint64_t size);
+        uint32_t Stream(Notifier& notifier, const uint64_t size);
+        uint32_t Probe(PluginHost::DownloadEngine& engine);
 
         void RegisterAll();
         void UnregisterAll();
@@ -288,6 +445,10 @@ namespace Plugin {
             if (_storage.Exists()) {
                 _storage.Destroy();
             }
+            Core::File _journal(_destination + Name + JournalExtension);
+            if (_journal.Exists()) {
+                _journal.Destroy();
+            }
         }
         inline void ResetStatus()
         {
@@ -454,6 +615,11 @@ namespace Plugin {
 
         uint64_t _position;
         int32_t _waitTime;
+        uint8_t _connections;
+        uint32_t _chunkSize;
+        uint8_t _buffers;
+        string _flash;
+        string _marker;
         uint32_t _downloadStatus;
         UpgradeStatus _upgradeStatus;
         mfrUpgradeStatus_t _installStatus;
@@ -0,0 +1,984 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "Module.h"
+#include "DownloadEngine.h"
+
+#include <atomic>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace WPEFramework {
+namespace PluginHost {
+
+    // Remembers which chunks of a segmented download are on storage, so an interrupted download
+    // (even by a reboot) only fetches what is still missing. A chunk is only marked after its data
+    // is synced, so a marked chunk can be trusted.
+    //
+    // Layout: [header][one byte per chunk, non zero once the chunk is stored]
+    class ChunkJournal {
+    private:
+        static constexpr uint32_t Magic = 0x46434A31; // "FCJ1"
+
+        struct Header {
+            uint32_t Magic;
+            uint32_t ChunkSize;
+            uint64_t Size;
+            uint32_t Source; // Hash of the URL, a different image is a different download
+            uint32_t Reserved;
+        };
+
+    public:
+        ChunkJournal(const ChunkJournal&) = delete;
+        ChunkJournal& operator=(const ChunkJournal&) = delete;
+
+        ChunkJournal()
+            : _fileName()
+            , _fd(-1)
+            , _header()
+            , _done()
+        {
+        }
+        ~ChunkJournal()
+        {
+            Close();
+        }
+
+    public:
+        inline bool IsOpen() const
+        {
+            return (_fd != -1);
+        }
+        inline uint32_t Chunks() const
+        {
+            return (static_cast<uint32_t>(_done.size()));
+        }
+        inline bool IsDone(const uint32_t chunk) const
+        {
+            return (_done[chunk] != 0);
+        }
+        inline uint32_t ChunkSize() const
+        {
+            return (_header.ChunkSize);
+        }
+        // Continue the journal in the file if it describes the same download, start over otherwise.
+        // A journal that is continued keeps its own chunk size.
+        bool Open(const string& fileName, const string& source, const uint64_t size, const uint32_t chunkSize)
+        {
+            ASSERT(_fd == -1);
+            ASSERT(chunkSize != 0);
+
+            Header stored;
+
+            _fileName = fileName;
+            _fd = ::open(_fileName.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR);
+
+            if (_fd == -1) {
+                TRACE_L1("Could not open chunk journal %s [%d]", _fileName.c_str(), errno);
+            } else if ((::pread(_fd, &stored, sizeof(stored), 0) == sizeof(stored)) && (stored.Magic == Magic) && (stored.ChunkSize != 0) && (stored.Size == size) && (stored.Source == Hash(source))) {
+                _header = stored;
+                _done.assign(static_cast<uint32_t>((size + _header.ChunkSize - 1) / _header.ChunkSize), 0);
+
+                // Chunks beyond a short read were simply never marked.
+                ssize_t loaded = ::pread(_fd, _done.data(), _done.size(), sizeof(Header));
+                if (loaded < 0) {
+                    loaded = 0;
+                }
+                std::fill(_done.begin() + loaded, _done.end(), 0);
+            } else {
+                _header.Magic = Magic;
+                _header.ChunkSize = chunkSize;
+                _header.Size = size;
+                _header.Source = Hash(source);
+                _header.Reserved = 0;
+                _done.assign(static_cast<uint32_t>((size + chunkSize - 1) / chunkSize), 0);
+
+                if ((::ftruncate(_fd, 0) != 0) || (::pwrite(_fd, &_header, sizeof(_header), 0) != sizeof(_header)) || (::fdatasync(_fd) != 0)) {
+                    TRACE_L1("Could not start chunk journal %s [%d]", _fileName.c_str(), errno);
+                    Close();
+                }
+            }
+
+            return (_fd != -1);
+        }
+        void Close()
+        {
+            if (_fd != -1) {
+                ::close(_fd);
+                _fd = -1;
+            }
+            _done.clear();
+        }
+        void Destroy()
+        {
+            Close();
+            ::unlink(_fileName.c_str());
+        }
+        bool Done(const uint32_t chunk)
+        {
+            ASSERT(chunk < _done.size());
+
+            const uint8_t marker = 1;
+            const bool result = ((_fd != -1) && (::pwrite(_fd, &marker, sizeof(marker), sizeof(Header) + chunk) == sizeof(marker)) && (::fdatasync(_fd) == 0));
+
+            if (result == true) {
+                _done[chunk] = marker;
+            } else {
+                TRACE_L1("Could not mark chunk %d in %s [%d]", chunk, _fileName.c_str(), errno);
+            }
+
+            return (result);
+        }
+
+    private:
+        static uint32_t Hash(const string& text)
+        {
+            // FNV-1a
+            uint32_t result = 2166136261;
+
+            for (const TCHAR c : text) {
+                result = (result ^ static_cast<uint8_t>(c)) * 16777619;
+            }
+
+            return (result);
+        }
+
+    private:
+        string _fileName;
+        int _fd;
+        Header _header;
+        std::vector<uint8_t> _done;
+    };
+
+
+    // Fetches a file as byte ranges (chunks) over several connections at once. Every connection
+    // takes the lowest chunk nobody is working on, so the chunks complete roughly front to back and
+    // the SHA-256 can be computed while the download is running, whenever the chunks at the front
+    // are complete.
+    //
+    // A download either goes to a file, resumable through a ChunkJournal, or is streamed: the
+    // chunks are loaded in a bounded set of buffers and handed to a sink in order, on a thread of
+    // its own. A connection only takes a new chunk if there is a free buffer, so a slow sink holds
+    // back the download instead of filling up memory.
+    class SegmentedDownloadEngine {
+    public:
+        struct ISink {
+            virtual ~ISink() = default;
+            virtual bool Write(const uint64_t offset, const uint8_t data[], const uint32_t length) = 0;
+        };
+
+    private:
+        static constexpr uint32_t ProgressInterval = 1000; // In milliseconds
+        static constexpr uint16_t ProgressWaitTimeOut = 60; // In seconds
+        static constexpr uint8_t MaxAttempts = 5; // Per chunk
+        static constexpr uint16_t HashBlockSize = 32 * 1024;
+        static constexpr uint32_t NoChunk = ~0;
+
+        enum state : uint8_t {
+            MISSING,
+            LOADING,
+            STORED
+        };
+
+        class ResponseFactory {
+        public:
+            ResponseFactory() = delete;
+            ResponseFactory(const ResponseFactory&) = delete;
+            ResponseFactory& operator=(const ResponseFactory&) = delete;
+
+            ResponseFactory(const uint32_t)
+            {
+            }
+            ~ResponseFactory()
+            {
+            }
+
+        public:
+            Core::ProxyType<Web::Response> Element()
+            {
+                return (PluginHost::IFactories::Instance().Response());
+            }
+        };
+
+        // Puts the content of a range response straight into its place: a buffer or the file.
+        class ChunkBody : public Web::IBody {
+        private:
+            ChunkBody(const ChunkBody&) = delete;
+            ChunkBody& operator=(const ChunkBody&) = delete;
+
+        public:
+            ChunkBody()
+                : _fd(-1)
+                , _buffer(nullptr)
+                , _offset(0)
+                , _length(0)
+                , _written(0)
+                , _failed(false)
+            {
+            }
+            ~ChunkBody() override
+            {
+            }
+
+        public:
+            inline void Target(const int fd, uint8_t buffer[], const uint64_t offset, const uint32_t length)
+            {
+                _fd = fd;
+                _buffer = buffer;
+                _offset = offset;
+                _length = length;
+                _written = 0;
+                _failed = false;
+            }
+            inline void Clear()
+            {
+                _buffer = nullptr;
+                _length = 0;
+                _written = 0;
+            }
+            inline uint32_t Written() const
+            {
+                return (_written);
+            }
+            inline bool IsComplete() const
+            {
+                return ((_failed == false) && (_length != 0) && (_written == _length));
+            }
+
+        private:
+            uint32_t Serialize() const override
+            {
+                // This body is only used for inbound traffic.
+                ASSERT(false);
+                return (0);
+            }
+            uint32_t Deserialize() override
+            {
+                return (0);
+            }
+            void End() const override
+            {
+            }
+            uint16_t Serialize(uint8_t[], const uint16_t) const override
+            {
+                ASSERT(false);
+                return (0);
+            }
+            uint16_t Deserialize(const uint8_t stream[], const uint16_t length) override
+            {
+                const uint32_t written = _written;
+
+                // Whatever does not fit (or can not be written) is swallowed, the chunk is refetched.
+                if ((_failed == true) || ((written + length) > _length)) {
+                    _failed = true;
+                } else if (_buffer != nullptr) {
+                    ::memcpy(&_buffer[written], stream, length);
+                    _written = written + length;
+                } else if (::pwrite(_fd, stream, length, _offset + written) == length) {
+                    _written = written + length;
+                } else {
+                    _failed = true;
+                }
+
+                return (length);
+            }
+
+        private:
+            int _fd;
+            uint8_t* _buffer;
+            uint64_t _offset;
+            uint32_t _length;
+            std::atomic<uint32_t> _written; // Also read by the progress reporting
+            bool _failed;
+        };
+
+        class Segment : public Web::WebLinkType<Core::SocketStream, Web::Response, Web::Request, ResponseFactory> {
+        private:
+            typedef Web::WebLinkType<Core::SocketStream, Web::Response, Web::Request, ResponseFactory> BaseClass;
+
+        public:
+            Segment() = delete;
+            Segment(const Segment&) = delete;
+            Segment& operator=(const Segment&) = delete;
+
+            Segment(SegmentedDownloadEngine& parent, const Core::NodeId& remoteId, const string& host, const string& path)
+                : BaseClass(2, false, remoteId.AnyInterface(), remoteId, 1024, ((64 * 1024) - 1))
+                , _parent(parent)
+                , _request(Core::ProxyType<Web::Request>::Create())
+                , _body(Core::ProxyType<ChunkBody>::Create())
+                , _chunk(NoChunk)
+                , _loading(false)
+            {
+                _request->Verb = Web::Request::HTTP_GET;
+                _request->Path = path;
+                _request->Host = host;
+            }
+            ~Segment() override
+            {
+                Close(Core::infinite);
+            }
+
+        public:
+            // Connect, or take the next chunk if the connection is idle.
+            void Start()
+            {
+                if (IsOpen() == false) {
+                    Open(0);
+                } else {
+                    Next();
+                }
+            }
+            // Bytes of the current chunk that are already in.
+            inline uint32_t Loading() const
+            {
+                return (_body->Written());
+            }
+
+        private:
+            void LinkBody(Core::ProxyType<Web::Response>& response) override
+            {
+                // Anything but the range we asked for (an error page, the whole file) stays out.
+                if (response->ErrorCode == Web::STATUS_PARTIAL_CONTENT) {
+                    response->Body(Core::proxy_cast<Web::IBody>(_body));
+                }
+            }
+            void Send(const Core::ProxyType<Web::Request>&) override
+            {
+            }
+            void Received(Core::ProxyType<Web::Response>& response) override
+            {
+                const bool success = ((response->ErrorCode == Web::STATUS_PARTIAL_CONTENT) && (_body->IsComplete() == true));
+
+                Done(success);
+                Next();
+            }
+            void StateChange() override
+            {
+                if (IsOpen() == true) {
+                    Next();
+                } else {
+                    // Lost the connection halfway, the chunk goes back to the pool. The engine reopens
+                    // the connection on its next round, if there is anything left to do.
+                    Done(false);
+                }
+            }
+            // The engine also calls in (through Start) when buffers come free, so taking a chunk is
+            // guarded by the loading flag.
+            void Next()
+            {
+                bool idle = false;
+
+                if (_loading.compare_exchange_strong(idle, true) == true) {
+                    uint64_t offset;
+                    uint32_t length;
+                    uint8_t* buffer;
+
+                    if (_parent.Claim(_chunk, buffer, offset, length) == true) {
+                        _body->Target(_parent.Storage(), buffer, offset, length);
+                        _request->Range = _T("bytes=") + Core::NumberType<uint64_t>(offset).Text() + '-' + Core::NumberType<uint64_t>(offset + length - 1).Text();
+                        Submit(_request);
+                    } else {
+                        _loading = false;
+                    }
+                }
+            }
+            void Done(const bool success)
+            {
+                const uint32_t chunk = _chunk;
+
+                if ((chunk != NoChunk) && (_loading == true)) {
+                    _chunk = NoChunk;
+                    _body->Clear();
+                    _loading = false;
+                    _parent.Fetched(chunk, success);
+                }
+            }
+
+        private:
+            SegmentedDownloadEngine& _parent;
+            Core::ProxyType<Web::Request> _request;
+            Core::ProxyType<ChunkBody> _body;
+            uint32_t _chunk;
+            std::atomic<bool> _loading;
+        };
+
+        // Feeds the stored chunks to the sink, writing flash can take a while so it has a thread of
+        // its own instead of holding up the worker pool.
+        class Drain : public Core::Thread {
+        public:
+            Drain() = delete;
+            Drain(const Drain&) = delete;
+            Drain& operator=(const Drain&) = delete;
+
+            Drain(SegmentedDownloadEngine& parent)
+                : Core::Thread(Core::Thread::DefaultStackSize(), _T("FirmwareDrain"))
+                , _parent(parent)
+                , _signal(false, true)
+            {
+            }
+            ~Drain() override
+            {
+                Dispose();
+            }
+
+        public:
+            inline void Trigger()
+            {
+                _signal.SetEvent();
+            }
+            void Dispose()
+            {
+                Stop();
+                _signal.SetEvent();
+                Wait(Core::Thread::STOPPED | Core::Thread::BLOCKED, Core::infinite);
+            }
+
+        private:
+            uint32_t Worker() override
+            {
+                if (_signal.Lock(Core::infinite) == Core::ERROR_NONE) {
+                    _signal.ResetEvent();
+
+                    if (IsRunning() == true) {
+                        _parent.Flush();
+                    }
+                }
+
+                return (0);
+            }
+
+        private:
+            SegmentedDownloadEngine& _parent;
+            Core::Event _signal;
+        };
+
+    public:
+        SegmentedDownloadEngine() = delete;
+        SegmentedDownloadEngine(const SegmentedDownloadEngine&) = delete;
+        SegmentedDownloadEngine& operator=(const SegmentedDownloadEngine&) = delete;
+
+        SegmentedDownloadEngine(INotifier* notifier, const uint8_t connections, const uint32_t chunkSize, const uint16_t interval)
+            : _adminLock()
+            , _notifier(notifier)
+            , _connections(std::max(connections, static_cast<uint8_t>(1)))
+            , _chunkSize(chunkSize)
+            , _interval(interval)
+            , _size(0)
+            , _fd(-1)
+            , _journal()
+            , _sink(nullptr)
+            , _segments()
+            , _state()
+            , _attempts()
+            , _loaded()
+            , _pool()
+            , _queue()
+            , _hash()
+            , _hashed(0)
+            , _flushed(0)
+            , _stored(0)
+            , _transferred(0)
+            , _tick(0)
+            , _progressInterval(1)
+            , _progressWaitTime(0)
+            , _result(Core::ERROR_NONE)
+            , _reported(false)
+            , _checkHash(false)
+            , _drain(*this)
+            , _job(*this)
+        {
+            memset(_HMAC, 0, Crypto::HASH_SHA256);
+        }
+        ~SegmentedDownloadEngine()
+        {
+            Close();
+        }
+
+    public:
+        // Download to a file. The size is the one the server reported, the destination is
+        // preallocated to it. An earlier attempt at the same download is continued.
+        uint32_t Start(const string& locator, const string& destination, const string& hashValue, const uint64_t size)
+        {
+            Core::URL url(locator);
+            uint32_t result = Prepare(url, hashValue);
+
+            _adminLock.Lock();
+
+            if ((result == Core::ERROR_INPROGRESS) && (_fd == -1)) {
+                result = Core::ERROR_OPENING_FAILED;
+
+                _fd = ::open(destination.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+
+                if (_fd == -1) {
+                    TRACE_L1("Could not open %s [%d]", destination.c_str(), errno);
+                } else if (::ftruncate(_fd, size) != 0) {
+                    result = Core::ERROR_WRITE_ERROR;
+                } else if (_journal.Open(destination + _T(".chunks"), locator, size, _chunkSize) == true) {
+                    Layout(size, _journal.ChunkSize());
+
+                    uint32_t missing = 0;
+
+                    for (uint32_t index = 0; index < _state.size(); index++) {
+                        if (_journal.IsDone(index) == true) {
+                            _state[index] = STORED;
+                            _stored += Length(index);
+                        } else {
+                            missing++;
+                        }
+                    }
+
+                    TRACE(Trace::Information, (_T("Segmented download of %d chunks, %d already stored"), Chunks(), Chunks() - missing));
+
+                    Connect(url, missing);
+                    result = Core::ERROR_INPROGRESS;
+                }
+            }
+
+            _adminLock.Unlock();
+
+            if (result == Core::ERROR_INPROGRESS) {
+                Launch();
+            }
+
+            return (result);
+        }
+        // Stream to the sink, through the given number of chunk sized buffers. Always starts from
+        // the beginning, the sink gets every chunk exactly once and in order.
+        uint32_t Stream(const string& locator, const string& hashValue, const uint64_t size, ISink& sink, const uint8_t buffers)
+        {
+            Core::URL url(locator);
+            uint32_t result = Prepare(url, hashValue);
+
+            _adminLock.Lock();
+
+            if (result == Core::ERROR_INPROGRESS) {
+                ASSERT((_fd == -1) && (_sink == nullptr));
+
+                _sink = &sink;
+
+                Layout(size, _chunkSize);
+
+                for (uint8_t index = std::max(buffers, static_cast<uint8_t>(1)); index > 0; index--) {
+                    _pool.push_back(new uint8_t[_chunkSize]);
+                }
+
+                Connect(url, std::min(Chunks(), static_cast<uint32_t>(_pool.size())));
+
+                _drain.Run();
+            }
+
+            _adminLock.Unlock();
+
+            if (result == Core::ERROR_INPROGRESS) {
+                Launch();
+            }
+
+            return (result);
+        }
+        void Close()
+        {
+            // Nothing is reported once the engine is closed, so the connections going down do not
+            // kick the job again.
+            _adminLock.Lock();
+            if (_result == Core::ERROR_INPROGRESS) {
+                _result = Core::ERROR_ASYNC_ABORTED;
+            }
+            _reported = true;
+            _adminLock.Unlock();
+
+            _job.Revoke();
+
+            for (Segment* segment : _segments) {
+                delete segment;
+            }
+            _segments.clear();
+
+            _drain.Dispose();
+
+            _adminLock.Lock();
+            for (uint8_t* buffer : _loaded) {
+                delete[] buffer;
+            }
+            for (uint8_t* buffer : _pool) {
+                delete[] buffer;
+            }
+            _loaded.clear();
+            _pool.clear();
+            _queue.clear();
+            _sink = nullptr;
+
+            _journal.Close();
+            if (_fd != -1) {
+                ::close(_fd);
+                _fd = -1;
+            }
+            _adminLock.Unlock();
+        }
+
+    private:
+        inline int Storage() const
+        {
+            return (_fd);
+        }
+        inline uint32_t Chunks() const
+        {
+            return (static_cast<uint32_t>(_state.size()));
+        }
+        inline uint64_t Offset(const uint32_t chunk) const
+        {
+            return (static_cast<uint64_t>(chunk) * _chunkSize);
+        }
+        inline uint32_t Length(const uint32_t chunk) const
+        {
+            return (static_cast<uint32_t>(std::min(static_cast<uint64_t>(_chunkSize), _size - Offset(chunk))));
+        }
+        uint32_t Prepare(const Core::URL& url, const string& hashValue)
+        {
+            uint32_t result = (((url.IsValid() == true) && (url.Host().IsSet() == true)) ? Core::ERROR_INPROGRESS : Core::ERROR_INCORRECT_URL);
+
+            if (hashValue.empty() == false) {
+                if (DownloadEngine::HashStringToBytes(hashValue, _HMAC) == true) {
+                    _checkHash = true;
+                } else {
+                    result = Core::ERROR_INCORRECT_HASH;
+                }
+            }
+
+            return (result);
+        }
+        void Layout(const uint64_t size, const uint32_t chunkSize)
+        {
+            const uint32_t chunks = static_cast<uint32_t>((size + chunkSize - 1) / chunkSize);
+
+            _size = size;
+            _chunkSize = chunkSize;
+            _state.assign(chunks, MISSING);
+            _attempts.assign(chunks, 0);
+            _loaded.assign(chunks, nullptr);
+            _stored = 0;
+            _hashed = 0;
+            _flushed = 0;
+        }
+        void Connect(const Core::URL& url, const uint32_t missing)
+        {
+            const uint16_t port = (url.Port().IsSet() == true ? url.Port().Value() : 80);
+            const Core::NodeId remote(url.Host().Value().c_str(), port);
+            string path = '/' + (url.Path().IsSet() == true ? url.Path().Value() : string());
+
+            if (url.Query().IsSet() == true) {
+                path += '?' + url.Query().Value();
+            }
+
+            for (uint32_t index = std::min(static_cast<uint32_t>(_connections), missing); index > 0; index--) {
+                _segments.push_back(new Segment(*this, remote, url.Host().Value(), path));
+            }
+
+            _transferred = _stored;
+            _tick = 0;
+            _progressWaitTime = 0;
+            _result = Core::ERROR_INPROGRESS;
+            _reported = false;
+        }
+        void Launch()
+        {
+            for (Segment* segment : _segments) {
+                segment->Start();
+            }
+
+            // Right away, a resumed download first needs the stored prefix hashed again.
+            _job.Submit();
+        }
+        bool Claim(uint32_t& chunk, uint8_t*& buffer, uint64_t& offset, uint32_t& length)
+        {
+            bool result = false;
+
+            _adminLock.Lock();
+
+            if ((_result == Core::ERROR_INPROGRESS) && ((_sink == nullptr) || (_pool.empty() == false))) {
+                std::vector<uint8_t>::iterator index(std::find(_state.begin(), _state.end(), MISSING));
+
+                if (index != _state.end()) {
+                    *index = LOADING;
+                    chunk = static_cast<uint32_t>(index - _state.begin());
+                    offset = Offset(chunk);
+                    length = Length(chunk);
+                    buffer = nullptr;
+
+                    if (_sink != nullptr) {
+                        buffer = _pool.back();
+                        _pool.pop_back();
+                        _loaded[chunk] = buffer;
+                    }
+                    result = true;
+                }
+            }
+
+            _adminLock.Unlock();
+
+            return (result);
+        }
+        void Fetched(const uint32_t chunk, const bool success)
+        {
+            bool kick = false;
+
+            _adminLock.Lock();
+
+            if (_result == Core::ERROR_INPROGRESS) {
+                // On file, the data must be on storage before the journal says so.
+                if ((success == true) && ((_sink != nullptr) || ((::fdatasync(_fd) == 0) && (_journal.Done(chunk) == true)))) {
+                    _state[chunk] = STORED;
+                    _stored += Length(chunk);
+                    kick = (chunk == _hashed);
+                } else {
+                    _state[chunk] = MISSING;
+
+                    if (_loaded[chunk] != nullptr) {
+                        _pool.push_back(_loaded[chunk]);
+                        _loaded[chunk] = nullptr;
+                    }
+
+                    if (++_attempts[chunk] >= MaxAttempts) {
+                        TRACE(Trace::Error, (_T("Giving up on chunk %d after %d attempts"), chunk, _attempts[chunk]));
+                        _result = Core::ERROR_UNAVAILABLE;
+                        kick = true;
+                    }
+                }
+            }
+
+            _adminLock.Unlock();
+
+            if (kick == true) {
+                _job.Reschedule(Core::Time::Now());
+            }
+        }
+        // Drain thread: write what is queued to the sink and give the buffers back.
+        void Flush()
+        {
+            bool next = true;
+
+            while (next == true) {
+                uint32_t chunk = NoChunk;
+                uint8_t* buffer = nullptr;
+
+                _adminLock.Lock();
+                if ((_result == Core::ERROR_INPROGRESS) && (_queue.empty() == false)) {
+                    chunk = _queue.front();
+                    buffer = _loaded[chunk];
+                    _queue.pop_front();
+                }
+                _adminLock.Unlock();
+
+                next = (buffer != nullptr);
+
+                if (next == true) {
+                    const bool written = _sink->Write(Offset(chunk), buffer, Length(chunk));
+
+                    _adminLock.Lock();
+                    _loaded[chunk] = nullptr;
+                    _pool.push_back(buffer);
+                    if (written == true) {
+                        _flushed++;
+                    } else {
+                        TRACE(Trace::Error, (_T("Could not write chunk %d"), chunk));
+                        _result = Core::ERROR_WRITE_ERROR;
+                    }
+                    _adminLock.Unlock();
+
+                    // A buffer came free (idle connections can continue), or this was the last one.
+                    _job.Reschedule(Core::Time::Now());
+                }
+            }
+        }
+
+        friend Core::ThreadPool::JobType<SegmentedDownloadEngine&>;
+        void Dispatch()
+        {
+            uint32_t result = Advance();
+            const uint64_t now = Core::Time::Now().Ticks();
+
+            _adminLock.Lock();
+
+            if ((result == Core::ERROR_INPROGRESS) && (_result == Core::ERROR_INPROGRESS)) {
+                if ((_hashed == Chunks()) && ((_sink == nullptr) || (_flushed == Chunks()))) {
+                    _result = (((_checkHash == true) && (::memcmp(_hash.Result(), _HMAC, Crypto::HASH_SHA256) != 0)) ? Core::ERROR_UNAUTHENTICATED : Core::ERROR_NONE);
+                } else if (now >= _tick) {
+                    _tick = now + (ProgressInterval * Core::Time::TicksPerMillisecond);
+                    Progress();
+                }
+            } else if (_result == Core::ERROR_INPROGRESS) {
+                _result = result;
+            }
+
+            result = _result;
+
+            if ((result != Core::ERROR_INPROGRESS) && (_reported == false)) {
+                _reported = true;
+
+                if ((result == Core::ERROR_NONE) && (_journal.IsOpen() == true)) {
+                    _journal.Destroy();
+                }
+
+                _adminLock.Unlock();
+
+                if (_notifier != nullptr) {
+                    _notifier->NotifyStatus(result);
+                }
+            } else {
+                if (result == Core::ERROR_INPROGRESS) {
+                    Resume();
+                    _job.Schedule(Core::Time::Now().Add(ProgressInterval));
+                }
+                _adminLock.Unlock();
+            }
+        }
+        // Feed the stored chunks at the front to the hash, and when streaming, queue them for the
+        // sink. Only the job touches the hash.
+        uint32_t Advance()
+        {
+            uint32_t result = Core::ERROR_INPROGRESS;
+            uint8_t block[HashBlockSize];
+            const uint8_t* buffer = nullptr;
+            uint64_t offset = 0;
+            uint32_t length = 0;
+            bool next = true;
+
+            while ((next == true) && (result == Core::ERROR_INPROGRESS)) {
+                _adminLock.Lock();
+                next = ((_result == Core::ERROR_INPROGRESS) && (_hashed < Chunks()) && (_state[_hashed] == STORED));
+                if (next == true) {
+                    offset = Offset(_hashed);
+                    length = Length(_hashed);
+                    buffer = _loaded[_hashed];
+                }
+                _adminLock.Unlock();
+
+                while ((next == true) && (length > 0)) {
+                    const uint16_t size = static_cast<uint16_t>(std::min(length, static_cast<uint32_t>(HashBlockSize)));
+
+                    if (buffer != nullptr) {
+                        _hash.Input(buffer, size);
+                        buffer += size;
+                    } else if (::pread(_fd, block, size, offset) == size) {
+                        _hash.Input(block, size);
+                        offset += size;
+                    } else {
+                        TRACE(Trace::Error, (_T("Could not read back the download [%d]"), errno));
+                        result = Core::ERROR_READ_ERROR;
+                        next = false;
+                    }
+                    length -= size;
+                }
+
+                if (next == true) {
+                    _adminLock.Lock();
+                    if (_sink != nullptr) {
+                        _queue.push_back(_hashed);
+                    }
+                    _hashed++;
+                    _adminLock.Unlock();
+
+                    if (_sink != nullptr) {
+                        _drain.Trigger();
+                    }
+                }
+            }
+
+            return (result);
+        }
+        // Idle connections take on work again, connections that were lost are reopened.
+        void Resume()
+        {
+            if (std::find(_state.begin(), _state.end(), MISSING) != _state.end()) {
+                for (Segment* segment : _segments) {
+                    if ((segment->IsOpen() == true) || (segment->IsClosed() == true)) {
+                        segment->Start();
+                    }
+                }
+            }
+        }
+        // Report progress every interval and give up if nothing came in for a while.
+        void Progress()
+        {
+            uint64_t transferred = _stored;
+
+            for (Segment* segment : _segments) {
+                transferred += segment->Loading();
+            }
+
+            // Waiting for the sink to free up a buffer is not a stall of the download.
+            if ((transferred == _transferred) && ((_sink == nullptr) || (_pool.empty() == false))) {
+                _progressWaitTime++;
+            } else {
+                _progressWaitTime = 0;
+            }
+
+            if (_progressWaitTime == ProgressWaitTimeOut) {
+                TRACE(Trace::Error, (_T("Segmented download stalled, %d of %d chunks stored"), static_cast<uint32_t>(std::count(_state.begin(), _state.end(), STORED)), Chunks()));
+                _result = Core::ERROR_TIMEDOUT;
+            } else if ((_interval != 0) && (_progressInterval >= _interval)) {
+                if ((_notifier != nullptr) && (transferred > _transferred)) {
+                    _notifier->NotifyProgress(static_cast<uint32_t>(transferred));
+                }
+                _progressInterval = 1;
+            } else {
+                _progressInterval++;
+            }
+
+            _transferred = transferred;
+        }
+
+    private:
+        Core::CriticalSection _adminLock;
+        INotifier* _notifier;
+        const uint8_t _connections;
+        uint32_t _chunkSize;
+        const uint16_t _interval;
+        uint64_t _size;
+
+        int _fd;
+        ChunkJournal _journal;
+        ISink* _sink;
+        std::list<Segment*> _segments;
+        std::vector<uint8_t> _state;
+        std::vector<uint8_t> _attempts;
+        std::vector<uint8_t*> _loaded; // Streaming: the buffer a chunk is in, until the sink had it
+        std::vector<uint8_t*> _pool; // Streaming: free buffers
+        std::list<uint32_t> _queue; // Streaming: chunks for the sink, in order
+
+        Crypto::SHA256 _hash;
+        uint32_t _hashed; // Chunks fed to the hash
+        uint32_t _flushed; // Chunks the sink wrote
+        uint64_t _stored;
+        uint64_t _transferred;
+        uint64_t _tick;
+        uint16_t _progressInterval;
+        uint16_t _progressWaitTime;
+        uint32_t _result;
+        bool _reported;
+
+        bool _checkHash;
+        uint8_t _HMAC[Crypto::HASH_SHA256];
+        Drain _drain;
+        Core::WorkerPool::JobType<SegmentedDownloadEngine&> _job;
+    };
+}
+}
@@ -69,6 +69,7 @@ namespace Plugin {
             OPTION_RENEWALTIME = 58,
             OPTION_REBINDINGTIME = 59,
             OPTION_CLIENTIDENTIFIER = 61,
+            OPTION_RAPIDCOMMIT = 80, // RFC 4039
             OPTION_END = 255,
         };
 
@@ -125,6 +126,7 @@ namespace Plugin {
                 , leaseTime()
                 , renewalTime()
                 , rebindingTime()
+                , rapidCommit(false)
             {
             }
 
@@ -137,6 +139,7 @@ namespace Plugin {
                 , leaseTime()
                 , renewalTime()
                 , rebindingTime()
+                , rapidCommit(false)
             {
                 FromRAW(optionsData, length);    
             }
@@ -215,6 +218,9 @@ namespace Plugin {
                         ::memcpy(&rebindingTime, &optionsData[used], sizeof(rebindingTime));
                         rebindingTime = ntohl(rebindingTime);
                         break;
+                    case OPTION_RAPIDCOMMIT:
+                        rapidCommit = true;
+                        break;
                     }
 
                     /* move on to the next option. */
@@ -233,6 +239,7 @@ namespace Plugin {
             Core::OptionalType<uint32_t> leaseTime; /* lease time in seconds */
             Core::OptionalType<uint32_t> renewalTime; /* renewal time in seconds */
             Core::OptionalType<uint32_t> rebindingTime; /* rebinding time in seconds */
+            bool rapidCommit; /* the server committed the lease without an offer (RFC 4039) */
         };
         class Offer {
         public:
@@ -483,6 +490,25 @@ namespace Plugin {
         DHCPClient(const string& interfaceName, ICallback* callback);
         virtual ~DHCPClient();
 
+    public:
+        // Wait before a retransmission (RFC 2131, 4.1): the initial wait doubles with every retry, up to
+        // the ceiling, and is randomized by jitter percent of it either way, taken from the random value.
+        static uint32_t Backoff(const uint32_t initial, const uint32_t ceiling, const uint8_t retries, const uint8_t jitter, const uint32_t random)
+        {
+            uint32_t result = initial;
+            uint8_t steps = retries;
+
+            while ((steps-- != 0) && (result < ceiling)) {
+                result <<= 1;
+            }
+
+            result = std::min(result, ceiling);
+
+            const uint32_t spread = static_cast<uint32_t>((static_cast<uint64_t>(result) * jitter) / 100);
+
+            return (result - spread + (random % ((2 * spread) + 1)));
+        }
+
     public:
         bool HasActiveLease() const {
             return (_expired.IsValid() == true);
@@ -513,12 +539,18 @@ namespace Plugin {
 
                 if ((_state == RECEIVING) || (_state == IDLE)) {
 
+                    // A retransmission of a pending DISCOVER keeps its transaction id, so a late
+                    // offer on the previous transmission is still accepted.
+                    const bool retransmit = ((_state == RECEIVING) && (_modus == CLASSIFICATION_DISCOVER));
+
                     _state = SENDING;
                     _offer.Clear();
                     _expired = Core::Time();
                     _adminLock.Unlock();
 
-                    Crypto::Random(_xid);
+                    if (retransmit == false) {
+                        Crypto::Random(_xid);
+                    }
 
                     _modus = CLASSIFICATION_DISCOVER;
 
@@ -572,6 +604,45 @@ namespace Plugin {
 
             return (result);
         }
+        /* INIT-REBOOT (RFC 2131 section 4.3.2): confirm a lease we had before, without a server identifier. */
+        inline uint32_t Reboot(const Offer& offer) {
+
+            uint32_t result = Core::ERROR_OPENING_FAILED;
+
+            if ((SocketDatagram::IsOpen() == true) || (SocketDatagram::Open(Core::infinite, _interfaceName) == Core::ERROR_NONE)) {
+
+                result = Core::ERROR_INPROGRESS;
+                
+                _adminLock.Lock();
+
+                if ((_state == RECEIVING) || (_state == IDLE)) {
+
+                    const bool retransmit = ((_state == RECEIVING) && (_modus == CLASSIFICATION_REQUEST) && (_serverIdentifier == 0));
+
+                    _modus = CLASSIFICATION_REQUEST;
+                    _state = SENDING;
+                    _offer = offer;
+                    _serverIdentifier = 0;
+                    _expired = Core::Time();
+
+                    _adminLock.Unlock();
+
+                    if (retransmit == false) {
+                        Crypto::Random(_xid);
+                    }
+
+                    result = Core::ERROR_NONE;
+
+                    Core::SocketDatagram::Broadcast(true);
+                    Core::SocketDatagram::Trigger();
+                }
+                else {
+                    _adminLock.Unlock();
+                }
+            }
+
+            return (result);
+        }
         inline uint32_t Release()
         {
             uint32_t result = Core::ERROR_OPENING_FAILED;
@@ -705,6 +776,10 @@ namespace Plugin {
                 options[index++] = OPTION_ROUTER;
                 options[index++] = OPTION_DNS;
                 options[index++] = OPTION_BROADCASTADDRESS;
+
+                /* Allow a server to skip the OFFER/REQUEST and commit the lease directly (RFC 4039) */
+                options[index++] = OPTION_RAPIDCOMMIT;
+                options[index++] = 0;
             } else if (_modus == CLASSIFICATION_REQUEST) {
                 // required for usage in bridged networks
                 if (_serverIdentifier != 0) {
@@ -755,7 +830,25 @@ namespace Plugin {
                         }
                     case CLASSIFICATION_ACK: 
                         {
-                            if (xid == _xid) {
+                            if (xid != _xid) {
+                                TRACE_L1("Unknown Acknowledge XID encountered: %d", xid);
+                            }
+                            else if (_modus == CLASSIFICATION_DISCOVER) {
+                                // Only a Rapid Commit ACK can answer a DISCOVER, it replaces the OFFER/REQUEST round trip.
+                                if (options.rapidCommit == true) {
+
+                                    _offer = Offer(source, frame, options);
+
+                                    if (_offer.IsValid() == true) {
+                                        _expired = Core::Time::Now().Add(_offer.LeaseTime() * 1000);
+
+                                        _callback->Approved(_offer);
+
+                                        Close();
+                                    }
+                                }
+                            }
+                            else {
 
                                 _offer.Update(options); // Update if informations changed since offering
                                 
@@ -765,9 +858,6 @@ namespace Plugin {
 
                                 Close();
                             }
-                            else {
-                                TRACE_L1("Unknown Acknowledge XID encountered: %d", xid);
-                            }
                             break;
                         }
                     case CLASSIFICATION_NAK:
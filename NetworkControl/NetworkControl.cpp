@@ -57,6 +57,76 @@ namespace Plugin
         return (accessible);
     }
 
+    // Replace the content of a file in one go. The content goes to a temporary file next to it, which
+    // is renamed over the original, so readers never see a half written file. Only if the rename is
+    // impossible (a bind mounted file, or a temporary on another file system) the file is rewritten
+    // in place. On any other failure the original is left untouched.
+    static bool Replace(const string& fileName, const string& content)
+    {
+        bool result = false;
+        bool inPlace = false;
+
+#ifndef __WINDOWS__
+        // Keep a symlinked file (e.g. a resolv.conf pointing into /run) a symlink, replace its target.
+        char* resolved = ::realpath(fileName.c_str(), nullptr);
+        const string target(resolved != nullptr ? string(resolved) : fileName);
+        const string temporary(target + _T(".tmp"));
+        struct stat properties;
+        const mode_t mode = (::stat(target.c_str(), &properties) == 0 ? (properties.st_mode & 07777) : 0644);
+
+        ::free(resolved);
+
+        int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, mode);
+
+        if (fd == -1) {
+            TRACE_L1("Could not create %s, error: %d", temporary.c_str(), errno);
+        } else {
+            result = ((::fchmod(fd, mode) == 0) &&
+                      (::write(fd, content.c_str(), content.length()) == static_cast<ssize_t>(content.length())) &&
+                      (::fsync(fd) == 0));
+            ::close(fd);
+
+            if (result == false) {
+                TRACE_L1("Could not write %s, error: %d", temporary.c_str(), errno);
+            } else if (::rename(temporary.c_str(), target.c_str()) != 0) {
+                inPlace = ((errno == EBUSY) || (errno == EXDEV));
+                result = false;
+                TRACE_L1("Could not rename %s, error: %d", temporary.c_str(), errno);
+            } else {
+                // Make the rename itself survive a power loss.
+                const string::size_type slash = target.find_last_of('/');
+                const string directory(slash == string::npos ? string(_T(".")) : (slash == 0 ? string(_T("/")) : target.substr(0, slash)));
+
+                fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+                if ((fd == -1) || (::fsync(fd) != 0)) {
+                    TRACE_L1("Could not sync %s, error: %d", directory.c_str(), errno);
+                }
+                if (fd != -1) {
+                    ::close(fd);
+                }
+            }
+            if (result == false) {
+                ::unlink(temporary.c_str());
+            }
+        }
+#else
+        // No rename over an open file here, rewrite it in place.
+        inPlace = true;
+#endif
+
+        if (inPlace == true) {
+            Core::File file(fileName);
+
+            if (file.Create() == true) {
+                result = (file.Write(reinterpret_cast<const uint8_t*>(content.c_str()), static_cast<uint32_t>(content.length())) == content.length());
+                file.Close();
+            }
+        }
+
+        return (result);
+    }
+
 #ifdef __WINDOWS__
 #pragma warning(disable : 4355)
 #endif
@@ -70,7 +140,9 @@ namespace Plugin
         , _requiredSet()
         , _dhcpInterfaces()
         , _observer(*this)
+        , _publisher(*this)
         , _open(false)
+        , _started(0)
     {
         RegisterAll();
     }
@@ -90,6 +162,7 @@ namespace Plugin
         config.FromString(service->ConfigLine());
 
         _service = service;
+        _started = Core::Time::Now().Ticks();
         _skipURL = static_cast<uint8_t>(service->WebPrefix().length());
         _responseTime = config.TimeOut.Value();
         _retries = config.Retries.Value();
@@ -113,7 +186,7 @@ namespace Plugin
                     }
                 }
 
-                RefreshDNS();
+                _publisher.Mark(Publisher::RESOLVER);
             }
         }
 
@@ -202,6 +275,15 @@ namespace Plugin
     {
         // Stop observing.
         _observer.Close();
+
+        // Stop the engines first, they mark their leases for publishing.
+        for (std::pair<const string, DHCPEngine>& entry : _dhcpInterfaces) {
+            entry.second.Stop();
+        }
+
+        // Nothing can mark anymore, write out what is still pending before the interfaces are gone.
+        _publisher.Flush();
+
         _dns.clear();
         _dhcpInterfaces.clear();
         _service = nullptr;
@@ -390,23 +472,18 @@ namespace Plugin
     void NetworkControl::Save(const string& filename) 
     {
         if (filename.empty() == false) {
-            Core::File leaseFile(filename);
-
-            if (leaseFile.Create() == true) {
-                Store storage;
+            Store storage;
+            string content;
 
-                for (std::pair<const string, DHCPEngine>& entry : _dhcpInterfaces) {
-                    Entry& result = storage.Add();
-                    entry.second.Get(result);
-                }
-
-                if (storage.IElement::ToFile(leaseFile) == false) {
-                    TRACE(Trace::Warning, ("Error occured while trying to save dhcp lease to file!"));
-                } 
+            for (std::pair<const string, DHCPEngine>& entry : _dhcpInterfaces) {
+                Entry& result = storage.Add();
+                entry.second.Get(result);
+            }
 
-                leaseFile.Close();
-            } else {
-                TRACE(Trace::Warning, ("Failed to open leases file %s\n for saving", leaseFile.Name().c_str()));
+            if (storage.IElement::ToString(content) == false) {
+                TRACE(Trace::Warning, ("Error occured while trying to save dhcp lease to file!"));
+            } else if (Replace(filename, content) == false) {
+                TRACE(Trace::Warning, ("Failed to write leases file %s", filename.c_str()));
             }
         }
     }
@@ -519,6 +596,14 @@ namespace Plugin
         if (subSystem != nullptr) {
             if (subSystem->IsActive(PluginHost::ISubSystem::NETWORK) ^ fullSet) {
                 subSystem->Set(fullSet ? PluginHost::ISubSystem::NETWORK : PluginHost::ISubSystem::NOT_NETWORK, nullptr);
+
+                if ((fullSet == true) && (_started != 0)) {
+                    // Report the time it took from activation to a usable network, only the first time.
+                    SYSLOG(Logging::Startup, (_T("Network ready in %u ms, %u interfaces"),
+                        static_cast<uint32_t>((Core::Time::Now().Ticks() - _started) / Core::Time::TicksPerMillisecond),
+                        static_cast<uint32_t>(_dhcpInterfaces.size())));
+                    _started = 0;
+                }
             }
 
             subSystem->Release();
@@ -541,7 +626,7 @@ namespace Plugin
 
                 SetIP(adapter, Core::IPNode(offer.Address(), offer.Netmask()), offer.Gateway(), offer.Broadcast(), true);
                 
-                RefreshDNS();
+                _publisher.Mark(Publisher::RESOLVER);
 
                 TRACE_L1("New IP Granted for %s:", interfaceName.c_str());
                 TRACE_L1("     Source:    %s", offer.Source().HostAddress().c_str());
@@ -551,7 +636,7 @@ namespace Plugin
                 TRACE_L1("     DNS:       %d", offer.DNS().size());
                 TRACE_L1("     Netmask:   %d", offer.Netmask());
 
-                Save(_persistentStoragePath);
+                _publisher.Mark(Publisher::LEASES);
             }
         } else {
             TRACE_L1("Request accepted for nonexisting network interface!");
@@ -577,75 +662,63 @@ namespace Plugin
 
     void NetworkControl::RefreshDNS()
     {
-        Core::DataElementFile file(_dnsFile, Core::File::SHAREABLE|Core::File::USER_READ|Core::File::USER_WRITE|Core::File::USER_EXECUTE|Core::File::GROUP_READ|Core::File::GROUP_WRITE, 0);
+        const string startMarker((_T("#++SECTION: ")) + _service->Callsign() + '\n');
+        const string endMarker((_T("#--SECTION: ")) + _service->Callsign() + '\n');
+        string current;
 
-        if (file.IsValid() == false) {
-            SYSLOG(Logging::Notification, (_T("DNS functionality could NOT be updated [%s]"), _dnsFile.c_str()));
-        } else {
-            string data((_T("#++SECTION: ")) + _service->Callsign() + '\n');
-            string endMarker((_T("#--SECTION: ")) + _service->Callsign() + '\n');
-            uint16_t start = 0;
-            uint16_t end = 0;
-            uint16_t offset = 1;
-            uint8_t index = 0;
-
-            do {
-                index += offset - 1;
-                offset = 0;
-
-                // Find the first comparible character && check the remainder in the next step...
-                while ((index < file.Size()) && (file[index] != data[offset])) {
-                    index++;
-                }
-                while ((index < file.Size()) && (offset < data.length()) && (file[index] == data[offset])) {
-                    index++;
-                    offset++;
-                }
+        Core::File file(_dnsFile);
 
-            } while ((index < file.Size()) && (offset != data.length()));
+        if (file.Open(true) == true) {
+            uint8_t buffer[512];
+            uint32_t loaded;
 
-            start = index - offset;
-            offset = 1;
-
-            do {
-                index += offset - 1;
-                offset = 0;
+            while ((loaded = file.Read(buffer, sizeof(buffer))) != 0) {
+                current.append(reinterpret_cast<const char*>(buffer), loaded);
+            }
 
-                // Find the first comparible character && check the remainder in the next step...
-                while ((index < file.Size()) && (file[index] != endMarker[offset])) {
-                    index++;
-                }
-                while ((index < file.Size()) && (offset < endMarker.length()) && (file[index] == endMarker[offset])) {
-                    index++;
-                    offset++;
-                }
+            file.Close();
+        }
 
-            } while ((index < file.Size()) && (offset != endMarker.length()));
+        // Drop our previous section, the rest of the file is not ours to touch.
+        string data(current);
+        size_t start = data.find(startMarker);
 
-            end = index;
-            uint16_t reduction = end - start;
+        if (start != string::npos) {
+            size_t end = data.find(endMarker, start);
 
-            if (reduction != 0) {
-                // move everything after de marker, over the marker sections.
-                ::memcpy(&(file[start]), &file[end], static_cast<uint16_t>(file.Size()) - end);
-            }
+            data.erase(start, (end == string::npos ? string::npos : (end + endMarker.length()) - start));
+        }
 
-            offset = (static_cast<uint16_t>(file.Size()) - reduction);
+        std::list<Core::NodeId> servers;
+        DNS(servers);
 
-            std::list<Core::NodeId> servers;
-            DNS(servers);
+        data += startMarker;
+        for (const Core::NodeId& entry : servers) {
+            data += string(NAMESERVER, sizeof(NAMESERVER) - 1) + entry.HostAddress() + '\n';
+        }
+        data += endMarker;
 
-            for (const Core::NodeId& entry : servers) {
-                data += string(NAMESERVER, sizeof(NAMESERVER) - 1) + entry.HostAddress() + '\n';
+        if (data != current) {
+            if (Replace(_dnsFile, data) == false) {
+                SYSLOG(Logging::Notification, (_T("DNS functionality could NOT be updated [%s]"), _dnsFile.c_str()));
+            } else {
+                SYSLOG(Logging::Startup, (_T("DNS functionality updated [%s]"), _dnsFile.c_str()));
             }
+        }
+    }
 
-            data += endMarker;
-            file.Size(offset + data.length());
-            ::memcpy(&(file[offset]), data.c_str(), data.length());
-            file.Sync();
+    void NetworkControl::Publish(const uint8_t changes)
+    {
+        _adminLock.Lock();
 
-            SYSLOG(Logging::Startup, (_T("DNS functionality updated [%s]"), _dnsFile.c_str()));
+        if ((changes & Publisher::RESOLVER) != 0) {
+            RefreshDNS();
+        }
+        if ((changes & Publisher::LEASES) != 0) {
+            Save(_persistentStoragePath);
         }
+
+        _adminLock.Unlock();
     }
 
     void NetworkControl::Activity(const string& interfaceName)
@@ -832,6 +905,8 @@ namespace Plugin
         }
         _adminLock.Unlock();
 
+        _publisher.Mark(Publisher::RESOLVER);
+
         return Core::ERROR_NONE;
     }
 
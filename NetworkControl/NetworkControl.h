@@ -352,6 +352,75 @@ namespace Plugin {
             Core::WorkerPool::JobType<AdapterObserver&> _job;
         };
 
+        class Publisher {
+        private:
+            // Changes arriving within this window, e.g. the leases of several interfaces coming up at
+            // boot, are written out in one go.
+            static constexpr uint32_t SettleTime = 250;
+
+        public:
+            enum target : uint8_t {
+                RESOLVER = 0x01,
+                LEASES = 0x02
+            };
+
+        public:
+            Publisher() = delete;
+            Publisher(const Publisher&) = delete;
+            Publisher& operator=(const Publisher&) = delete;
+
+#ifdef __WINDOWS__
+#pragma warning(disable : 4355)
+#endif
+            Publisher(NetworkControl& parent)
+                : _parent(parent)
+                , _adminLock()
+                , _pending(0)
+                , _job(*this)
+            {
+            }
+#ifdef __WINDOWS__
+#pragma warning(default : 4355)
+#endif
+            ~Publisher() = default;
+
+        public:
+            void Mark(const target what)
+            {
+                _adminLock.Lock();
+
+                if (_pending == 0) {
+                    _job.Schedule(Core::Time::Now().Add(SettleTime));
+                }
+                _pending |= what;
+
+                _adminLock.Unlock();
+            }
+            void Flush()
+            {
+                _job.Revoke();
+
+                Dispatch();
+            }
+            void Dispatch()
+            {
+                _adminLock.Lock();
+                const uint8_t pending = _pending;
+                _pending = 0;
+                _adminLock.Unlock();
+
+                if (pending != 0) {
+                    _parent.Publish(pending);
+                }
+            }
+
+        private:
+            NetworkControl& _parent;
+            Core::CriticalSection _adminLock;
+            uint8_t _pending;
+            Core::WorkerPool::JobType<Publisher&> _job;
+        };
+
         class Config : public Core::JSON::Container {
         public:
             Config(const Config&) = delete;
@@ -388,7 +457,14 @@ namespace Plugin {
 
         class DHCPEngine : private DHCPClient::ICallback {
         private:
-            static constexpr uint32_t AckWaitTimeout = 1000; // 1 second is a life time for a server to respond!
+            // Retransmissions start fast and back off exponentially, up to the configured response time.
+            // They continue until the full retry budget (retries times the response time) is used up.
+            static constexpr uint32_t InitialTimeout = 250;
+            // Each wait is randomized by this percentage of it either way (RFC 2131, 4.1 suggests a second
+            // on waits of several seconds, a fixed second would swamp the first, short, waits).
+            static constexpr uint8_t Jitter = 25;
+            // Retransmissions of an INIT-REBOOT before giving up on the persisted lease.
+            static constexpr uint8_t RebootRetries = 2;
 
         public:
             DHCPEngine() = delete;
@@ -401,6 +477,8 @@ namespace Plugin {
              DHCPEngine(NetworkControl& parent, const string& interfaceName, const uint8_t waitTimeSeconds, const uint8_t maxRetries, const Entry& info)
                 : _parent(parent)
                 , _retries(0)
+                , _deadline(0)
+                , _reboot(false)
                 , _maxRetries(maxRetries)
                 , _handleTime(1000 * waitTimeSeconds)
                 , _client(interfaceName, this)
@@ -439,20 +517,30 @@ namespace Plugin {
             inline uint32_t Discover(const Core::NodeId& preferred)
             {
                 uint32_t result;
-                _retries = 0;
+                Start();
                 _job.Revoke();
+                _job.Schedule(Core::Time::Now().Add(Timeout()));
                 if ( (_offers.size() > 0) && (_offers.front().Address() == preferred) ) {
-                    _job.Schedule(Core::Time::Now().Add(AckWaitTimeout));
-                    result = _client.Request(_offers.front());
+                    // We have a persisted lease, INIT-REBOOT lets any server on the link confirm it.
+                    _reboot = true;
+                    result = _client.Reboot(_offers.front());
                 }
                 else {
+                    _reboot = false;
                     ClearLease();
-                    _job.Schedule(Core::Time::Now().Add(_handleTime));
                     result = _client.Discover(preferred);
                 }
 
                 return (result);
             }
+            // Nothing is sent, scheduled or reported anymore once this returns.
+            inline void Stop()
+            {
+                _job.Revoke();
+                _client.Close();
+                // An answer received before the socket was closed may have rescheduled the job.
+                _job.Revoke();
+            }
             inline void UpdateMAC(const uint8_t buffer[], const uint8_t size) 
             {
                 _client.UpdateMAC(buffer, size);
@@ -467,19 +555,27 @@ namespace Plugin {
                     _parent.Failed(_client.Interface());
                 }
                 else if (_client.HasActiveLease() == true) {
+                    _reboot = false;
+
                     // See if the lease time is over...
                     if (_client.Expired() <= Core::Time::Now()) {
-                        if (_retries++ >= _maxRetries){
+                        if (_retries == 0) {
+                            // First attempt to extend the lease, from here on the retry budget runs.
+                            Start();
+                        }
+
+                        if (Exhausted() == true) {
                             // Tried extending the lease but we did not get a response. Rediscover
-                            _retries = 0;
+                            Start();
                             ClearLease();
                             _client.Discover(Core::NodeId());
-                            _job.Schedule(Core::Time::Now().Add(_handleTime));
+                            _job.Schedule(Core::Time::Now().Add(Timeout()));
                         }
                         else {
                             // Start refreshing the Lease..
+                            _retries++;
                             _client.Request(_client.Lease());
-                            _job.Schedule(Core::Time::Now().Add(AckWaitTimeout));
+                            _job.Schedule(Core::Time::Now().Add(Timeout()));
                         }
                     }
                     else {
@@ -494,22 +590,38 @@ namespace Plugin {
                         _job.Schedule(_client.Expired());
                     }
                 }
+                else if (_reboot == true) {
+                    if ((_offers.size() > 0) && (_retries++ < std::min(static_cast<uint8_t>(RebootRetries), _maxRetries))) {
+                        // No confirmation of the persisted lease yet, try again.
+                        _client.Reboot(_offers.front());
+                    }
+                    else {
+                        // Rejected, or nobody cares to confirm it, fall back to a full DISCOVER.
+                        _reboot = false;
+                        Start();
+                        ClearLease();
+                        _client.Discover(Core::NodeId());
+                    }
+                    _job.Schedule(Core::Time::Now().Add(Timeout()));
+                }
                 else if (_offers.size() == 0) {
                     // Looks like the Discovers did not discover anything, should we retry ?
-                    if (_retries++ < _maxRetries) {
+                    if (Exhausted() == false) {
+                        _retries++;
                         ClearLease();
                         _client.Discover(Core::NodeId());
-                        _job.Schedule(Core::Time::Now().Add(_handleTime));
+                        _job.Schedule(Core::Time::Now().Add(Timeout()));
                     }
                     else {
                         _client.Close();
                         _parent.Failed(_client.Interface());
                     }
                 }
-                else if ( (_client.Lease() == _offers.front()) && (_retries++ < _maxRetries) ) {
+                else if ( (_client.Lease() == _offers.front()) && (Exhausted() == false) ) {
                     // Looks like the acknwledge did not get a reply, should we retry ?
+                    _retries++;
                     _client.Request(_client.Lease());
-                    _job.Schedule(Core::Time::Now().Add(AckWaitTimeout));
+                    _job.Schedule(Core::Time::Now().Add(Timeout()));
                 }
                 else {
                     if (_client.Lease() == _offers.front()) {
@@ -519,8 +631,8 @@ namespace Plugin {
 
                     if (_offers.size() == 0) {
                         // There is no valid offer, so request for new offer
-                        _retries = 0;
-                        _job.Schedule(Core::Time::Now().Add(_handleTime));
+                        Start();
+                        _job.Schedule(Core::Time::Now().Add(Timeout()));
                     }
                     else {
                         DHCPClient::Offer& node (_offers.front());
@@ -530,8 +642,8 @@ namespace Plugin {
 
                         // Seems we have some offers pending and we are not Active yet, request an ACK
                         _client.Request(node);
-                        _retries = 0;
-                        _job.Schedule(Core::Time::Now().Add(AckWaitTimeout));
+                        Start();
+                        _job.Schedule(Core::Time::Now().Add(Timeout()));
                     }
                 }
             }
@@ -573,6 +685,27 @@ namespace Plugin {
                 _settings.Clear();
             }
 
+        private:
+            // A new exchange gets the full retry budget, the time the fixed retries used to take.
+            void Start()
+            {
+                _retries = 0;
+                _deadline = Core::Time::Now().Ticks() + (static_cast<uint64_t>(_maxRetries) * _handleTime * Core::Time::TicksPerMillisecond);
+            }
+            bool Exhausted() const
+            {
+                return (Core::Time::Now().Ticks() >= _deadline);
+            }
+            uint32_t Timeout() const
+            {
+                uint32_t random;
+
+                // Clients that lost their server at the same time should not retransmit in lock step.
+                Crypto::Random(random);
+
+                return (DHCPClient::Backoff(InitialTimeout, _handleTime, _retries, Jitter, random));
+            }
+
         private:
             // Offered, Approved and Rejected all run on the communication thread, so be carefull !!
             void Offered(const DHCPClient::Offer& offer) override {
@@ -592,6 +725,7 @@ namespace Plugin {
             }
             void Rejected(const DHCPClient::Offer& offer) override {
                 _retries = _maxRetries;
+                _deadline = 0;
                 TRACE(Trace::Information, ("Rejected an Offer from: %s for %s", offer.Source().HostAddress().c_str(), offer.Address().HostAddress().c_str()));
                 _job.Reschedule(Core::Time::Now());
             }
@@ -600,6 +734,8 @@ namespace Plugin {
             NetworkControl& _parent;
             Core::CriticalSection _adminLock;
             uint8_t _retries;
+            uint64_t _deadline;
+            bool _reboot;
             uint8_t _maxRetries;
             uint32_t _handleTime;
             DHCPClient _client;
@@ -654,6 +790,7 @@ namespace Plugin {
         void Accepted(const string& interfaceName, const DHCPClient::Offer& offer);
         void Failed(const string& interfaceName);
         void RefreshDNS();
+        void Publish(const uint8_t changes);
         void Activity(const string& interface);
         void SubSystemValidation();
 
@@ -683,7 +820,9 @@ namespace Plugin {
         std::list<string> _requiredSet;
         std::map<const string, DHCPEngine> _dhcpInterfaces;
         AdapterObserver _observer;
+        Publisher _publisher;
         bool _open;
+        uint64_t _started;
     };
 
 } // namespace Plugin
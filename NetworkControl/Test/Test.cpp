@@ -0,0 +1,108 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Checks the DHCP retransmission backoff: the exponential growth, the ceiling and the jitter around
+// it. Returns the number of failed checks, so it can be run as is from a test script.
+
+#include "../DHCPClient.h"
+
+#include <cstdio>
+
+MODULE_NAME_DECLARATION(BUILD_REFERENCE)
+
+using namespace WPEFramework;
+
+static uint32_t _failures = 0;
+
+#define CHECK(condition)                                                                   \
+    do {                                                                                   \
+        if ((condition) == false) {                                                        \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            _failures++;                                                                   \
+        }                                                                                  \
+    } while (false)
+
+// The settings of the engine: 250 ms first wait, 5 s response time, 25% jitter.
+static constexpr uint32_t Initial = 250;
+static constexpr uint32_t Ceiling = 5000;
+static constexpr uint8_t Jitter = 25;
+
+static uint32_t Wait(const uint8_t retries, const uint32_t random)
+{
+    return (Plugin::DHCPClient::Backoff(Initial, Ceiling, retries, Jitter, random));
+}
+
+// The random value that lands in the middle of the jitter range of a wait.
+static uint32_t Centered(const uint32_t wait)
+{
+    return ((wait * Jitter) / 100);
+}
+
+static void Growth()
+{
+    const uint32_t expected[] = { 250, 500, 1000, 2000, 4000, 5000, 5000 };
+
+    for (uint8_t retries = 0; retries < (sizeof(expected) / sizeof(expected[0])); retries++) {
+        CHECK(Wait(retries, Centered(expected[retries])) == expected[retries]);
+        CHECK(Plugin::DHCPClient::Backoff(Initial, Ceiling, retries, 0, 12345) == expected[retries]);
+    }
+
+    // However many retries, the wait never passes the ceiling (plus jitter).
+    CHECK(Plugin::DHCPClient::Backoff(Initial, Ceiling, 255, 0, 0) == Ceiling);
+    CHECK(Wait(255, ~0u) <= (Ceiling + ((Ceiling * Jitter) / 100)));
+
+    // A ceiling below the first wait caps the first wait too.
+    CHECK(Plugin::DHCPClient::Backoff(Initial, 100, 0, 0, 0) == 100);
+}
+
+static void Spread()
+{
+    for (uint8_t retries = 0; retries < 8; retries++) {
+        const uint32_t base = Plugin::DHCPClient::Backoff(Initial, Ceiling, retries, 0, 0);
+        const uint32_t spread = (base * Jitter) / 100;
+        uint32_t lowest = ~0u;
+        uint32_t highest = 0;
+
+        for (uint32_t random = 0; random < 100000; random += 7) {
+            const uint32_t wait = Wait(retries, random * 2654435761u);
+
+            lowest = std::min(lowest, wait);
+            highest = std::max(highest, wait);
+        }
+
+        // The jitter scales with the wait: the first retransmissions are not swamped by it, and
+        // the whole range is used.
+        CHECK(lowest == (base - spread));
+        CHECK(highest == (base + spread));
+        CHECK(Wait(retries, 0) == (base - spread));
+        CHECK(Wait(retries, 2 * spread) == (base + spread));
+    }
+}
+
+int main()
+{
+    Growth();
+    Spread();
+
+    printf("NetworkControlBackoffTest: %s\n", (_failures == 0 ? "passed" : "FAILED"));
+
+    Core::Singleton::Dispose();
+
+    return (static_cast<int>(_failures));
+}
@@ -0,0 +1,304 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "Module.h"
+
+#include <atomic>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace WPEFramework {
+namespace Plugin {
+
+    // Log-linear (HDR style) latency histogram. Values below LinearRange get a bucket of their own,
+    // above that every power of two is split in SubBuckets equally sized buckets, so a reported
+    // percentile is never more than 1/SubBuckets (6.25%) off. Recording is lock free: a handful of
+    // relaxed atomic operations, no allocations.
+    class Histogram {
+    public:
+        static constexpr uint8_t SubBucketBits = 4;
+        static constexpr uint32_t SubBuckets = (1 << SubBucketBits);
+        static constexpr uint32_t LinearRange = (SubBuckets << 1);
+        static constexpr uint32_t Buckets = LinearRange + ((32 - (SubBucketBits + 1)) * SubBuckets);
+
+        // Non atomic copy of a histogram, to calculate on or to merge several histograms into.
+        class Snapshot {
+        public:
+            Snapshot()
+                : _count(0)
+                , _sum(0)
+                , _minimum(~0u)
+                , _maximum(0)
+            {
+                ::memset(_buckets, 0, sizeof(_buckets));
+            }
+            Snapshot(const Snapshot& copy) = default;
+            Snapshot& operator=(const Snapshot& rhs) = default;
+            ~Snapshot() = default;
+
+        public:
+            inline uint64_t Count() const
+            {
+                return (_count);
+            }
+            inline uint32_t Minimum() const
+            {
+                return (_count == 0 ? 0 : _minimum);
+            }
+            inline uint32_t Maximum() const
+            {
+                return (_maximum);
+            }
+            inline uint32_t Average() const
+            {
+                return (_count == 0 ? 0 : static_cast<uint32_t>(_sum / _count));
+            }
+            // The percentile is given in tenths of a percent (e.g. 999 for p99.9), so the common
+            // percentiles can be asked for without floating point.
+            uint32_t Percentile(const uint16_t permille) const
+            {
+                uint32_t result = 0;
+
+                if (_count > 0) {
+                    const uint64_t target = std::max(static_cast<uint64_t>(1), ((_count * permille) + 999) / 1000);
+                    uint64_t seen = 0;
+                    uint32_t index = 0;
+
+                    while ((index < Buckets) && (seen < target)) {
+                        seen += _buckets[index];
+                        index++;
+                    }
+
+                    // Report the highest value that falls in the bucket, but never beyond what was seen.
+                    result = std::min(std::max(UpperBound(index - 1), _minimum), _maximum);
+                }
+
+                return (result);
+            }
+            void Merge(const Snapshot& other)
+            {
+                for (uint32_t index = 0; index < Buckets; index++) {
+                    _buckets[index] += other._buckets[index];
+                }
+                _count += other._count;
+                _sum += other._sum;
+                _minimum = std::min(_minimum, other._minimum);
+                _maximum = std::max(_maximum, other._maximum);
+            }
+
+        private:
+            friend class Histogram;
+
+            uint64_t _buckets[Buckets];
+            uint64_t _count;
+            uint64_t _sum;
+            uint32_t _minimum;
+            uint32_t _maximum;
+        };
+
+    public:
+        Histogram(const Histogram&) = delete;
+        Histogram& operator=(const Histogram&) = delete;
+
+        Histogram()
+        {
+            Clear();
+        }
+        ~Histogram() = default;
+
+    public:
+        void Record(const uint32_t value)
+        {
+            _buckets[Index(value)].fetch_add(1, std::memory_order_relaxed);
+            _count.fetch_add(1, std::memory_order_relaxed);
+            _sum.fetch_add(value, std::memory_order_relaxed);
+
+            uint32_t current = _minimum.load(std::memory_order_relaxed);
+            while ((value < current) && (_minimum.compare_exchange_weak(current, value, std::memory_order_relaxed) == false)) {
+            }
+
+            current = _maximum.load(std::memory_order_relaxed);
+            while ((value > current) && (_maximum.compare_exchange_weak(current, value, std::memory_order_relaxed) == false)) {
+            }
+        }
+        void Clear()
+        {
+            for (uint32_t index = 0; index < Buckets; index++) {
+                _buckets[index].store(0, std::memory_order_relaxed);
+            }
+            _count.store(0, std::memory_order_relaxed);
+            _sum.store(0, std::memory_order_relaxed);
+            _minimum.store(~0u, std::memory_order_relaxed);
+            _maximum.store(0, std::memory_order_relaxed);
+        }
+        // Copy the current state, without stopping the recorders. A snapshot taken while recording
+        // might be off by the samples recorded during the copy, it is never reset by reading.
+        void Take(Snapshot& snapshot) const
+        {
+            for (uint32_t index = 0; index < Buckets; index++) {
+                snapshot._buckets[index] = _buckets[index].load(std::memory_order_relaxed);
+            }
+            snapshot._count = _count.load(std::memory_order_relaxed);
+            snapshot._sum = _sum.load(std::memory_order_relaxed);
+            snapshot._minimum = _minimum.load(std::memory_order_relaxed);
+            snapshot._maximum = _maximum.load(std::memory_order_relaxed);
+        }
+
+        // Index of the highest bit set, the value must not be 0.
+        static inline uint8_t HighestBit(const uint32_t value)
+        {
+            ASSERT(value != 0);
+#ifdef _MSC_VER
+            unsigned long index;
+            _BitScanReverse(&index, value);
+            return (static_cast<uint8_t>(index));
+#else
+            return (static_cast<uint8_t>(31 - __builtin_clz(value)));
+#endif
+        }
+        static inline uint32_t Index(const uint32_t value)
+        {
+            uint32_t result = value;
+
+            if (value >= LinearRange) {
+                const uint8_t magnitude = HighestBit(value);
+                const uint8_t shift = magnitude - SubBucketBits;
+
+                result = LinearRange + ((magnitude - (SubBucketBits + 1)) * SubBuckets) + ((value >> shift) - SubBuckets);
+            }
+
+            return (result);
+        }
+        static inline uint32_t UpperBound(const uint32_t index)
+        {
+            uint32_t result = index;
+
+            if (index >= LinearRange) {
+                const uint32_t offset = index - LinearRange;
+                const uint8_t shift = static_cast<uint8_t>((offset / SubBuckets) + 1);
+                const uint64_t upper = (static_cast<uint64_t>(SubBuckets + (offset % SubBuckets) + 1) << shift) - 1;
+
+                result = static_cast<uint32_t>(std::min(upper, static_cast<uint64_t>(~static_cast<uint32_t>(0))));
+            }
+
+            return (result);
+        }
+
+    private:
+        std::atomic<uint32_t> _buckets[Buckets];
+        std::atomic<uint64_t> _count;
+        std::atomic<uint64_t> _sum;
+        std::atomic<uint32_t> _minimum;
+        std::atomic<uint32_t> _maximum;
+    };
+
+    // A histogram over the last Slots x slot duration. Samples land in the slot of the current period;
+    // the first sample of a new period recycles the oldest slot. Recycling is not synchronized with
+    // concurrent recorders, so a sample recorded at the very edge of a period might get lost, which is
+    // acceptable for statistics and keeps the hot path free of locks.
+    template <const uint8_t SLOTS>
+    class WindowHistogramType {
+    private:
+        struct Slot {
+            std::atomic<uint32_t> Epoch;
+            Histogram Data;
+        };
+
+    public:
+        WindowHistogramType() = delete;
+        WindowHistogramType(const WindowHistogramType<SLOTS>&) = delete;
+        WindowHistogramType<SLOTS>& operator=(const WindowHistogramType<SLOTS>&) = delete;
+
+        // The window is given in seconds, it is spread over the slots.
+        WindowHistogramType(const uint16_t window)
+            : _period(Period(window))
+        {
+            for (uint8_t index = 0; index < SLOTS; index++) {
+                _slots[index].Epoch.store(0, std::memory_order_relaxed);
+            }
+        }
+        ~WindowHistogramType() = default;
+
+    public:
+        inline uint32_t Window() const
+        {
+            return (static_cast<uint32_t>((_period.load(std::memory_order_relaxed) * SLOTS) / (Core::Time::TicksPerMillisecond * 1000)));
+        }
+        // Change the window length, whatever was collected so far is dropped.
+        void Window(const uint16_t window)
+        {
+            _period.store(Period(window), std::memory_order_relaxed);
+            Clear();
+        }
+        void Record(const uint32_t value)
+        {
+            const uint32_t epoch = Epoch();
+            Slot& slot(_slots[epoch % SLOTS]);
+            uint32_t current = slot.Epoch.load(std::memory_order_acquire);
+
+            if ((current != epoch) && (slot.Epoch.compare_exchange_strong(current, epoch, std::memory_order_acq_rel) == true)) {
+                slot.Data.Clear();
+            }
+
+            slot.Data.Record(value);
+        }
+        void Clear()
+        {
+            for (uint8_t index = 0; index < SLOTS; index++) {
+                _slots[index].Epoch.store(0, std::memory_order_release);
+            }
+        }
+        // Merge all slots that are still within the window. Nothing is reset by reading.
+        void Take(Histogram::Snapshot& snapshot) const
+        {
+            const uint32_t epoch = Epoch();
+
+            for (uint8_t index = 0; index < SLOTS; index++) {
+                const Slot& slot(_slots[index]);
+                const uint32_t age = epoch - slot.Epoch.load(std::memory_order_acquire);
+
+                if (age < SLOTS) {
+                    Histogram::Snapshot part;
+                    slot.Data.Take(part);
+                    snapshot.Merge(part);
+                }
+            }
+        }
+
+    private:
+        inline uint32_t Epoch() const
+        {
+            // Epoch 0 marks a slot that was never used, so count from 1.
+            return (static_cast<uint32_t>(Core::Time::Now().Ticks() / _period.load(std::memory_order_relaxed)) + 1);
+        }
+        static inline uint64_t Period(const uint16_t window)
+        {
+            return (std::max(static_cast<uint64_t>(1), (static_cast<uint64_t>(window) * Core::Time::TicksPerMillisecond * 1000) / SLOTS));
+        }
+
+    private:
+        std::atomic<uint64_t> _period;
+        Slot _slots[SLOTS];
+    };
+}
+}
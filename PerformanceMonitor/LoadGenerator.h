@@ -0,0 +1,673 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "Module.h"
+#include "Measurements.h"
+
+namespace WPEFramework {
+namespace Plugin {
+
+    // Drives a number of concurrent JSON-RPC clients (HTTP keep-alive, over loopback) against a method
+    // of any plugin. Every package size is a separate step, for which the round trip latency of every
+    // call is recorded in a histogram, next to the per stage figures the framework collected.
+    class LoadGenerator {
+    public:
+        enum state {
+            IDLE,
+            RUNNING,
+            COMPLETED,
+            ABORTED
+        };
+
+        class Parameters : public Core::JSON::Container {
+        public:
+            Parameters(const Parameters&) = delete;
+            Parameters& operator=(const Parameters&) = delete;
+
+            Parameters()
+                : Core::JSON::Container()
+                , Callsign(_T("PerformanceMonitor"))
+                , Method(_T("exchange"))
+                , Params()
+                , Path(_T("/jsonrpc"))
+                , Clients(4)
+                , Requests(100)
+                , Sizes()
+                , Timeout(60)
+            {
+                Add(_T("callsign"), &Callsign);
+                Add(_T("method"), &Method);
+                Add(_T("params"), &Params);
+                Add(_T("path"), &Path);
+                Add(_T("clients"), &Clients);
+                Add(_T("requests"), &Requests);
+                Add(_T("sizes"), &Sizes);
+                Add(_T("timeout"), &Timeout);
+            }
+            ~Parameters() override
+            {
+            }
+
+        public:
+            Core::JSON::String Callsign;
+            Core::JSON::String Method;
+            Core::JSON::String Params; // Raw JSON parameters, if not set a buffer of the step size is sent
+            Core::JSON::String Path;
+            Core::JSON::DecUInt16 Clients;
+            Core::JSON::DecUInt32 Requests; // Per client, per package size
+            Core::JSON::ArrayType<Core::JSON::DecUInt32> Sizes;
+            Core::JSON::DecUInt16 Timeout; // In seconds, for the whole run
+        };
+
+        class Report : public Core::JSON::Container {
+        public:
+            // Average duration of every stage, as measured by the framework, for the calls of this step.
+            class StageData : public Core::JSON::Container {
+            public:
+                StageData& operator=(const StageData&) = delete;
+
+                StageData()
+                    : Core::JSON::Container()
+                {
+                    Init();
+                }
+                StageData(const StageData& copy)
+                    : Core::JSON::Container()
+                    , Serialization(copy.Serialization)
+                    , Deserialization(copy.Deserialization)
+                    , Execution(copy.Execution)
+                    , Threadpool(copy.Threadpool)
+                    , Communication(copy.Communication)
+                    , Total(copy.Total)
+                {
+                    Init();
+                }
+                ~StageData() override
+                {
+                }
+
+            private:
+                void Init()
+                {
+                    Add(_T("serialization"), &Serialization);
+                    Add(_T("deserialization"), &Deserialization);
+                    Add(_T("execution"), &Execution);
+                    Add(_T("threadpool"), &Threadpool);
+                    Add(_T("communication"), &Communication);
+                    Add(_T("total"), &Total);
+                }
+
+            public:
+                Core::JSON::DecUInt32 Serialization;
+                Core::JSON::DecUInt32 Deserialization;
+                Core::JSON::DecUInt32 Execution;
+                Core::JSON::DecUInt32 Threadpool;
+                Core::JSON::DecUInt32 Communication;
+                Core::JSON::DecUInt32 Total;
+            };
+
+            class ResultData : public Core::JSON::Container {
+            public:
+                ResultData& operator=(const ResultData&) = delete;
+
+                ResultData()
+                    : Core::JSON::Container()
+                {
+                    Init();
+                }
+                ResultData(const ResultData& copy)
+                    : Core::JSON::Container()
+                    , Size(copy.Size)
+                    , Requests(copy.Requests)
+                    , Errors(copy.Errors)
+                    , Duration(copy.Duration)
+                    , Throughput(copy.Throughput)
+                    , Latency(copy.Latency)
+                    , Stages(copy.Stages)
+                {
+                    Init();
+                }
+                ~ResultData() override
+                {
+                }
+
+            private:
+                void Init()
+                {
+                    Add(_T("size"), &Size);
+                    Add(_T("requests"), &Requests);
+                    Add(_T("errors"), &Errors);
+                    Add(_T("duration"), &Duration);
+                    Add(_T("throughput"), &Throughput);
+                    Add(_T("latency"), &Latency);
+                    Add(_T("stages"), &Stages);
+                }
+
+            public:
+                Core::JSON::DecUInt32 Size;
+                Core::JSON::DecUInt32 Requests;
+                Core::JSON::DecUInt32 Errors;
+                Core::JSON::DecUInt32 Duration; // In milliseconds
+                Core::JSON::DecUInt32 Throughput; // In requests per second
+                Measurements::StatisticsData Latency; // Round trip, in microseconds
+                StageData Stages;
+            };
+
+        public:
+            Report(const Report&) = delete;
+            Report& operator=(const Report&) = delete;
+
+            Report()
+                : Core::JSON::Container()
+                , State()
+                , Callsign()
+                , Method()
+                , Clients()
+                , Results()
+            {
+                Add(_T("state"), &State);
+                Add(_T("callsign"), &Callsign);
+                Add(_T("method"), &Method);
+                Add(_T("clients"), &Clients);
+                Add(_T("results"), &Results);
+            }
+            ~Report() override
+            {
+            }
+
+        public:
+            Core::JSON::EnumType<state> State;
+            Core::JSON::String Callsign;
+            Core::JSON::String Method;
+            Core::JSON::DecUInt16 Clients;
+            Core::JSON::ArrayType<ResultData> Results;
+        };
+
+    private:
+        class ResponseFactory {
+        public:
+            ResponseFactory() = delete;
+            ResponseFactory(const ResponseFactory&) = delete;
+            ResponseFactory& operator=(const ResponseFactory&) = delete;
+
+            ResponseFactory(const uint32_t)
+            {
+            }
+            ~ResponseFactory()
+            {
+            }
+
+        public:
+            Core::ProxyType<Web::Response> Element()
+            {
+                return (PluginHost::IFactories::Instance().Response());
+            }
+        };
+
+        class Client : public Web::WebLinkType<Core::SocketStream, Web::Response, Web::Request, ResponseFactory> {
+        private:
+            typedef Web::WebLinkType<Core::SocketStream, Web::Response, Web::Request, ResponseFactory> BaseClass;
+
+        public:
+            Client() = delete;
+            Client(const Client&) = delete;
+            Client& operator=(const Client&) = delete;
+
+            Client(LoadGenerator& parent, const Core::NodeId& remoteId, const string& path)
+                : BaseClass(2, false, remoteId.AnyInterface(), remoteId, 2048, 2048)
+                , _parent(parent)
+                , _request(Core::ProxyType<Web::Request>::Create())
+                , _message(Core::ProxyType<Web::TextBody>::Create())
+                , _remaining(0)
+                , _start(0)
+                , _waiting(false)
+            {
+                _request->Verb = Web::Request::HTTP_POST;
+                _request->Path = path;
+                _request->Host = remoteId.HostAddress();
+                _request->ContentType = Web::MIME_JSON;
+            }
+            ~Client() override
+            {
+                Close(Core::infinite);
+            }
+
+        public:
+            void Start(const string& message, const uint32_t requests)
+            {
+                *_message = message;
+                _request->Body<Web::TextBody>(_message);
+                _remaining = requests;
+
+                if (IsOpen() == true) {
+                    Next();
+                } else {
+                    Open(0);
+                }
+            }
+
+        private:
+            void LinkBody(Core::ProxyType<Web::Response>& response) override
+            {
+                response->Body(Core::ProxyType<Web::TextBody>::Create());
+            }
+            void Send(const Core::ProxyType<Web::Request>&) override
+            {
+            }
+            void Received(Core::ProxyType<Web::Response>& response) override
+            {
+                const uint64_t latency = Core::Time::Now().Ticks() - _start;
+                Core::ProxyType<const Web::TextBody> body(response->Body<Web::TextBody>());
+                const bool success = ((response->ErrorCode == Web::STATUS_OK) && ((body.IsValid() == false) || (body->find(_T("\"error\"")) == string::npos)));
+
+                _waiting = false;
+                _parent.Record(static_cast<uint32_t>(std::min(latency, static_cast<uint64_t>(~static_cast<uint32_t>(0)))), success);
+
+                if (_remaining > 0) {
+                    Next();
+                } else {
+                    _parent.Completed();
+                }
+            }
+            void StateChange() override
+            {
+                if (IsOpen() == true) {
+                    if ((_remaining > 0) && (_waiting == false)) {
+                        Next();
+                    }
+                } else if ((_remaining > 0) || (_waiting == true)) {
+                    // Lost the connection, whatever was not done counts as failed.
+                    _parent.Failed(_remaining + (_waiting == true ? 1 : 0));
+                    _remaining = 0;
+                    _waiting = false;
+                    _parent.Completed();
+                }
+            }
+            void Next()
+            {
+                _remaining--;
+                _waiting = true;
+                _start = Core::Time::Now().Ticks();
+                Submit(_request);
+            }
+
+        private:
+            LoadGenerator& _parent;
+            Core::ProxyType<Web::Request> _request;
+            Core::ProxyType<Web::TextBody> _message;
+            uint32_t _remaining;
+            uint64_t _start;
+            bool _waiting;
+        };
+
+        // Cumulative framework figures of one stage, to isolate the calls of a single step.
+        struct Baseline {
+            uint64_t Sum;
+            uint32_t Count;
+        };
+        enum stage {
+            SERIALIZATION,
+            DESERIALIZATION,
+            EXECUTION,
+            THREADPOOL,
+            COMMUNICATION,
+            TOTAL,
+            STAGES
+        };
+
+    public:
+        LoadGenerator(const LoadGenerator&) = delete;
+        LoadGenerator& operator=(const LoadGenerator&) = delete;
+
+#ifdef __WINDOWS__
+#pragma warning(disable : 4355)
+#endif
+        LoadGenerator(Measurements& measurements)
+            : _adminLock()
+            , _startLock()
+            , _measurements(measurements)
+            , _entry(nullptr)
+            , _state(IDLE)
+            , _clients()
+            , _callsign()
+            , _method()
+            , _params()
+            , _requests(0)
+            , _sizes()
+            , _step(0)
+            , _active(0)
+            , _errors(0)
+            , _stepStart(0)
+            , _deadline(0)
+            , _histogram()
+            , _results()
+            , _exportPath()
+            , _job(*this)
+        {
+        }
+#ifdef __WINDOWS__
+#pragma warning(default : 4355)
+#endif
+        ~LoadGenerator()
+        {
+            _job.Revoke();
+
+            Stop();
+
+            for (Client* client : _clients) {
+                delete client;
+            }
+        }
+
+    public:
+        uint32_t Start(const Parameters& parameters, const Core::NodeId& server, const string& exportPath)
+        {
+            uint32_t result = Core::ERROR_INPROGRESS;
+            std::vector<Client*> previous;
+
+            _startLock.Lock();
+
+            _adminLock.Lock();
+
+            if (_state != RUNNING) {
+                result = Core::ERROR_BAD_REQUEST;
+
+                if ((parameters.Clients.Value() > 0) && (parameters.Requests.Value() > 0) && (parameters.Callsign.Value().empty() == false) && (parameters.Method.Value().empty() == false)) {
+
+                    // Connections of a previous run are not reused, the target might be different.
+                    previous.swap(_clients);
+                    result = Core::ERROR_NONE;
+                }
+            }
+
+            _adminLock.Unlock();
+
+            // Closing a client waits for the communication thread, which might just be reporting on
+            // one of them and need our lock for it, so the old clients go without holding it.
+            for (Client* client : previous) {
+                delete client;
+            }
+
+            if (result == Core::ERROR_NONE) {
+                _adminLock.Lock();
+
+                for (uint16_t index = 0; index < parameters.Clients.Value(); index++) {
+                    _clients.push_back(new Client(*this, server, parameters.Path.Value()));
+                }
+
+                _callsign = parameters.Callsign.Value();
+                _method = parameters.Method.Value();
+                _entry = _measurements.Find(_callsign, _method);
+                _params = parameters.Params.Value();
+                _requests = parameters.Requests.Value();
+                _exportPath = exportPath;
+
+                _sizes.clear();
+                Core::JSON::ArrayType<Core::JSON::DecUInt32>::ConstIterator index(parameters.Sizes.Elements());
+                while (index.Next() == true) {
+                    _sizes.push_back(index.Current().Value());
+                }
+                if (_sizes.empty() == true) {
+                    _sizes.push_back(0);
+                }
+
+                _results.clear();
+                _step = 0;
+                _state = RUNNING;
+                const Core::Time deadline(Core::Time::Now().Add(parameters.Timeout.Value() * 1000));
+                _deadline = deadline.Ticks();
+
+                TRACE_L1("Starting load on %s.1.%s with %d clients", _callsign.c_str(), _method.c_str(), parameters.Clients.Value());
+
+                StartStep();
+
+                _job.Schedule(deadline);
+
+                _adminLock.Unlock();
+            }
+
+            _startLock.Unlock();
+
+            return (result);
+        }
+        void Stop()
+        {
+            _adminLock.Lock();
+
+            if (_state == RUNNING) {
+                _state = ABORTED;
+
+                for (Client* client : _clients) {
+                    client->Close(0);
+                }
+            }
+
+            _adminLock.Unlock();
+        }
+        void Get(Report& report) const
+        {
+            _adminLock.Lock();
+
+            report.State = _state;
+            report.Callsign = _callsign;
+            report.Method = _method;
+            report.Clients = static_cast<uint16_t>(_clients.size());
+
+            for (const Report::ResultData& entry : _results) {
+                report.Results.Add(entry);
+            }
+
+            _adminLock.Unlock();
+        }
+
+    private:
+        void Record(const uint32_t latency, const bool success)
+        {
+            _histogram.Record(latency);
+            _entry->Record(Measurements::ROUNDTRIP, latency);
+
+            if (success == false) {
+                _errors++;
+            }
+        }
+        void Failed(const uint32_t count)
+        {
+            _errors += count;
+        }
+        void Completed()
+        {
+            _adminLock.Lock();
+
+            ASSERT(_active > 0);
+
+            if ((--_active == 0) && (_state == RUNNING)) {
+                EndStep();
+
+                _step++;
+
+                if (_step < _sizes.size()) {
+                    StartStep();
+                } else {
+                    _state = COMPLETED;
+
+                    // Writing the results is not something to do on the communication thread, so
+                    // pull the pending timeout in.
+                    _job.Reschedule(Core::Time::Now());
+                }
+            }
+
+            _adminLock.Unlock();
+        }
+        void StartStep()
+        {
+            const uint32_t size = _sizes[_step];
+            string params(_params);
+
+            if (params.empty() == true) {
+                // Buffer information, as understood by the send/exchange methods of this plugin.
+                params = _T("{\"data\":\"") + string(size, 'A') + _T("\",\"length\":") + Core::NumberType<uint32_t>(size).Text() + _T("}");
+            }
+
+            const string message(_T("{\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"") + _callsign + _T(".1.") + _method + _T("\",\"params\":") + params + _T("}"));
+
+            Stages(size, _baseline);
+
+            _histogram.Clear();
+            _errors = 0;
+            _active = static_cast<uint32_t>(_clients.size());
+            _stepStart = Core::Time::Now().Ticks();
+
+            for (Client* client : _clients) {
+                client->Start(message, _requests);
+            }
+        }
+        void EndStep()
+        {
+            const uint64_t duration = Core::Time::Now().Ticks() - _stepStart;
+            Histogram::Snapshot snapshot;
+            Baseline current[STAGES];
+
+            _histogram.Take(snapshot);
+            Stages(_sizes[_step], current);
+
+            Report::ResultData result;
+
+            result.Size = _sizes[_step];
+            result.Requests = static_cast<uint32_t>(snapshot.Count());
+            result.Errors = _errors;
+            result.Duration = static_cast<uint32_t>(duration / 1000);
+            result.Throughput = static_cast<uint32_t>(duration == 0 ? 0 : ((snapshot.Count() * 1000000) / duration));
+            result.Latency.Set(snapshot);
+            result.Stages.Serialization = Delta(_baseline[SERIALIZATION], current[SERIALIZATION]);
+            result.Stages.Deserialization = Delta(_baseline[DESERIALIZATION], current[DESERIALIZATION]);
+            result.Stages.Execution = Delta(_baseline[EXECUTION], current[EXECUTION]);
+            result.Stages.Threadpool = Delta(_baseline[THREADPOOL], current[THREADPOOL]);
+            result.Stages.Communication = Delta(_baseline[COMMUNICATION], current[COMMUNICATION]);
+            result.Stages.Total = Delta(_baseline[TOTAL], current[TOTAL]);
+
+            _results.push_back(result);
+        }
+        static void Stages(const uint32_t size, Baseline baseline[STAGES])
+        {
+            const PluginHost::PerformanceAdministrator::Statistics& statistics(PluginHost::PerformanceAdministrator::Instance().Retrieve(size));
+
+            Fill(statistics.Serialization(), baseline[SERIALIZATION]);
+            Fill(statistics.Deserialization(), baseline[DESERIALIZATION]);
+            Fill(statistics.Execution(), baseline[EXECUTION]);
+            Fill(statistics.ThreadPool(), baseline[THREADPOOL]);
+            Fill(statistics.Communication(), baseline[COMMUNICATION]);
+            Fill(statistics.Total(), baseline[TOTAL]);
+        }
+        static inline void Fill(const PluginHost::PerformanceAdministrator::Statistics::Tuple& tuple, Baseline& baseline)
+        {
+            baseline.Count = static_cast<uint32_t>(tuple.Count());
+            baseline.Sum = static_cast<uint64_t>(tuple.Average()) * baseline.Count;
+        }
+        static inline uint32_t Delta(const Baseline& before, const Baseline& after)
+        {
+            return ((after.Count <= before.Count) || (after.Sum < before.Sum) ? 0 : static_cast<uint32_t>((after.Sum - before.Sum) / (after.Count - before.Count)));
+        }
+        void Export()
+        {
+            Report report;
+
+            Get(report);
+
+            Core::File jsonFile(_exportPath + _T("loadgenerator.json"));
+
+            if (jsonFile.Create() == true) {
+                report.IElement::ToFile(jsonFile);
+                jsonFile.Close();
+            }
+
+            Core::File csvFile(_exportPath + _T("loadgenerator.csv"));
+
+            if (csvFile.Create() == true) {
+                string text(_T("size,requests,errors,duration,throughput,minimum,average,p50,p90,p99,p999,maximum,serialization,deserialization,execution,threadpool,communication,total\n"));
+
+                Core::JSON::ArrayType<Report::ResultData>::ConstIterator index(report.Results.Elements());
+
+                while (index.Next() == true) {
+                    const Report::ResultData& entry(index.Current());
+                    const uint32_t values[] = {
+                        entry.Size.Value(), entry.Requests.Value(), entry.Errors.Value(), entry.Duration.Value(), entry.Throughput.Value(),
+                        entry.Latency.Minimum.Value(), entry.Latency.Average.Value(), entry.Latency.P50.Value(), entry.Latency.P90.Value(),
+                        entry.Latency.P99.Value(), entry.Latency.P999.Value(), entry.Latency.Maximum.Value(),
+                        entry.Stages.Serialization.Value(), entry.Stages.Deserialization.Value(), entry.Stages.Execution.Value(),
+                        entry.Stages.Threadpool.Value(), entry.Stages.Communication.Value(), entry.Stages.Total.Value()
+                    };
+
+                    for (uint8_t column = 0; column < (sizeof(values) / sizeof(uint32_t)); column++) {
+                        text += Core::NumberType<uint32_t>(values[column]).Text();
+                        text += (column == ((sizeof(values) / sizeof(uint32_t)) - 1) ? '\n' : ',');
+                    }
+                }
+
+                csvFile.Write(reinterpret_cast<const uint8_t*>(text.c_str()), static_cast<uint32_t>(text.length()));
+                csvFile.Close();
+            }
+        }
+
+        friend Core::ThreadPool::JobType<LoadGenerator&>;
+        void Dispatch()
+        {
+            _adminLock.Lock();
+
+            state current = _state;
+
+            if ((current == RUNNING) && (Core::Time::Now().Ticks() >= _deadline)) {
+                TRACE_L1("Load run did not complete in time, aborting");
+                _adminLock.Unlock();
+                Stop();
+            } else {
+                _adminLock.Unlock();
+
+                if ((current == COMPLETED) && (_exportPath.empty() == false)) {
+                    Export();
+                }
+            }
+        }
+
+    private:
+        mutable Core::CriticalSection _adminLock;
+        Core::CriticalSection _startLock; // Keeps concurrent starts apart while the old clients are closed
+        Measurements& _measurements;
+        Measurements::Entry* _entry;
+        state _state;
+        std::vector<Client*> _clients;
+        string _callsign;
+        string _method;
+        string _params;
+        uint32_t _requests;
+        std::vector<uint32_t> _sizes;
+        uint32_t _step;
+        uint32_t _active;
+        std::atomic<uint32_t> _errors;
+        uint64_t _stepStart;
+        uint64_t _deadline;
+        Histogram _histogram;
+        Baseline _baseline[STAGES];
+        std::list<Report::ResultData> _results;
+        string _exportPath;
+        Core::WorkerPool::JobType<LoadGenerator&> _job;
+    };
+}
+}
@@ -0,0 +1,271 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "Module.h"
+#include "Histogram.h"
+
+namespace WPEFramework {
+namespace Plugin {
+
+    // Latency distributions over a sliding window, per "callsign.method". Looking up an entry takes
+    // a lock, so recorders look it up once and keep the pointer; entries live as long as the registry
+    // is not reconfigured.
+    class Measurements {
+    public:
+        static constexpr uint8_t Slots = 12;
+
+        typedef WindowHistogramType<Slots> Window;
+
+        enum stage {
+            ROUNDTRIP, // As seen by a client, including the transport
+            EXECUTION // Inside the method implementation
+        };
+
+        class StatisticsData : public Core::JSON::Container {
+        public:
+            StatisticsData& operator=(const StatisticsData&) = delete;
+
+            StatisticsData()
+                : Core::JSON::Container()
+            {
+                Init();
+            }
+            StatisticsData(const StatisticsData& copy)
+                : Core::JSON::Container()
+                , Count(copy.Count)
+                , Minimum(copy.Minimum)
+                , Average(copy.Average)
+                , P50(copy.P50)
+                , P90(copy.P90)
+                , P99(copy.P99)
+                , P999(copy.P999)
+                , Maximum(copy.Maximum)
+            {
+                Init();
+            }
+            ~StatisticsData() override
+            {
+            }
+
+        public:
+            void Set(const Histogram::Snapshot& snapshot)
+            {
+                Count = static_cast<uint32_t>(snapshot.Count());
+                Minimum = snapshot.Minimum();
+                Average = snapshot.Average();
+                P50 = snapshot.Percentile(500);
+                P90 = snapshot.Percentile(900);
+                P99 = snapshot.Percentile(990);
+                P999 = snapshot.Percentile(999);
+                Maximum = snapshot.Maximum();
+            }
+
+        private:
+            void Init()
+            {
+                Add(_T("count"), &Count);
+                Add(_T("minimum"), &Minimum);
+                Add(_T("average"), &Average);
+                Add(_T("p50"), &P50);
+                Add(_T("p90"), &P90);
+                Add(_T("p99"), &P99);
+                Add(_T("p999"), &P999);
+                Add(_T("maximum"), &Maximum);
+            }
+
+        public:
+            Core::JSON::DecUInt32 Count;
+            Core::JSON::DecUInt32 Minimum;
+            Core::JSON::DecUInt32 Average;
+            Core::JSON::DecUInt32 P50;
+            Core::JSON::DecUInt32 P90;
+            Core::JSON::DecUInt32 P99;
+            Core::JSON::DecUInt32 P999;
+            Core::JSON::DecUInt32 Maximum;
+        };
+
+        class Data : public Core::JSON::Container {
+        public:
+            Data(const Data&) = delete;
+            Data& operator=(const Data&) = delete;
+
+            Data()
+                : Core::JSON::Container()
+                , Window()
+                , Roundtrip()
+                , Execution()
+            {
+                Add(_T("window"), &Window);
+                Add(_T("roundtrip"), &Roundtrip);
+                Add(_T("execution"), &Execution);
+            }
+            ~Data() override
+            {
+            }
+
+        public:
+            Core::JSON::DecUInt32 Window; // In seconds
+            StatisticsData Roundtrip; // In microseconds
+            StatisticsData Execution; // In microseconds
+        };
+
+        class Entry {
+        public:
+            Entry() = delete;
+            Entry(const Entry&) = delete;
+            Entry& operator=(const Entry&) = delete;
+
+            Entry(const uint16_t window)
+                : _roundtrip(window)
+                , _execution(window)
+            {
+            }
+            ~Entry() = default;
+
+        public:
+            inline void Record(const stage which, const uint32_t duration)
+            {
+                if (which == ROUNDTRIP) {
+                    _roundtrip.Record(duration);
+                } else {
+                    _execution.Record(duration);
+                }
+            }
+            void Clear()
+            {
+                _roundtrip.Clear();
+                _execution.Clear();
+            }
+            void Window(const uint16_t window)
+            {
+                _roundtrip.Window(window);
+                _execution.Window(window);
+            }
+            void Get(Data& data) const
+            {
+                Histogram::Snapshot roundtrip;
+                Histogram::Snapshot execution;
+
+                _roundtrip.Take(roundtrip);
+                _execution.Take(execution);
+
+                data.Window = _roundtrip.Window();
+                data.Roundtrip.Set(roundtrip);
+                data.Execution.Set(execution);
+            }
+
+        private:
+            Window _roundtrip;
+            Window _execution;
+        };
+
+    public:
+        Measurements(const Measurements&) = delete;
+        Measurements& operator=(const Measurements&) = delete;
+
+        Measurements()
+            : _adminLock()
+            , _window(60)
+            , _entries()
+        {
+        }
+        ~Measurements()
+        {
+            Reset();
+        }
+
+    public:
+        // Entries are never dropped while the registry exists (the load generator and the plugin hold on
+        // to them), so they are reconfigured, and emptied, in place.
+        void Configure(const uint16_t window)
+        {
+            _adminLock.Lock();
+
+            _window = (window == 0 ? 1 : window);
+
+            for (std::pair<const string, Entry*>& entry : _entries) {
+                entry.second->Window(_window);
+            }
+
+            _adminLock.Unlock();
+        }
+        Entry* Find(const string& callsign, const string& method)
+        {
+            const string key(callsign + '.' + method);
+
+            _adminLock.Lock();
+
+            std::unordered_map<string, Entry*>::iterator index(_entries.find(key));
+
+            if (index == _entries.end()) {
+                index = _entries.emplace(key, new Entry(_window)).first;
+            }
+
+            Entry* result = index->second;
+
+            _adminLock.Unlock();
+
+            return (result);
+        }
+        uint32_t Get(const string& key, Data& data) const
+        {
+            uint32_t result = Core::ERROR_UNKNOWN_KEY;
+
+            _adminLock.Lock();
+
+            std::unordered_map<string, Entry*>::const_iterator index(_entries.find(key));
+
+            if (index != _entries.end()) {
+                index->second->Get(data);
+                result = Core::ERROR_NONE;
+            }
+
+            _adminLock.Unlock();
+
+            return (result);
+        }
+        void Clear()
+        {
+            _adminLock.Lock();
+
+            for (std::pair<const string, Entry*>& entry : _entries) {
+                entry.second->Clear();
+            }
+
+            _adminLock.Unlock();
+        }
+
+    private:
+        void Reset()
+        {
+            for (std::pair<const string, Entry*>& entry : _entries) {
+                delete entry.second;
+            }
+            _entries.clear();
+        }
+
+    private:
+        mutable Core::CriticalSection _adminLock;
+        uint16_t _window;
+        std::unordered_map<string, Entry*> _entries;
+    };
+}
+}
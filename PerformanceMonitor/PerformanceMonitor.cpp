@@ -20,6 +20,16 @@
 #include "PerformanceMonitor.h"
 
 namespace WPEFramework {
+
+ENUM_CONVERSION_BEGIN(Plugin::LoadGenerator::state)
+
+    { Plugin::LoadGenerator::IDLE, _TXT("idle") },
+    { Plugin::LoadGenerator::RUNNING, _TXT("running") },
+    { Plugin::LoadGenerator::COMPLETED, _TXT("completed") },
+    { Plugin::LoadGenerator::ABORTED, _TXT("aborted") },
+
+    ENUM_CONVERSION_END(Plugin::LoadGenerator::state);
+
 namespace Plugin {
 
     SERVICE_REGISTRATION(PerformanceMonitor, 1, 0);
@@ -32,11 +42,26 @@ namespace Plugin {
         ASSERT(service != nullptr);
         _skipURL = static_cast<uint8_t>(service->WebPrefix().length());
 
+        // The load generator talks to this framework instance, over the loopback.
+        Core::URL url(service->Accessor());
+        _server = Core::NodeId(_T("127.0.0.1"), (url.Port().IsSet() == true ? url.Port().Value() : 80));
+        _exportPath = service->VolatilePath();
+
+        _measurements.Configure(config.Window.Value());
+        _send = _measurements.Find(service->Callsign(), _T("send"));
+        _receive = _measurements.Find(service->Callsign(), _T("receive"));
+        _exchange = _measurements.Find(service->Callsign(), _T("exchange"));
+
         return string();
     }
 
     /* virtual */ void PerformanceMonitor::Deinitialize(PluginHost::IShell* service)
     {
+        _loadGenerator.Stop();
+
+        _send = nullptr;
+        _receive = nullptr;
+        _exchange = nullptr;
     }
 
     /* virtual */ string PerformanceMonitor::Information() const
@@ -20,6 +20,7 @@
 #pragma once
 
 #include "Module.h"
+#include "LoadGenerator.h"
 
 #include <interfaces/json/JsonData_PerformanceMonitor.h>
 
@@ -27,6 +28,26 @@ namespace WPEFramework {
 namespace Plugin {
 
     class PerformanceMonitor : public PluginHost::IPlugin, public PluginHost::JSONRPC {
+    private:
+        class Config : public Core::JSON::Container {
+        public:
+            Config(const Config&) = delete;
+            Config& operator=(const Config&) = delete;
+
+            Config()
+                : Core::JSON::Container()
+                , Window(60)
+            {
+                Add(_T("window"), &Window);
+            }
+            ~Config() override
+            {
+            }
+
+        public:
+            Core::JSON::DecUInt16 Window; // Sliding window of the latency distributions, in seconds
+        };
+
     public:
         PerformanceMonitor(const PerformanceMonitor&) = delete;
         PerformanceMonitor& operator=(const PerformanceMonitor&) = delete;
@@ -34,6 +55,13 @@ namespace Plugin {
     public:
         PerformanceMonitor()
             : _skipURL(0)
+            , _server()
+            , _exportPath()
+            , _measurements()
+            , _send(nullptr)
+            , _receive(nullptr)
+            , _exchange(nullptr)
+            , _loadGenerator(_measurements)
         {
             RegisterAll();
         }
@@ -62,6 +90,10 @@ namespace Plugin {
         uint32_t endpoint_receive(const Core::JSON::DecUInt32& params, JsonData::PerformanceMonitor::BufferInfo& response);
         uint32_t endpoint_exchange(const JsonData::PerformanceMonitor::BufferInfo& params, JsonData::PerformanceMonitor::BufferInfo& response);
         uint32_t get_measurement(const string& index, JsonData::PerformanceMonitor::MeasurementData& response) const;
+        uint32_t endpoint_startbenchmark(const LoadGenerator::Parameters& params);
+        uint32_t endpoint_stopbenchmark();
+        uint32_t get_benchmark(LoadGenerator::Report& response) const;
+        uint32_t get_percentiles(const string& index, Measurements::Data& response) const;
 
         uint32_t RetrieveInfo(const uint32_t packageSize, JsonData::PerformanceMonitor::MeasurementData& measurementData) const;
         uint32_t Send(const JsonData::PerformanceMonitor::BufferInfo& data, Core::JSON::DecUInt32& result);
@@ -75,9 +107,22 @@ namespace Plugin {
             statisticsData.Average = statistics.Average();
             statisticsData.Count = statistics.Count();
         }
+        inline void Record(Measurements::Entry* entry, const uint64_t start) const
+        {
+            if (entry != nullptr) {
+                entry->Record(Measurements::EXECUTION, static_cast<uint32_t>(Core::Time::Now().Ticks() - start));
+            }
+        }
 
     private:
         uint8_t _skipURL;
+        Core::NodeId _server;
+        string _exportPath;
+        Measurements _measurements;
+        Measurements::Entry* _send;
+        Measurements::Entry* _receive;
+        Measurements::Entry* _exchange;
+        LoadGenerator _loadGenerator;
     };
 
 } // namespace Plugin
@@ -17,6 +17,10 @@ namespace Plugin {
         Register<Core::JSON::DecUInt32,BufferInfo>(_T("receive"), &PerformanceMonitor::endpoint_receive, this);
         Register<BufferInfo,BufferInfo>(_T("exchange"), &PerformanceMonitor::endpoint_exchange, this);
         Property<MeasurementData>(_T("measurement"), &PerformanceMonitor::get_measurement, nullptr, this);
+        Register<LoadGenerator::Parameters,void>(_T("startbenchmark"), &PerformanceMonitor::endpoint_startbenchmark, this);
+        Register<void,void>(_T("stopbenchmark"), &PerformanceMonitor::endpoint_stopbenchmark, this);
+        Property<LoadGenerator::Report>(_T("benchmark"), &PerformanceMonitor::get_benchmark, nullptr, this);
+        Property<Measurements::Data>(_T("percentiles"), &PerformanceMonitor::get_percentiles, nullptr, this);
     }
 
     void PerformanceMonitor::UnregisterAll()
@@ -26,6 +30,10 @@ namespace Plugin {
         Unregister(_T("exchange"));
         Unregister(_T("clear"));
         Unregister(_T("measurement"));
+        Unregister(_T("startbenchmark"));
+        Unregister(_T("stopbenchmark"));
+        Unregister(_T("benchmark"));
+        Unregister(_T("percentiles"));
     }
 
     // API implementation
@@ -37,6 +45,7 @@ namespace Plugin {
     uint32_t PerformanceMonitor::endpoint_clear()
     {
         PluginHost::PerformanceAdministrator::Instance().Clear();
+        _measurements.Clear();
         return Core::ERROR_NONE;
     }
 
@@ -45,21 +54,30 @@ namespace Plugin {
     //  - ERROR_NONE: Success
     uint32_t PerformanceMonitor::endpoint_send(const BufferInfo& params, Core::JSON::DecUInt32& response)
     {
-        return Send(params, response);
+        const uint64_t start = Core::Time::Now().Ticks();
+        uint32_t result = Send(params, response);
+        Record(_send, start);
+        return result;
     }
 
     // Return codes:
     //  - ERROR_NONE: Success
     uint32_t PerformanceMonitor::endpoint_receive(const Core::JSON::DecUInt32& params, BufferInfo& response)
     {
-        return Receive(params, response);
+        const uint64_t start = Core::Time::Now().Ticks();
+        uint32_t result = Receive(params, response);
+        Record(_receive, start);
+        return result;
     }
 
     // Return codes:
     //  - ERROR_NONE: Success
     uint32_t PerformanceMonitor::endpoint_exchange(const BufferInfo& params, BufferInfo& response)
     {
-        return Exchange(params, response);
+        const uint64_t start = Core::Time::Now().Ticks();
+        uint32_t result = Exchange(params, response);
+        Record(_exchange, start);
+        return result;
     }
 
     // Property: measurement - Retrieve the performance measurement against given package size
@@ -71,6 +89,43 @@ namespace Plugin {
         return RetrieveInfo(packageSize, response);
     }
 
+    // Method: startbenchmark - Start loading a JSON-RPC method with concurrent clients
+    // Return codes:
+    //  - ERROR_NONE: Success
+    //  - ERROR_INPROGRESS: A benchmark is already running
+    //  - ERROR_BAD_REQUEST: Invalid parameters
+    uint32_t PerformanceMonitor::endpoint_startbenchmark(const LoadGenerator::Parameters& params)
+    {
+        return _loadGenerator.Start(params, _server, _exportPath);
+    }
+
+    // Method: stopbenchmark - Abort the running benchmark
+    // Return codes:
+    //  - ERROR_NONE: Success
+    uint32_t PerformanceMonitor::endpoint_stopbenchmark()
+    {
+        _loadGenerator.Stop();
+        return Core::ERROR_NONE;
+    }
+
+    // Property: benchmark - Results of the last (or running) benchmark
+    // Return codes:
+    //  - ERROR_NONE: Success
+    uint32_t PerformanceMonitor::get_benchmark(LoadGenerator::Report& response) const
+    {
+        _loadGenerator.Get(response);
+        return Core::ERROR_NONE;
+    }
+
+    // Property: percentiles - Latency distribution over the sliding window of a method, indexed as callsign.method
+    // Return codes:
+    //  - ERROR_NONE: Success
+    //  - ERROR_UNKNOWN_KEY: Nothing was measured for this method
+    uint32_t PerformanceMonitor::get_percentiles(const string& index, Measurements::Data& response) const
+    {
+        return _measurements.Get(index, response);
+    }
+
 } // namespace Plugin
 }
 
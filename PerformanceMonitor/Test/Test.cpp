@@ -0,0 +1,185 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Checks the bucketing and the percentiles of the latency histogram, and the sliding window on top.
+// Returns the number of failed checks, so it can be run as is from a test script.
+
+#include "../Histogram.h"
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+MODULE_NAME_DECLARATION(BUILD_REFERENCE)
+
+using namespace WPEFramework;
+
+static uint32_t _failures = 0;
+
+#define CHECK(condition)                                                                   \
+    do {                                                                                   \
+        if ((condition) == false) {                                                        \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            _failures++;                                                                   \
+        }                                                                                  \
+    } while (false)
+
+// A reported value is the upper bound of its bucket, at most 1/SubBuckets above the recorded one.
+static bool Near(const uint32_t reported, const uint32_t expected)
+{
+    return ((reported >= expected) && ((reported - expected) <= (expected / Plugin::Histogram::SubBuckets) + 1));
+}
+
+static void Buckets()
+{
+    uint32_t previous = 0;
+
+    for (uint8_t bit = 0; bit < 32; bit++) {
+        CHECK(Plugin::Histogram::HighestBit(1u << bit) == bit);
+        CHECK(Plugin::Histogram::HighestBit((1u << bit) | 1) == bit);
+    }
+    CHECK(Plugin::Histogram::HighestBit(~0u) == 31);
+
+    // Every value has a bucket, buckets grow with the value and hold it.
+    for (uint32_t value = 0; value < (1u << 20); value++) {
+        const uint32_t index = Plugin::Histogram::Index(value);
+
+        CHECK(index >= previous);
+        CHECK(index < Plugin::Histogram::Buckets);
+        CHECK(value <= Plugin::Histogram::UpperBound(index));
+        CHECK(Near(Plugin::Histogram::UpperBound(index), value) == true);
+
+        previous = index;
+    }
+
+    for (uint32_t value = 0; value < Plugin::Histogram::LinearRange; value++) {
+        CHECK(Plugin::Histogram::Index(value) == value);
+        CHECK(Plugin::Histogram::UpperBound(value) == value);
+    }
+
+    CHECK(Plugin::Histogram::Index(~0u) == (Plugin::Histogram::Buckets - 1));
+    CHECK(Plugin::Histogram::UpperBound(Plugin::Histogram::Buckets - 1) == ~0u);
+}
+
+static void Percentiles()
+{
+    Plugin::Histogram histogram;
+    Plugin::Histogram::Snapshot snapshot;
+
+    histogram.Take(snapshot);
+    CHECK(snapshot.Count() == 0);
+    CHECK(snapshot.Minimum() == 0);
+    CHECK(snapshot.Maximum() == 0);
+    CHECK(snapshot.Percentile(500) == 0);
+
+    for (uint32_t value = 1; value <= 10000; value++) {
+        histogram.Record(value);
+    }
+
+    histogram.Take(snapshot);
+    CHECK(snapshot.Count() == 10000);
+    CHECK(snapshot.Minimum() == 1);
+    CHECK(snapshot.Maximum() == 10000);
+    CHECK(snapshot.Average() == 5000);
+    CHECK(Near(snapshot.Percentile(500), 5000) == true);
+    CHECK(Near(snapshot.Percentile(900), 9000) == true);
+    CHECK(Near(snapshot.Percentile(990), 9900) == true);
+    CHECK(snapshot.Percentile(999) <= 10000);
+    CHECK(snapshot.Percentile(1000) == 10000);
+    CHECK(snapshot.Percentile(0) == 1);
+
+    // Taking a snapshot does not reset the histogram.
+    Plugin::Histogram::Snapshot again;
+    histogram.Take(again);
+    CHECK(again.Count() == 10000);
+
+    // A single sample is reported as is, whatever the percentile.
+    Plugin::Histogram single;
+    Plugin::Histogram::Snapshot one;
+    single.Record(123457);
+    single.Take(one);
+    CHECK(one.Percentile(10) == 123457);
+    CHECK(one.Percentile(999) == 123457);
+
+    // Merging is the same as recording into one histogram.
+    Plugin::Histogram low;
+    Plugin::Histogram high;
+    Plugin::Histogram::Snapshot merged;
+    Plugin::Histogram::Snapshot part;
+
+    for (uint32_t value = 1; value <= 10000; value++) {
+        (value <= 5000 ? low : high).Record(value);
+    }
+    low.Take(merged);
+    high.Take(part);
+    merged.Merge(part);
+
+    CHECK(merged.Count() == snapshot.Count());
+    CHECK(merged.Minimum() == snapshot.Minimum());
+    CHECK(merged.Maximum() == snapshot.Maximum());
+    CHECK(merged.Percentile(500) == snapshot.Percentile(500));
+    CHECK(merged.Percentile(990) == snapshot.Percentile(990));
+}
+
+static void Window()
+{
+    // One second, spread over four slots of 250 ms.
+    Plugin::WindowHistogramType<4> window(1);
+    Plugin::Histogram::Snapshot snapshot;
+
+    CHECK(window.Window() == 1);
+
+    for (uint32_t value = 1; value <= 100; value++) {
+        window.Record(value);
+    }
+
+    window.Take(snapshot);
+    CHECK(snapshot.Count() == 100);
+    CHECK(snapshot.Maximum() == 100);
+
+    // Changing the window drops what was collected.
+    Plugin::Histogram::Snapshot resized;
+    window.Window(2);
+    window.Take(resized);
+    CHECK(window.Window() == 2);
+    CHECK(resized.Count() == 0);
+
+    // Samples older than the window are no longer reported.
+    Plugin::Histogram::Snapshot expired;
+    window.Window(1);
+    window.Record(42);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1300));
+    window.Record(7);
+    window.Take(expired);
+    CHECK(expired.Count() == 1);
+    CHECK(expired.Maximum() == 7);
+}
+
+int main()
+{
+    Buckets();
+    Percentiles();
+    Window();
+
+    printf("PerformanceMonitorHistogramTest: %s\n", (_failures == 0 ? "passed" : "FAILED"));
+
+    Core::Singleton::Dispose();
+
+    return (static_cast<int>(_failures));
+}
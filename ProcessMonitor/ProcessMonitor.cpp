@@ -41,8 +41,13 @@ void ProcessMonitor::Deinitialize(PluginHost::IShell* service)
 
 string ProcessMonitor::Information() const
 {
-    string emptyString;
-    return emptyString;
+    string result;
+    Metrics metrics;
+
+    _notification.Statistics(metrics);
+    metrics.ToString(result);
+
+    return result;
 }
 }
 }
@@ -22,10 +22,19 @@
 
 #include "Module.h"
 
+#include <list>
 #include <string>
 #include <syslog.h>
 #include <unordered_map>
 
+#include <poll.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef __NR_pidfd_open
+#define __NR_pidfd_open 434
+#endif
+
 namespace WPEFramework {
 namespace Plugin {
 
@@ -54,6 +63,47 @@ public:
         Core::JSON::DecUInt32 ExitTimeout;
     };
 
+    class Metrics: public Core::JSON::Container
+    {
+    public:
+        Metrics(const Metrics&) = delete;
+        Metrics& operator=(const Metrics&) = delete;
+
+    public:
+        Metrics()
+            : Core::JSON::Container()
+            , Monitored()
+            , Lingering()
+            , Exited()
+            , Killed()
+            , ExitLatency()
+            , ExitLatencyMax()
+            , ReclaimLatency()
+            , ReclaimLatencyMax()
+        {
+            Add(_T("monitored"), &Monitored);
+            Add(_T("lingering"), &Lingering);
+            Add(_T("exited"), &Exited);
+            Add(_T("killed"), &Killed);
+            Add(_T("exitlatency"), &ExitLatency);
+            Add(_T("exitlatencymax"), &ExitLatencyMax);
+            Add(_T("reclaimlatency"), &ReclaimLatency);
+            Add(_T("reclaimlatencymax"), &ReclaimLatencyMax);
+        }
+        ~Metrics() override
+        {
+        }
+    public:
+        Core::JSON::DecUInt32 Monitored; // Out of process plugins being watched
+        Core::JSON::DecUInt32 Lingering; // Deactivated, but the process did not exit (yet)
+        Core::JSON::DecUInt32 Exited; // Exited by themselves after deactivation
+        Core::JSON::DecUInt32 Killed; // Still running at the deadline
+        Core::JSON::DecUInt32 ExitLatency; // Average from deactivation to exit, in ms
+        Core::JSON::DecUInt32 ExitLatencyMax;
+        Core::JSON::DecUInt32 ReclaimLatency; // Average from the kill to the exit, in ms
+        Core::JSON::DecUInt32 ReclaimLatencyMax;
+    };
+
     class Notification: public PluginHost::IPlugin::INotification,
             public RPC::IRemoteConnection::INotification
     {
@@ -64,50 +114,134 @@ public:
 
         using Job = Core::WorkerPool::JobType<Notification&>;
 
-        class ProcessObject
+        // Watches one process through a pidfd, so its exit is reported by the resource monitor the
+        // moment it happens. On kernels without pidfd_open the process can only be checked at its
+        // deadline.
+        class ProcessObject: public Core::IResource
         {
         public:
             ProcessObject() = delete;
-            ProcessObject(const ProcessObject&) = default;
-            ProcessObject& operator=(const ProcessObject&) = default;
+            ProcessObject(const ProcessObject&) = delete;
+            ProcessObject& operator=(const ProcessObject&) = delete;
 
         public:
             ProcessObject(
+                Notification& parent,
+                const string& callsign,
                 const uint32_t processId)
-                : _processId(processId)
+                : _parent(parent)
+                , _callsign(callsign)
+                , _processId(processId)
+                , _descriptor(static_cast<int>(::syscall(__NR_pidfd_open, static_cast<pid_t>(processId), 0)))
+                , _deactivationTime(0)
                 , _exitTime(0)
+                , _killTime(0)
+                , _exited(false)
             {
                 ASSERT(_processId != 0);
+
+                if (_descriptor != -1) {
+                    Core::ResourceMonitor::Instance().Register(*this);
+                }
+            }
+            ~ProcessObject() override
+            {
+                if (_descriptor != -1) {
+                    Core::ResourceMonitor::Instance().Unregister(*this);
+                    ::close(_descriptor);
+                }
             }
-            ~ProcessObject()
+            const string& Callsign() const
             {
+                return _callsign;
             }
-            uint32_t ProcessId()
+            uint32_t ProcessId() const
             {
                 return _processId;
             }
-            void SetExitTime(const uint64_t exitTime)
+            bool IsWatched() const
             {
+                return (_descriptor != -1);
+            }
+            bool HasExited() const
+            {
+                return _exited;
+            }
+            void Deactivated(const uint64_t now, const uint64_t exitTime)
+            {
+                _deactivationTime = now;
                 _exitTime = exitTime;
             }
-            uint64_t ExitTime()
+            uint64_t DeactivationTime() const
+            {
+                return _deactivationTime;
+            }
+            uint64_t ExitTime() const
             {
                 return _exitTime;
             }
+            void Killed(const uint64_t now)
+            {
+                _killTime = now;
+            }
+            uint64_t KillTime() const
+            {
+                return _killTime;
+            }
+            void Exited()
+            {
+                _exited = true;
+            }
+
+            Core::IResource::handle Descriptor() const override
+            {
+                return (_descriptor);
+            }
+            uint16_t Events() override
+            {
+                // Once exited the descriptor stays readable, no need to hear about that again.
+                return (_exited == true ? 0 : POLLIN);
+            }
+            void Handle(const uint16_t events) override
+            {
+                if ((events & POLLIN) != 0) {
+                    _parent.Exited(*this);
+                }
+            }
 
         private:
+            Notification& _parent;
+            const string _callsign;
             const uint32_t _processId;
+            const int _descriptor;
+            uint64_t _deactivationTime;
             uint64_t _exitTime;
+            uint64_t _killTime;
+            bool _exited;
+        };
+
+    private:
+        struct Deadline {
+            uint64_t ExitTime;
+            string Callsign;
         };
 
     public:
         Notification(ProcessMonitor* parent)
             : _adminLock()
             , _processMap()
+            , _deadlines()
+            , _exited()
             , _job(*this)
             , _service(nullptr)
             , _parent(*parent)
             ,_exittimeout(10000000)
+            , _exits(0)
+            , _kills(0)
+            , _exitLatency(0)
+            , _exitLatencyMax(0)
+            , _reclaimLatency(0)
+            , _reclaimLatencyMax(0)
         {
             ASSERT(parent != nullptr);
         }
@@ -143,85 +277,161 @@ public:
 
             _job.Revoke();
 
+            _adminLock.Lock();
+
+            for (std::pair<const string, ProcessObject*>& entry : _processMap) {
+                _exited.push_back(entry.second);
+            }
             _processMap.clear();
+            _deadlines.clear();
+
+            _adminLock.Unlock();
+
+            Cleanup();
         }
         void StateChange(PluginHost::IShell* service) override
         {
             PluginHost::IShell::state currentState(service->State());
             if (currentState == PluginHost::IShell::DEACTIVATION) {
-
-                uint64_t exitTime = 0;
+                uint64_t scheduleTime = 0;
 
                 _adminLock.Lock();
 
-                std::unordered_map<string, ProcessObject>::iterator itr(
+                std::unordered_map<string, ProcessObject*>::iterator itr(
                         _processMap.find(service->Callsign()));
-                if (itr != _processMap.end()) {
-                    exitTime = Core::Time::Now().Ticks() + _exittimeout;
-                    itr->second.SetExitTime(exitTime);
-                }
+                if ((itr != _processMap.end()) && (itr->second->ExitTime() == 0)) {
+                    const uint64_t now = Core::Time::Now().Ticks();
+                    const uint64_t exitTime = now + _exittimeout;
+
+                    itr->second->Deactivated(now, exitTime);
 
-                if (exitTime != 0) {
-                    ScheduleJob();
+                    // All processes get the same time to exit, so deadlines are added in order.
+                    _deadlines.push_back({ exitTime, itr->first });
+
+                    if (_deadlines.size() == 1) {
+                        scheduleTime = exitTime;
+                    }
                 }
 
                 _adminLock.Unlock();
+
+                if (scheduleTime != 0) {
+                    ScheduleJob(scheduleTime);
+                }
             }
         }
         void AddProcess(const string callsign, const uint32_t processId)
         {
+            bool leftover = false;
+
+            _adminLock.Lock();
+
+            std::unordered_map<string, ProcessObject*>::iterator itr(_processMap.find(callsign));
+            if (itr != _processMap.end()) {
+                // A leftover of an earlier activation, which has not been seen exiting.
+                _exited.push_back(itr->second);
+                _processMap.erase(itr);
+                leftover = true;
+            }
+
+            _processMap.emplace(callsign, new ProcessObject(*this, callsign, processId));
+
+            _adminLock.Unlock();
+
+            if (leftover == true) {
+                ScheduleJob(Core::Time::Now().Ticks());
+            }
+        }
+        void Exited(ProcessObject& process)
+        {
+            const uint64_t now = Core::Time::Now().Ticks();
+
             _adminLock.Lock();
 
-            _processMap.emplace(callsign, ProcessObject(processId));
+            process.Exited();
+
+            if (process.KillTime() != 0) {
+                Measure(now - process.KillTime(), _reclaimLatency, _reclaimLatencyMax, _kills);
+            } else if (process.DeactivationTime() != 0) {
+                Measure(now - process.DeactivationTime(), _exitLatency, _exitLatencyMax, _exits);
+            }
+
+            std::unordered_map<string, ProcessObject*>::iterator itr(_processMap.find(process.Callsign()));
+            if ((itr != _processMap.end()) && (itr->second == &process)) {
+                _processMap.erase(itr);
+                _exited.push_back(&process);
+            }
 
             _adminLock.Unlock();
+
+            // Releasing the descriptor is not done from within the resource monitor.
+            ScheduleJob(now);
         }
         void Dispatch()
         {
             uint64_t currTime(Core::Time::Now().Ticks());
+            uint64_t scheduleTime = 0;
 
             _adminLock.Lock();
 
-            auto itr = _processMap.begin();
-            while (itr != _processMap.end()) {
+            while ((_deadlines.empty() == false) && (_deadlines.front().ExitTime <= currTime)) {
+                std::unordered_map<string, ProcessObject*>::iterator itr(
+                        _processMap.find(_deadlines.front().Callsign));
 
-                uint64_t exitTime = itr->second.ExitTime();
-                if ((exitTime != 0) && (exitTime <= currTime)) {
-                    Core::Process proc(itr->second.ProcessId());
+                if ((itr != _processMap.end()) && (itr->second->ExitTime() == _deadlines.front().ExitTime)) {
+                    ProcessObject* process = itr->second;
+                    Core::Process proc(process->ProcessId());
                     if (proc.IsActive()) {
                         proc.Kill(true);
+                        process->Killed(currTime);
                         SYSLOG(Logging::Notification,
                                 (_T("ProcessMonitor killed: [%s]!"),
                                         itr->first.c_str()));
                     }
-                    itr = _processMap.erase(itr);
-                }
-                else {
-                    itr++;
+                    if ((process->IsWatched() == false) || (process->KillTime() == 0)) {
+                        // Either the exit can not be observed, or it is gone already.
+                        _processMap.erase(itr);
+                        _exited.push_back(process);
+                    }
                 }
+                _deadlines.pop_front();
             }
 
-            ScheduleJob();
+            if (_deadlines.empty() == false) {
+                scheduleTime = _deadlines.front().ExitTime;
+            }
 
             _adminLock.Unlock();
+
+            if (scheduleTime != 0) {
+                // Running as the job, so it can not be pending: no need (and no way) to revoke it first.
+                _job.Schedule(scheduleTime);
+            }
+
+            Cleanup();
         }
-        void ScheduleJob()
+        void Statistics(Metrics& metrics) const
         {
-            uint64_t scheduleTime = 0;
+            uint32_t lingering = 0;
 
-            for (auto itr : _processMap) {
-                uint64_t exitTime = itr.second.ExitTime();
-                if (exitTime != 0) {
-                    if ((scheduleTime == 0) || (scheduleTime > exitTime)) {
-                        scheduleTime = exitTime;
-                    }
+            _adminLock.Lock();
+
+            for (const std::pair<const string, ProcessObject*>& entry : _processMap) {
+                if (entry.second->DeactivationTime() != 0) {
+                    lingering++;
                 }
             }
 
-            if (scheduleTime != 0) {
-                _job.Revoke();
-                _job.Schedule(scheduleTime);
-            }
+            metrics.Monitored = static_cast<uint32_t>(_processMap.size());
+            metrics.Lingering = lingering;
+            metrics.Exited = _exits;
+            metrics.Killed = _kills;
+            metrics.ExitLatency = (_exits == 0 ? 0 : static_cast<uint32_t>(_exitLatency / _exits / 1000));
+            metrics.ExitLatencyMax = static_cast<uint32_t>(_exitLatencyMax / 1000);
+            metrics.ReclaimLatency = (_kills == 0 ? 0 : static_cast<uint32_t>(_reclaimLatency / _kills / 1000));
+            metrics.ReclaimLatencyMax = static_cast<uint32_t>(_reclaimLatencyMax / 1000);
+
+            _adminLock.Unlock();
         }
         void Activated(RPC::IRemoteConnection* connection) override
         {
@@ -242,12 +452,48 @@ public:
         END_INTERFACE_MAP
 
     private:
-        Core::CriticalSection _adminLock;
-        std::unordered_map<string, ProcessObject> _processMap;
+        // Revoke waits for a running Dispatch, which takes the lock, so never call this with the lock held.
+        void ScheduleJob(const uint64_t scheduleTime)
+        {
+            _job.Revoke();
+            _job.Schedule(scheduleTime);
+        }
+        // Releasing a process unregisters it from the resource monitor, which might be waiting for
+        // our lock to report an exit, so this is done without holding the lock.
+        void Cleanup()
+        {
+            std::list<ProcessObject*> exited;
+
+            _adminLock.Lock();
+            exited.swap(_exited);
+            _adminLock.Unlock();
+
+            for (ProcessObject* process : exited) {
+                delete process;
+            }
+        }
+        static void Measure(const uint64_t latency, uint64_t& total, uint64_t& maximum, uint32_t& count)
+        {
+            total += latency;
+            maximum = std::max(maximum, latency);
+            count++;
+        }
+
+    private:
+        mutable Core::CriticalSection _adminLock;
+        std::unordered_map<string, ProcessObject*> _processMap;
+        std::list<Deadline> _deadlines; // Ordered on exit time
+        std::list<ProcessObject*> _exited; // Waiting to be released
         Job  _job;
         PluginHost::IShell* _service;
         ProcessMonitor& _parent;
         uint32_t _exittimeout;
+        uint32_t _exits;
+        uint32_t _kills;
+        uint64_t _exitLatency;
+        uint64_t _exitLatencyMax;
+        uint64_t _reclaimLatency;
+        uint64_t _reclaimLatencyMax;
     };
 
 public:
@@ -0,0 +1,242 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "Module.h"
+
+#ifndef __WINDOWS__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace WPEFramework {
+namespace Plugin {
+
+    // Compiled form of a JSON key map file: the conversions, sorted on code, in a flat array. The
+    // compiled file remembers which source it was made from (path, size and modification time), a
+    // changed or moved source is compiled again. Loading a compiled file is a map and a walk over the
+    // array, no JSON involved.
+    //
+    // Layout (host byte order): [Header][Entry * Header.Entries]
+    class KeyMapCache {
+    private:
+        static constexpr uint32_t Magic = 0x524B4D31; // "RKM1"
+
+        struct Header {
+            uint32_t Magic;
+            uint32_t Entries;
+            uint64_t SourceSize;
+            uint64_t SourceTime; // In nanoseconds
+            uint32_t SourceHash; // Of the path of the source
+            uint32_t Reserved;
+        };
+
+        struct Entry {
+            uint32_t Code;
+            uint16_t Key;
+            uint16_t Modifiers;
+        };
+
+        static_assert(sizeof(Header) == 32, "The header is expected to be packed in 32 bytes");
+        static_assert(sizeof(Entry) == 8, "Entries are expected to be packed in 8 bytes");
+
+    public:
+        KeyMapCache() = delete;
+        KeyMapCache(const KeyMapCache&) = delete;
+        KeyMapCache& operator=(const KeyMapCache&) = delete;
+
+        // Fill the map from the source, through its compiled form in the given directory. Returns the
+        // same errors as KeyMap::Load.
+        static uint32_t Load(PluginHost::VirtualInput::KeyMap& map, const string& source, const string& directory)
+        {
+#ifdef __WINDOWS__
+            return (map.Load(source));
+#else
+            uint32_t result = Core::ERROR_OPENING_FAILED;
+            struct stat info;
+
+            if (::stat(source.c_str(), &info) == 0) {
+                Header header;
+                const string compiled(CompiledFile(source, directory));
+
+                header.Magic = Magic;
+                header.Entries = 0;
+                header.SourceSize = static_cast<uint64_t>(info.st_size);
+                header.SourceTime = (static_cast<uint64_t>(info.st_mtim.tv_sec) * 1000000000ULL) + info.st_mtim.tv_nsec;
+                header.SourceHash = Hash(source);
+                header.Reserved = 0;
+
+                if ((compiled.empty() == true) || (Apply(map, compiled, header) == false)) {
+                    std::vector<Entry> entries;
+
+                    result = Compile(source, entries);
+
+                    if (result == Core::ERROR_NONE) {
+                        for (const Entry& entry : entries) {
+                            map.Add(entry.Code, entry.Key, entry.Modifiers);
+                        }
+
+                        if (compiled.empty() == false) {
+                            header.Entries = static_cast<uint32_t>(entries.size());
+                            Store(compiled, header, entries);
+                        }
+                    }
+                } else {
+                    result = Core::ERROR_NONE;
+                }
+            }
+
+            return (result);
+#endif
+        }
+
+#ifndef __WINDOWS__
+    private:
+        static string CompiledFile(const string& source, const string& directory)
+        {
+            string result;
+
+            if ((directory.empty() == false) && (Core::Directory(directory.c_str()).CreatePath() == true)) {
+                size_t start = source.find_last_of('/');
+                result = directory + source.substr(start == string::npos ? 0 : start + 1) + _T(".compiled");
+            }
+
+            return (result);
+        }
+        static uint32_t Hash(const string& text)
+        {
+            uint32_t result = 2166136261; // FNV-1a
+
+            for (const TCHAR character : text) {
+                result = (result ^ static_cast<uint8_t>(character)) * 16777619;
+            }
+
+            return (result);
+        }
+        static bool Apply(PluginHost::VirtualInput::KeyMap& map, const string& compiled, const Header& expected)
+        {
+            bool result = false;
+            int fd = ::open(compiled.c_str(), O_RDONLY | O_CLOEXEC);
+
+            if (fd != -1) {
+                struct stat info;
+
+                if ((::fstat(fd, &info) == 0) && (static_cast<size_t>(info.st_size) >= sizeof(Header))) {
+                    const size_t size = static_cast<size_t>(info.st_size);
+                    void* data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+                    if (data != MAP_FAILED) {
+                        const Header& header(*static_cast<const Header*>(data));
+
+                        if ((header.Magic == expected.Magic) && (header.SourceSize == expected.SourceSize) && (header.SourceTime == expected.SourceTime) && (header.SourceHash == expected.SourceHash) && ((sizeof(Header) + (header.Entries * sizeof(Entry))) == size)) {
+                            const Entry* entries = reinterpret_cast<const Entry*>(&(static_cast<const uint8_t*>(data)[sizeof(Header)]));
+
+                            for (uint32_t index = 0; index < header.Entries; index++) {
+                                map.Add(entries[index].Code, entries[index].Key, entries[index].Modifiers);
+                            }
+
+                            result = true;
+                        }
+
+                        ::munmap(data, size);
+                    }
+                }
+
+                ::close(fd);
+            }
+
+            return (result);
+        }
+        // The same rules as KeyMap::Load: only entries with a code and a key, the first one of a code wins.
+        static uint32_t Compile(const string& source, std::vector<Entry>& entries)
+        {
+            uint32_t result = Core::ERROR_OPENING_FAILED;
+            Core::File file(source);
+
+            if (file.Open(true) == true) {
+                Core::JSON::ArrayType<PluginHost::VirtualInput::KeyMap::KeyMapEntry> table;
+                Core::OptionalType<Core::JSON::Error> error;
+
+                table.IElement::FromFile(file, error);
+
+                if (error.IsSet() == true) {
+                    SYSLOG(Logging::ParsingError, (_T("Parsing failed with %s"), ErrorDisplayMessage(error.Value()).c_str()));
+                    result = Core::ERROR_PARSE_FAILURE;
+                } else {
+                    Core::JSON::ArrayType<PluginHost::VirtualInput::KeyMap::KeyMapEntry>::Iterator index(table.Elements());
+
+                    while (index.Next() == true) {
+                        if ((index.Current().Code.IsSet() == true) && (index.Current().Key.IsSet() == true)) {
+                            Entry entry;
+                            uint16_t modifiers = 0;
+
+                            Core::JSON::ArrayType<Core::JSON::EnumType<PluginHost::VirtualInput::KeyMap::modifier>>::ConstIterator flags(index.Current().Modifiers.Elements());
+
+                            while (flags.Next() == true) {
+                                modifiers |= static_cast<uint16_t>(flags.Current().Value());
+                            }
+
+                            entry.Code = index.Current().Code.Value();
+                            entry.Key = index.Current().Key.Value();
+                            entry.Modifiers = modifiers;
+                            entries.push_back(entry);
+                        }
+                    }
+
+                    std::stable_sort(entries.begin(), entries.end(), [](const Entry& lhs, const Entry& rhs) { return (lhs.Code < rhs.Code); });
+                    entries.erase(std::unique(entries.begin(), entries.end(), [](const Entry& lhs, const Entry& rhs) { return (lhs.Code == rhs.Code); }), entries.end());
+
+                    result = Core::ERROR_NONE;
+                }
+
+                file.Close();
+            }
+
+            return (result);
+        }
+        // Written aside and moved in place, a reader never sees a partial file.
+        static void Store(const string& compiled, const Header& header, const std::vector<Entry>& entries)
+        {
+            const string temporary(compiled + _T(".new"));
+            int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, S_IRUSR | S_IWUSR);
+
+            if (fd != -1) {
+                const ssize_t length = static_cast<ssize_t>(entries.size() * sizeof(Entry));
+                bool written = (::write(fd, &header, sizeof(header)) == static_cast<ssize_t>(sizeof(header)));
+
+                if ((written == true) && (length > 0)) {
+                    written = (::write(fd, entries.data(), length) == length);
+                }
+
+                ::close(fd);
+
+                if ((written == false) || (::rename(temporary.c_str(), compiled.c_str()) != 0)) {
+                    TRACE_L1("Could not store compiled key map %s [%d]", compiled.c_str(), errno);
+                    ::unlink(temporary.c_str());
+                }
+            }
+        }
+#endif
+    };
+
+} // namespace Plugin
+} // namespace WPEFramework
@@ -22,6 +22,7 @@
 #include <interfaces/IKeyHandler.h>
 #include <libudev.h>
 #include <linux/uinput.h>
+#include <sys/epoll.h>
 
 namespace WPEFramework {
 namespace Plugin {
@@ -40,6 +41,8 @@ namespace Plugin {
     private:
         static constexpr const TCHAR* InputDeviceSysFilePath = _T("/sys/class/input/");
         static constexpr const TCHAR* DeviceNamePath = _T("/device/name");
+        static constexpr uint8_t ReadyEvents = 16; // Descriptors handled per wake up
+        static constexpr uint8_t InputEvents = 64; // Events read from a device in one go
 
     private:
         LinuxDevice(const LinuxDevice&) = delete;
@@ -513,10 +516,15 @@ namespace Plugin {
             , _devices()
             , _monitor(nullptr)
             , _update(-1)
+            , _epoll(-1)
         {
             _pipe[0] = -1;
             _pipe[1] = -1;
-            if (::pipe(_pipe) < 0) {
+            _epoll = ::epoll_create1(EPOLL_CLOEXEC);
+            if (_epoll == -1) {
+                TRACE_L1("Could not create the epoll instance for the input devices [%d]", errno);
+            }
+            else if (::pipe(_pipe) < 0) {
                 // Pipe not successfully opened. Close, if needed;
                 if (_pipe[0] != -1) {
                     close(_pipe[0]);
@@ -538,6 +546,10 @@ namespace Plugin {
 
                 udev_unref(udev);
 
+                // The control descriptors are told apart from the input devices by their context.
+                Watch(_pipe[0], _pipe);
+                Watch(_update, &_update);
+
                 _inputDevices.emplace_back(Core::Service<KeyDevice>::Create<KeyDevice>(this));
                 _inputDevices.emplace_back(Core::Service<WheelDevice>::Create<WheelDevice>(this));
                 _inputDevices.emplace_back(Core::Service<PointerDevice>::Create<PointerDevice>(this));
@@ -565,6 +577,10 @@ namespace Plugin {
                 udev_monitor_unref(_monitor);
             }
 
+            if (_epoll != -1) {
+                ::close(_epoll);
+            }
+
             for (auto& device : _inputDevices) {
                 device->Teardown();
             }
@@ -611,9 +627,9 @@ namespace Plugin {
                     TRACE(Trace::Information, (_T("Opening input device: %s"), entry.Name().c_str()));
 
                     if (entry.Open(true) == true) {
-                        int fd = entry.DuplicateHandle();
                         std::map<string, std::pair<int, IDevInputDevice*>>::iterator device(_devices.find(entry.Name()));
                         if (device == _devices.end()) {
+                            int fd = entry.DuplicateHandle();
                             string deviceName;
                             ReadDeviceName(entry.Name(), deviceName);
                             std::transform(deviceName.begin(), deviceName.end(), deviceName.begin(), std::ptr_fun<int, int>(std::toupper));
@@ -627,7 +643,10 @@ namespace Plugin {
                                 }
                             }
 
-                            _devices.insert(std::make_pair(entry.Name(), std::make_pair(fd, inputDevice)));
+                            device = _devices.insert(std::make_pair(entry.Name(), std::make_pair(fd, inputDevice))).first;
+
+                            // Map nodes do not move, so the entry itself is the context of the descriptor.
+                            Watch(fd, &(*device));
                         }
                     }
                 }
@@ -642,6 +661,7 @@ namespace Plugin {
         {
             for (std::map<string, std::pair<int, IDevInputDevice*>>::const_iterator it = _devices.begin(), end = _devices.end();
                  it != end; ++it) {
+                Unwatch(it->second.first);
                 close(it->second.first);
             }
             _devices.clear();
@@ -652,31 +672,38 @@ namespace Plugin {
             write(_pipe[1], " ", 1);
             Wait(Core::Thread::INITIALIZED | Core::Thread::BLOCKED | Core::Thread::STOPPED, Core::infinite);
         }
+        void Watch(const int fd, void* context)
+        {
+            struct epoll_event event;
+
+            ::memset(&event, 0, sizeof(event));
+            event.events = EPOLLIN;
+            event.data.ptr = context;
+
+            if (::epoll_ctl(_epoll, EPOLL_CTL_ADD, fd, &event) != 0) {
+                TRACE_L1("Could not watch descriptor %d [%d]", fd, errno);
+            }
+        }
+        void Unwatch(const int fd)
+        {
+            ::epoll_ctl(_epoll, EPOLL_CTL_DEL, fd, nullptr);
+        }
         virtual uint32_t Worker()
         {
             while (IsRunning() == true) {
-                fd_set readset;
-                FD_ZERO(&readset);
-                FD_SET(_pipe[0], &readset);
-                FD_SET(_update, &readset);
-
-                int result = std::max(_pipe[0], _update);
+                struct epoll_event events[ReadyEvents];
 
-                // set up all the input devices
-                for (std::map<string, std::pair<int, IDevInputDevice*>>::const_iterator index = _devices.begin(), end = _devices.end(); index != end; ++index) {
-                    FD_SET(index->second.first, &readset);
-                    result = std::max(result, index->second.first);
-                }
+                int result = ::epoll_wait(_epoll, events, ReadyEvents, -1);
 
-                result = select(result + 1, &readset, 0, 0, nullptr);
+                for (int index = 0; index < result; index++) {
+                    void* context = events[index].data.ptr;
 
-                if (result > 0) {
-                    if (FD_ISSET(_pipe[0], &readset)) {
+                    if (context == _pipe) {
                         char buff;
                         (void)read(_pipe[0], &buff, 1);
                     }
-                    if (FD_ISSET(_update, &readset)) {
-                        // Make the call to receive the device. select() ensured that this will not block.
+                    else if (context == &_update) {
+                        // Make the call to receive the device. epoll_wait() ensured that this will not block.
                         udev_device* dev = udev_monitor_receive_device(_monitor);
                         if (dev) {
                             const char* nodeId = udev_device_get_devnode(dev);
@@ -688,48 +715,49 @@ namespace Plugin {
                             }
                         }
                     }
-
-                    // find the devices to read from
-                    std::map<string, std::pair<int, IDevInputDevice*>>::iterator index = _devices.begin();
-
-                    while (index != _devices.end()) {
-                        if (FD_ISSET(index->second.first, &readset)) {
-
-                            if (HandleInput(index->second.first) == false) {
-                                // fd closed?
-                                close(index->second.first);
-                                index = _devices.erase(index);
-                            } else {
-                                ++index;
+                    else if (context != nullptr) {
+                        std::pair<const string, std::pair<int, IDevInputDevice*>>& device(*static_cast<std::pair<const string, std::pair<int, IDevInputDevice*>>*>(context));
+                        const int fd = device.second.first;
+
+                        if (HandleInput(fd, device.second.second) == false) {
+                            // fd closed? Forget it for the rest of this round as well.
+                            Unwatch(fd);
+                            close(fd);
+
+                            for (int next = index + 1; next < result; next++) {
+                                if (events[next].data.ptr == context) {
+                                    events[next].data.ptr = nullptr;
+                                }
                             }
-                        } else {
-                            ++index;
+
+                            _devices.erase(device.first);
                         }
                     }
                 }
             }
             return (Core::infinite);
         }
-        bool HandleInput(const int fd)
+        bool HandleInput(const int fd, IDevInputDevice* owner)
         {
-            input_event entry[16];
-            int index = 0;
+            input_event entry[InputEvents];
             int result = ::read(fd, entry, sizeof(entry));
 
             if (result > 0) {
-                while (result >= static_cast<int>(sizeof(input_event))) {
-                    ASSERT(index < static_cast<int>((sizeof(entry) / sizeof(input_event))));
-                    for (auto& device : _inputDevices) {
-                        if (device->HandleInput(entry[index].code,  entry[index].type, entry[index].value) == true) {
-                            break;
+                const int count = (result / static_cast<int>(sizeof(input_event)));
+
+                for (int index = 0; index < count; index++) {
+                    // The producer the device was matched with gets it first, the others only if it is not interested.
+                    if ((owner == nullptr) || (owner->HandleInput(entry[index].code, entry[index].type, entry[index].value) == false)) {
+                        for (auto& device : _inputDevices) {
+                            if ((device != owner) && (device->HandleInput(entry[index].code, entry[index].type, entry[index].value) == true)) {
+                                break;
+                            }
                         }
                     }
-                    index++;
-                    result -= sizeof(input_event);
                 }
             }
 
-            return (result >= 0);
+            return ((result >= 0) || (errno == EINTR) || (errno == EAGAIN));
         }
         bool ReadDeviceName(const string& eventLocation, string& deviceName)
         {
@@ -764,6 +792,7 @@ namespace Plugin {
         int _pipe[2];
         udev_monitor* _monitor;
         int _update;
+        int _epoll;
         std::vector<IDevInputDevice*> _inputDevices;
         static LinuxDevice* _singleton;
     };
@@ -19,6 +19,7 @@
 
 #include <fcntl.h>
 
+#include "KeyMapCache.h"
 #include "RemoteAdministrator.h"
 #include "RemoteControl.h"
 
@@ -167,6 +168,9 @@ namespace Plugin {
             // Keep this path for save operation
             _persistentPath = service->PersistentPath();
 
+            // The map files are compiled once and loaded from their compiled form from then on.
+            const string compiledPath(_persistentPath.empty() == false ? _persistentPath + _T("keymaps/") : EMPTY_STRING);
+
             // Seems like we have a default mapping file. Load it..
             PluginHost::VirtualInput::KeyMap& map(_inputHandler->Table(DefaultMappingTable));
 
@@ -174,7 +178,7 @@ namespace Plugin {
 
                 map.PassThrough(config.PassOn.Value());
             } else {
-                if (map.Load(mappingFile) == Core::ERROR_NONE) {
+                if (KeyMapCache::Load(map, mappingFile, compiledPath) == Core::ERROR_NONE) {
 
                     map.PassThrough(config.PassOn.Value());
                 } else {
@@ -219,7 +223,7 @@ namespace Plugin {
 
                     // Get our selves a table..
                     PluginHost::VirtualInput::KeyMap& map(_inputHandler->Table(producer.c_str()));
-                    map.Load(specific);
+                    KeyMapCache::Load(map, specific, compiledPath);
                     if (configList.IsValid() == true) {
                         map.PassThrough(configList.Current().PassOn.Value());
                     }
@@ -245,7 +249,7 @@ namespace Plugin {
 
                     // Get our selves a table..de
                     PluginHost::VirtualInput::KeyMap& map(_inputHandler->Table(configList.Current().Name.Value()));
-                    map.Load(specific);
+                    KeyMapCache::Load(map, specific, compiledPath);
                     map.PassThrough(configList.Current().PassOn.Value());
                 }
 
@@ -0,0 +1,211 @@
+#pragma once
+
+#include "Module.h"
+#include <core/ProcessInfo.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace WPEFramework {
+namespace Plugin {
+
+    // Remembers the physical pages of every process between samples. Walking /proc/<pid>/pagemap is
+    // by far the most expensive part of a sample, so a process is only walked again when the kernel
+    // reports a change in its memory: a different resident size or new page faults (a page can not
+    // appear in a process without faulting it in). Things like page migration do not show up that
+    // way, so every process is walked again after RefreshSamples regardless.
+    class PageCache {
+    public:
+        static constexpr uint8_t RefreshSamples = 60;
+
+    private:
+        struct Signature {
+            uint64_t StartTime; // Tells a reused pid apart
+            uint64_t MinorFaults;
+            uint64_t MajorFaults;
+            uint64_t Resident;
+
+            inline bool operator==(const Signature& rhs) const
+            {
+                return ((StartTime == rhs.StartTime) && (MinorFaults == rhs.MinorFaults) && (MajorFaults == rhs.MajorFaults) && (Resident == rhs.Resident));
+            }
+            inline bool operator!=(const Signature& rhs) const
+            {
+                return (!operator==(rhs));
+            }
+        };
+
+        struct Entry {
+            Signature Key;
+            std::vector<uint32_t> Pages; // Bit positions in the page map
+            uint32_t Generation;
+            uint8_t Age;
+        };
+
+    public:
+        PageCache() = delete;
+        PageCache(const PageCache&) = delete;
+        PageCache& operator=(const PageCache&) = delete;
+
+        // The size of the page maps is given in 64 bits words.
+        explicit PageCache(const uint32_t words)
+            : _words(words)
+            , _scratch(new uint64_t[words])
+            , _generation(0)
+            , _entries()
+        {
+        }
+        ~PageCache()
+        {
+            delete[] _scratch;
+        }
+
+    public:
+        inline uint32_t Words() const
+        {
+            return (_words);
+        }
+        // Start a new sample, processes not marked since the previous start are forgotten.
+        void Start()
+        {
+            std::unordered_map<::ThreadId, Entry>::iterator index(_entries.begin());
+
+            while (index != _entries.end()) {
+                if (index->second.Generation != _generation) {
+                    index = _entries.erase(index);
+                } else {
+                    index++;
+                }
+            }
+
+            _generation++;
+        }
+        // Add the pages of the given process to the map.
+        void Mark(const Core::ProcessInfo& process, uint64_t map[])
+        {
+            const ::ThreadId id = process.Id();
+            std::unordered_map<::ThreadId, Entry>::iterator index(_entries.find(id));
+
+            if (index == _entries.end()) {
+                index = _entries.emplace(std::piecewise_construct, std::forward_as_tuple(id), std::forward_as_tuple()).first;
+                index->second.Generation = _generation - 1;
+                index->second.Age = RefreshSamples;
+            }
+
+            Entry& entry(index->second);
+
+            if (entry.Generation != _generation) {
+                // First time this process is seen in this sample, check if it needs a walk.
+                Signature current;
+
+                entry.Generation = _generation;
+
+                if ((Load(id, current) == false) || (current != entry.Key) || (entry.Age >= RefreshSamples)) {
+                    entry.Key = current;
+                    entry.Age = 0;
+                    Walk(process, entry.Pages);
+                } else {
+                    entry.Age++;
+                }
+            }
+
+            for (const uint32_t page : entry.Pages) {
+                map[page >> 6] |= (1ULL << (page & 63));
+            }
+        }
+
+        // Pages in ours (VSS) and the ones that are in ours only (USS), 64 bits at a time.
+        void Count(const uint64_t ours[], const uint64_t others[], uint32_t& vss, uint32_t& uss) const
+        {
+            uint32_t all = 0;
+            uint32_t unique = 0;
+
+            for (uint32_t index = 0; index < _words; index++) {
+                all += __builtin_popcountll(ours[index]);
+                unique += __builtin_popcountll(ours[index] & ~others[index]);
+            }
+
+            vss = all;
+            uss = unique;
+        }
+
+    private:
+        void Walk(const Core::ProcessInfo& process, std::vector<uint32_t>& pages)
+        {
+            ::memset(_scratch, 0, _words * sizeof(uint64_t));
+
+            process.MarkOccupiedPages(reinterpret_cast<uint32_t*>(_scratch), _words * sizeof(uint64_t));
+
+            pages.clear();
+
+            for (uint32_t index = 0; index < _words; index++) {
+                uint64_t word = _scratch[index];
+
+                while (word != 0) {
+                    pages.push_back((index << 6) | static_cast<uint32_t>(__builtin_ctzll(word)));
+                    word &= (word - 1);
+                }
+            }
+
+            pages.shrink_to_fit();
+        }
+        static bool Load(const ::ThreadId id, Signature& signature)
+        {
+            bool result = false;
+            char buffer[512];
+            const string fileName(_T("/proc/") + Core::NumberType<::ThreadId>(id).Text() + _T("/stat"));
+            int fd = ::open(fileName.c_str(), O_RDONLY | O_CLOEXEC);
+
+            if (fd != -1) {
+                const ssize_t length = ::read(fd, buffer, sizeof(buffer) - 1);
+
+                ::close(fd);
+
+                if (length > 0) {
+                    buffer[length] = '\0';
+
+                    // The name (field 2) can contain anything, so start after its closing parenthesis.
+                    const char* text = ::strrchr(buffer, ')');
+                    uint8_t field = 2;
+
+                    ::memset(&signature, 0, sizeof(signature));
+
+                    while ((text != nullptr) && (field < 24)) {
+                        text = ::strchr(text + 1, ' ');
+
+                        if (text != nullptr) {
+                            field++;
+
+                            switch (field) {
+                            case 10:
+                                signature.MinorFaults = ::strtoull(text + 1, nullptr, 10);
+                                break;
+                            case 12:
+                                signature.MajorFaults = ::strtoull(text + 1, nullptr, 10);
+                                break;
+                            case 22:
+                                signature.StartTime = ::strtoull(text + 1, nullptr, 10);
+                                break;
+                            case 24:
+                                signature.Resident = ::strtoull(text + 1, nullptr, 10);
+                                result = true;
+                                break;
+                            default:
+                                break;
+                            }
+                        }
+                    }
+                }
+            }
+
+            return (result);
+        }
+
+    private:
+        const uint32_t _words;
+        uint64_t* _scratch;
+        uint32_t _generation;
+        std::unordered_map<::ThreadId, Entry> _entries;
+    };
+}
+}
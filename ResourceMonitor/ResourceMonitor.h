@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Module.h"
+#include "RingFile.h"
 #include <interfaces/IMemory.h>
 #include <interfaces/IResourceMonitor.h>
 
@@ -20,8 +21,10 @@ namespace Plugin {
             Config()
                 : Core::JSON::Container()
                 , OutOfProcess(true)
+                , Path(_T("/tmp/resource-log.bin"))
             {
                 Add(_T("outofprocess"), &OutOfProcess);
+                Add(_T("path"), &Path);
             }
             ~Config()
             {
@@ -29,6 +32,58 @@ namespace Plugin {
 
         public:
             Core::JSON::Boolean OutOfProcess;
+            Core::JSON::String Path;
+        };
+
+        // Streams the log straight from (a snapshot of) the ring file, one row at a time.
+        class HistoryBody : public Web::IBody {
+        private:
+            HistoryBody(const HistoryBody&) = delete;
+            HistoryBody& operator=(const HistoryBody&) = delete;
+
+        public:
+            HistoryBody()
+                : _history()
+            {
+            }
+            ~HistoryBody() override
+            {
+            }
+
+        public:
+            inline void Load(const RingFile& file, const History::format type)
+            {
+                _history.Load(file, type);
+            }
+
+        private:
+            uint32_t Serialize() const override
+            {
+                return (_history.Length());
+            }
+            uint32_t Deserialize() override
+            {
+                // This body is only used for outbound traffic.
+                ASSERT(false);
+                return (0);
+            }
+            void End() const override
+            {
+                // Do not keep the snapshot while this body is waiting in the pool.
+                _history.Clear();
+            }
+            uint16_t Serialize(uint8_t stream[], const uint16_t maxLength) const override
+            {
+                return (_history.Read(stream, maxLength));
+            }
+            uint16_t Deserialize(const uint8_t[], const uint16_t) override
+            {
+                ASSERT(false);
+                return (0);
+            }
+
+        private:
+            mutable History _history;
         };
 
     public:
@@ -36,6 +91,7 @@ namespace Plugin {
             : _service(nullptr)
             , _monitor(nullptr)
             , _connectionId(0)
+            , _logPath()
         {
 
         }
@@ -62,14 +118,24 @@ namespace Plugin {
 
                 if (index.IsValid() == true && index.Next() == true) {
                     const string requestStr = index.Current().Text();
-                    if (requestStr == "history") {
-                        // Asked for history csv
-                        result->ErrorCode = Web::STATUS_OK;
-                        result->ContentType = Web::MIMETypes::MIME_TEXT;
-                        result->Message = _T("OK");
-                        Core::ProxyType<Web::TextBody> body(webBodyFactory.Element());
-                        *body = _monitor->CompileMemoryCsv();
-                        result->Body(body);
+                    if ((requestStr == "history") || (requestStr == "history.json")) {
+                        // Asked for history csv (or json), read straight from the log.
+                        RingFile log;
+
+                        if (log.Open(_logPath) == false) {
+                            result->ErrorCode = Web::STATUS_SERVICE_UNAVAILABLE;
+                            result->Message = _T("Resource log is not available.");
+                        } else {
+                            const bool json = (requestStr == "history.json");
+                            Core::ProxyType<HistoryBody> body(historyBodyFactory.Element());
+
+                            body->Load(log, (json == true ? History::JSON : History::CSV));
+
+                            result->ErrorCode = Web::STATUS_OK;
+                            result->ContentType = (json == true ? Web::MIMETypes::MIME_JSON : Web::MIMETypes::MIME_TEXT);
+                            result->Message = _T("OK");
+                            result->Body(Core::proxy_cast<Web::IBody>(body));
+                        }
                     }
                 }
             }
@@ -93,8 +159,9 @@ namespace Plugin {
         PluginHost::IShell* _service;
         Exchange::IResourceMonitor* _monitor;
         uint32_t _connectionId;
-        static Core::ProxyPoolType<Web::TextBody> webBodyFactory;
+        static Core::ProxyPoolType<HistoryBody> historyBodyFactory;
         uint32_t _skipURL;
+        string _logPath;
     };
 }
 }
@@ -1,14 +1,14 @@
 #include "Module.h"
+#include "PageCache.h"
+#include "RingFile.h"
 #include <core/ProcessInfo.h>
 #include <interfaces/IMemory.h>
 #include <interfaces/IResourceMonitor.h>
-#include <sstream>
 #include <vector>
 
 using std::endl;
 using std::cerr; // TODO: temp
 using std::list;
-using std::stringstream;
 using std::vector;
 
 // TODO: don't create our own thread, use threadpool from WPEFramework
@@ -37,11 +37,15 @@ namespace Plugin {
              , Interval()
              , Mode()
              , ParentName()
+             , Size(256)
+             , Names(64)
          {
             Add(_T("path"), &Path);
             Add(_T("interval"), &Interval);
             Add(_T("mode"), &Mode);
             Add(_T("parent-name"), &ParentName);
+            Add(_T("size"), &Size);
+            Add(_T("names"), &Names);
          }
          Config(const Config& copy)
              : Core::JSON::Container()
@@ -49,11 +53,15 @@ namespace Plugin {
              , Interval(copy.Interval)
              , Mode(copy.Mode)
              , ParentName(copy.ParentName)
+             , Size(copy.Size)
+             , Names(copy.Names)
          {
             Add(_T("path"), &Path);
             Add(_T("interval"), &Interval);
             Add(_T("mode"), &Mode);
             Add(_T("parent-name"), &ParentName);
+            Add(_T("size"), &Size);
+            Add(_T("names"), &Names);
          }
          ~Config()
          {
@@ -81,34 +89,29 @@ namespace Plugin {
          Core::JSON::DecUInt32 Interval;
          Core::JSON::String Mode;
          Core::JSON::String ParentName;
+         Core::JSON::DecUInt32 Size; // Of the log, in KB. Once full, the oldest samples are overwritten.
+         Core::JSON::DecUInt16 Names; // Process names the log can hold at once.
       };
 
       class StatCollecter {
      public:
          explicit StatCollecter(const Config& config)
-             : _binFile(nullptr)
+             : _log()
+             , _sample(0)
+             , _timestamp(0)
+             , _totalJiffies(0)
+             , _pages(MapWords())
              , _otherMap(nullptr)
              , _ourMap(nullptr)
-             , _bufferEntries(0)
+             , _bufferEntries(_pages.Words())
              , _interval(0)
              , _collectMode(Config::CollectMode::Invalid)
              , _activity(*this)
          {
-            _binFile = fopen(config.Path.Value().c_str(), "w");
+            _log.Create(config.Path.Value(), config.Size.Value() * 1024, config.Names.Value());
 
-            uint32_t pageCount = Core::SystemInfo::Instance().GetPhysicalPageCount();
-            const uint32_t bitPersUint32 = 32;
-            _bufferEntries = pageCount / bitPersUint32;
-            if ((pageCount % bitPersUint32) != 0) {
-               _bufferEntries++;
-            }
-
-            // Because linux doesn't report the first couple of pages it uses itself,
-            //    allocate a little extra to make sure we don't miss the highest ones.
-            _bufferEntries += _bufferEntries / 10;
-
-            _ourMap = new uint32_t[_bufferEntries];
-            _otherMap = new uint32_t[_bufferEntries];
+            _ourMap = new uint64_t[_bufferEntries];
+            _otherMap = new uint64_t[_bufferEntries];
             _interval = config.Interval.Value();
             _collectMode = config.GetCollectMode();
             _parentName = config.ParentName.Value();
@@ -118,7 +121,7 @@ namespace Plugin {
 
          ~StatCollecter()
          {
-            fclose(_binFile);
+            _log.Close();
 
             delete [] _ourMap;
             delete [] _otherMap;
@@ -132,6 +135,37 @@ namespace Plugin {
          }
 
       private:
+         static uint32_t MapWords()
+         {
+            uint32_t pageCount = Core::SystemInfo::Instance().GetPhysicalPageCount();
+            const uint32_t bitsPerWord = 64;
+            uint32_t words = pageCount / bitsPerWord;
+            if ((pageCount % bitsPerWord) != 0) {
+               words++;
+            }
+
+            // Because linux doesn't report the first couple of pages it uses itself,
+            //    allocate a little extra to make sure we don't miss the highest ones.
+            return (words + (words / 10));
+         }
+
+         // Split the pages of all processes in the ones used by "our" processes and the ones used by
+         // any other process. Pages of processes that did not change since the previous sample come
+         // from the cache, pagemap is only walked for the others.
+         template <typename OURS>
+         void MarkPages(OURS isOurs)
+         {
+            uint32_t mapBufferSize = sizeof(_ourMap[0]) * _bufferEntries;
+            memset(_ourMap, 0, mapBufferSize);
+            memset(_otherMap, 0, mapBufferSize);
+
+            Core::ProcessInfo::Iterator iterator;
+            while (iterator.Next()) {
+               const Core::ProcessInfo& process(iterator.Current());
+               _pages.Mark(process, (isOurs(process.Id()) == true ? _ourMap : _otherMap));
+            }
+         }
+
          // TODO: combine these "Collect*" methods
          void CollectSingle()
          {
@@ -149,10 +183,6 @@ namespace Plugin {
                TRACE_L1("Found more than one process named %s, only tracking first", _parentName);
             }
 
-            uint32_t mapBufferSize = sizeof(_ourMap[0]) * _bufferEntries;
-            memset(_ourMap, 0, mapBufferSize);
-            memset(_otherMap, 0, mapBufferSize);
-
             vector<::ThreadId> processIds;
 
             for (const Core::ProcessInfo& processInfo : processes) {
@@ -166,24 +196,12 @@ namespace Plugin {
 
                Core::ProcessTree processTree(processInfo.Id());
 
-               processTree.MarkOccupiedPages(_ourMap, mapBufferSize);
-
                std::list<::ThreadId> addedProcessIds;
                processTree.GetProcessIds(addedProcessIds);
                processIds.insert(processIds.end(), addedProcessIds.begin(), addedProcessIds.end());
             }
 
-            memset(_otherMap, 0, mapBufferSize);
-
-            // Find other processes
-            list<Core::ProcessInfo> otherProcesses;
-            Core::ProcessInfo::Iterator otherIterator;
-            while (otherIterator.Next()) {
-               ::ThreadId otherId = otherIterator.Current().Id();
-               if (find(processIds.begin(), processIds.end(), otherId) == processIds.end()) {
-                  otherIterator.Current().MarkOccupiedPages(_otherMap, mapBufferSize);
-               }
-            }
+            MarkPages([&processIds](const ::ThreadId id) { return (find(processIds.begin(), processIds.end(), id) != processIds.end()); });
 
             StartLogLine(1);
             LogProcess(_parentName, processes.front());
@@ -197,10 +215,6 @@ namespace Plugin {
             StartLogLine(processes.size());
 
             for (const Core::ProcessInfo& processInfo : processes) {
-               uint32_t mapBufferSize = sizeof(_ourMap[0]) * _bufferEntries;
-               memset(_ourMap, 0, mapBufferSize);
-               memset(_otherMap, 0, mapBufferSize);
-
                string processName = processInfo.Name() + " (" + std::to_string(processInfo.Id()) + ")";
 
                _namesLock.Lock();
@@ -211,16 +225,7 @@ namespace Plugin {
 
                Core::ProcessTree processTree(processInfo.Id());
 
-               processTree.MarkOccupiedPages(_ourMap, mapBufferSize);
-
-               list<Core::ProcessInfo> otherProcesses;
-               Core::ProcessInfo::Iterator otherIterator;
-               while (otherIterator.Next()) {
-                  ::ThreadId otherId = otherIterator.Current().Id();
-                  if (!processTree.ContainsProcess(otherId)) {
-                     otherIterator.Current().MarkOccupiedPages(_otherMap, mapBufferSize);
-                  }
-               }
+               MarkPages([&processTree](const ::ThreadId id) { return (processTree.ContainsProcess(id)); });
 
                LogProcess(processName, processInfo);
             }
@@ -268,20 +273,7 @@ namespace Plugin {
             for (std::pair<Core::ProcessInfo, string> processDesc : processIds) {
                Core::ProcessTree tree(processDesc.first);
 
-               uint32_t mapBufferSize = sizeof(_ourMap[0]) * _bufferEntries;
-               memset(_ourMap, 0, mapBufferSize);
-               memset(_otherMap, 0, mapBufferSize);
-
-               tree.MarkOccupiedPages(_ourMap, mapBufferSize);
-
-               list<Core::ProcessInfo> otherProcesses;
-               Core::ProcessInfo::Iterator otherIterator;
-               while (otherIterator.Next()) {
-                  ::ThreadId otherId = otherIterator.Current().Id();
-                  if (!tree.ContainsProcess(otherId)) {
-                     otherIterator.Current().MarkOccupiedPages(_otherMap, mapBufferSize);
-                  }
-               }
+               MarkPages([&tree](const ::ThreadId id) { return (tree.ContainsProcess(id)); });
 
                LogProcess(processDesc.second, processDesc.first);
             }
@@ -290,6 +282,8 @@ namespace Plugin {
      protected:
          void Dispatch()
          {
+            _pages.Start();
+
             switch(_collectMode) {
                case Config::CollectMode::Single:
                   CollectSingle();
@@ -312,55 +306,55 @@ namespace Plugin {
          }
 
     private:
-         uint32_t CountSetBits(uint32_t pageBuffer[], const uint32_t* inverseMask)
-         {
-            uint32_t count = 0;
-
-            if (inverseMask == nullptr) {
-               for (uint32_t index = 0; index < _bufferEntries; index++) {
-                  count += __builtin_popcount(pageBuffer[index]);
-               }
-            } else {
-               for (uint32_t index = 0; index < _bufferEntries; index++) {
-                  count += __builtin_popcount(pageBuffer[index] & (~inverseMask[index]));
-               }
-            }
-
-            return count;
-         }
-
          void LogProcess(const string& name, const Core::ProcessInfo& info)
          {
-            uint32_t vss = CountSetBits(_ourMap, nullptr);
-            uint32_t uss = CountSetBits(_ourMap, _otherMap);
-            uint64_t jiffies = info.Jiffies();
-
-            uint32_t nameSize = name.length();
-            fwrite(&nameSize, sizeof(nameSize), 1, _binFile);
-            fwrite(name.c_str(), sizeof(name[0]), name.length(), _binFile);
-            fwrite(&vss, 1, sizeof(vss), _binFile);
-            fwrite(&uss, 1, sizeof(uss), _binFile);
-            fwrite(&jiffies, 1, sizeof(jiffies), _binFile);
-            fflush(_binFile);
+            if (_log.IsValid() == true) {
+               RingFile::Record record;
+
+               record.Jiffies = info.Jiffies();
+               record.TotalJiffies = _totalJiffies;
+               record.Sample = _sample;
+               record.Timestamp = _timestamp;
+               _pages.Count(_ourMap, _otherMap, record.VSS, record.USS);
+               record.Name = _log.Name(name);
+               record.Reserved = 0;
+               record.Padding = 0;
+
+               _log.Append(record);
+            }
          }
 
          void StartLogLine(uint32_t processCount)
          {
             // TODO: no simple time_t alike in Thunder?
-            uint32_t timestamp = static_cast<uint32_t>(Core::Time::Now().Ticks() / 1000 / 1000);
-            uint64_t jiffies = Core::SystemInfo::Instance().GetJiffies();
+            _timestamp = static_cast<uint32_t>(Core::Time::Now().Ticks() / 1000 / 1000);
+            _totalJiffies = Core::SystemInfo::Instance().GetJiffies();
+            _sample++;
+
+            if ((processCount == 0) && (_log.IsValid() == true)) {
+               // Keep the sample, so the export shows the gap.
+               RingFile::Record record;
+
+               ::memset(&record, 0, sizeof(record));
+               record.TotalJiffies = _totalJiffies;
+               record.Sample = _sample;
+               record.Timestamp = _timestamp;
+               record.Name = RingFile::NoName;
 
-            fwrite(&timestamp, 1, sizeof(timestamp), _binFile);
-            fwrite(&processCount, 1, sizeof(processCount), _binFile);
-            fwrite(&jiffies, 1, sizeof(jiffies), _binFile);
+               _log.Append(record);
+            }
          }
 
-         FILE *_binFile;
+         RingFile _log;
+         uint32_t _sample; // Number of the sample being logged.
+         uint32_t _timestamp; // Of the sample being logged.
+         uint64_t _totalJiffies; // Of the sample being logged.
+         PageCache _pages; // Pages of every process, as of the last sample.
          vector<string> _processNames; // Seen process names.
          Core::CriticalSection _namesLock;
-         uint32_t * _otherMap; // Buffer used to mark other processes pages.
-         uint32_t * _ourMap;   // Buffer for pages used by our process (tree).
-         uint32_t _bufferEntries; // Numer of entries in each buffer.
+         uint64_t * _otherMap; // Buffer used to mark other processes pages.
+         uint64_t * _ourMap;   // Buffer for pages used by our process (tree).
+         uint32_t _bufferEntries; // Numer of (64 bits) entries in each buffer.
          uint32_t _interval; // Seconds between measurement.
          Config::CollectMode _collectMode; // Collection style.
          string _parentName; // Process/plugin name we are looking for.
@@ -409,84 +403,18 @@ namespace Plugin {
 
       string CompileMemoryCsv() override
       {
-         // TODO: should we worry about doing this as repsonse to RPC (could take too long?)
-         FILE* inFile = fopen(_binPath.c_str(), "rb");
-
-         stringstream output;
-         if (inFile != nullptr) {
-
-            vector<string> processNames;
-            _processThread->GetProcessNames(processNames);
-
-            output << _T("time (s)\tJiffies");
-            for (const string& processName : processNames) {
-               output << _T("\t") << processName << _T(" (VSS)\t") << processName << _T(" (USS)\t") << processName << _T(" (jiffies)");
-            }
-            output << endl;
-
-            vector<uint64_t> pageVector(processNames.size() * 3);
-            bool seenFirstTimestamp = false;
-            uint32_t firstTimestamp = 0;
+         // The web interface of the plugin streams the log itself, this is for the COM-RPC users.
+         string output;
+         RingFile log;
 
-            while (true) {
-               std::fill(pageVector.begin(), pageVector.end(), 0);
-
-               uint32_t timestamp = 0;
-               size_t readCount = fread(&timestamp, sizeof(timestamp), 1, inFile);
-               if (readCount != 1) {
-                  break;
-               }
-
-               if (!seenFirstTimestamp) {
-                  firstTimestamp = timestamp;
-                  seenFirstTimestamp = true;
-               }
-
-               uint32_t processCount = 0;
-               fread(&processCount, sizeof(processCount), 1, inFile);
-
-               uint64_t totalJiffies = 0;
-               fread(&totalJiffies, sizeof(totalJiffies), 1, inFile);
-
-               for (uint32_t processIndex = 0; processIndex < processCount; processIndex++) {
-                  uint32_t nameLength = 0;
-                  fread(&nameLength, sizeof(nameLength), 1, inFile);
-                  // TODO: unicode?
-                  char nameBuffer[nameLength + 1];
-                  fread(nameBuffer, sizeof(char), nameLength, inFile);
-
-                  nameBuffer[nameLength] = '\0';
-                  string name(nameBuffer);
-
-                  vector<string>::const_iterator nameIterator = std::find(processNames.cbegin(), processNames.cend(), name);
-
-                  uint32_t vss, uss;
-                  uint64_t jiffies;
-                  fread(&vss, sizeof(vss), 1, inFile);
-                  fread(&uss, sizeof(uss), 1, inFile);
-                  fread(&jiffies, sizeof(jiffies), 1, inFile);
-                  if (nameIterator == processNames.cend()) {
-                     continue;
-                  }
-
-                  int index = nameIterator - processNames.cbegin();
-
-                  pageVector[index * 3] = static_cast<uint64_t>(vss);
-                  pageVector[index * 3 + 1] = static_cast<uint64_t>(uss);
-                  pageVector[index * 3 + 2] = jiffies;
-               }
-
-               output << (timestamp - firstTimestamp) << "\t" << totalJiffies;
-               for (uint32_t pageEntry : pageVector) {
-                  output << "\t" << pageEntry;
-               }
-               output << endl;
-            }
+         if (log.Open(_binPath) == true) {
+            History history;
 
-            fclose(inFile);
+            history.Load(log, History::CSV);
+            history.ToString(output);
          }
 
-         return output.str();
+         return output;
       }
 
       BEGIN_INTERFACE_MAP(ResourceMonitorImplementation)
@@ -0,0 +1,455 @@
+#pragma once
+
+#include "Module.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace WPEFramework {
+namespace Plugin {
+
+    // Fixed size, memory mapped ring of fixed width samples. The file starts with a header holding the
+    // write position and a dictionary of the process names, so a record only carries the index of its
+    // name. The collector (out of process) is the only writer, the plugin maps the same file read only
+    // to export it, without going through the collector.
+    // Once the dictionary is full, the slot of a name whose records all rotated out of the ring is
+    // handed to the next new name, so processes that come and go do not exhaust it.
+    class RingFile {
+    public:
+        static constexpr uint32_t Magic = 0x524D5232; // "RMR2"
+        static constexpr uint16_t NameLength = 48;
+        static constexpr uint16_t NoName = 0xFFFF;
+
+        // One process in one sample. All records of a sample share the same Sample number, a sample
+        // without any process is stored as a single record with Name set to NoName.
+        struct Record {
+            uint64_t Jiffies; // Of the process (tree)
+            uint64_t TotalJiffies; // Of the system
+            uint32_t Sample;
+            uint32_t Timestamp; // In seconds
+            uint32_t VSS; // In pages
+            uint32_t USS; // In pages
+            uint16_t Name;
+            uint16_t Reserved;
+            uint32_t Padding;
+        };
+
+        static_assert(sizeof(Record) == 40, "Records are expected to be packed in 40 bytes");
+
+    private:
+        struct Header {
+            uint32_t Magic;
+            uint32_t Capacity; // In records
+            uint64_t Head; // Sequence number of the next record, only grows
+            uint32_t Names; // Slots of the dictionary in use
+            uint32_t MaxNames; // Slots of the dictionary, it directly follows the header
+        };
+
+        static inline uint32_t RecordOffset(const uint32_t maxNames)
+        {
+            return ((sizeof(Header) + (maxNames * NameLength) + 63) & ~63);
+        }
+
+    public:
+        RingFile(const RingFile&) = delete;
+        RingFile& operator=(const RingFile&) = delete;
+
+        RingFile()
+            : _header(nullptr)
+            , _dictionary(nullptr)
+            , _records(nullptr)
+            , _size(0)
+            , _names()
+            , _lastUse()
+        {
+        }
+        ~RingFile()
+        {
+            Close();
+        }
+
+    public:
+        inline bool IsValid() const
+        {
+            return (_header != nullptr);
+        }
+        // Start a new ring, a previous log in the same file is discarded. The size includes the
+        // dictionary of (at most) maxNames process names.
+        bool Create(const string& fileName, const uint32_t size, const uint16_t maxNames)
+        {
+            ASSERT(_header == nullptr);
+
+            const uint32_t names = std::min(std::max(maxNames, static_cast<uint16_t>(1)), static_cast<uint16_t>(NoName - 1));
+            const uint32_t offset = RecordOffset(names);
+            const uint32_t capacity = (size > offset ? ((size - offset) / sizeof(Record)) : 0);
+
+            if (capacity > 0) {
+                int fd = ::open(fileName.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+
+                if (fd != -1) {
+                    _size = offset + (capacity * sizeof(Record));
+
+                    if (::ftruncate(fd, _size) == 0) {
+                        Map(fd, PROT_READ | PROT_WRITE, names);
+                    }
+                    ::close(fd);
+                }
+
+                if (_header != nullptr) {
+                    _header->Magic = Magic;
+                    _header->Capacity = capacity;
+                    _header->Names = 0;
+                    _header->MaxNames = names;
+                    __atomic_store_n(&_header->Head, 0, __ATOMIC_RELEASE);
+                } else {
+                    TRACE_L1("Could not create resource log %s [%d]", fileName.c_str(), errno);
+                }
+            }
+
+            return (_header != nullptr);
+        }
+        bool Open(const string& fileName)
+        {
+            ASSERT(_header == nullptr);
+
+            int fd = ::open(fileName.c_str(), O_RDONLY | O_CLOEXEC);
+
+            if (fd != -1) {
+                struct stat info;
+
+                if ((::fstat(fd, &info) == 0) && (info.st_size > static_cast<off_t>(sizeof(Header)))) {
+                    _size = static_cast<uint32_t>(info.st_size);
+
+                    const Header* header = reinterpret_cast<const Header*>(::mmap(nullptr, sizeof(Header), PROT_READ, MAP_SHARED, fd, 0));
+
+                    if (header != MAP_FAILED) {
+                        const uint32_t names = header->MaxNames;
+
+                        if ((header->Magic == Magic) && (names < NoName) && ((static_cast<uint64_t>(RecordOffset(names)) + (static_cast<uint64_t>(header->Capacity) * sizeof(Record))) <= _size)) {
+                            Map(fd, PROT_READ, names);
+                        }
+
+                        ::munmap(const_cast<Header*>(header), sizeof(Header));
+                    }
+                }
+                ::close(fd);
+            }
+
+            return (_header != nullptr);
+        }
+        void Close()
+        {
+            if (_header != nullptr) {
+                ::munmap(_header, _size);
+                _header = nullptr;
+                _dictionary = nullptr;
+                _records = nullptr;
+            }
+            _size = 0;
+            _names.clear();
+            _lastUse.clear();
+        }
+
+        // Writer side. Returns the dictionary index for the record that is appended next.
+        uint16_t Name(const string& name)
+        {
+            ASSERT(_header != nullptr);
+
+            const uint64_t head = __atomic_load_n(&_header->Head, __ATOMIC_RELAXED);
+            uint16_t result = 0;
+
+            while ((result < _names.size()) && (_names[result] != name)) {
+                result++;
+            }
+
+            if (result == _names.size()) {
+                if (result < _header->MaxNames) {
+                    _names.push_back(name);
+                    _lastUse.push_back(head);
+                    Store(result, name);
+                    __atomic_store_n(&_header->Names, static_cast<uint32_t>(_names.size()), __ATOMIC_RELEASE);
+                } else {
+                    // Reclaim the slot that was used longest ago, if none of its records are left in the ring.
+                    uint16_t oldest = 0;
+
+                    for (uint16_t index = 1; index < _lastUse.size(); index++) {
+                        if (_lastUse[index] < _lastUse[oldest]) {
+                            oldest = index;
+                        }
+                    }
+
+                    if ((head - _lastUse[oldest]) > _header->Capacity) {
+                        result = oldest;
+                        _names[result] = name;
+                        Store(result, name);
+                    } else {
+                        TRACE_L1("No room left for process %s in the resource log", name.c_str());
+                        result = NoName;
+                    }
+                }
+            }
+
+            if (result != NoName) {
+                _lastUse[result] = head;
+            }
+
+            return (result);
+        }
+        void Append(const Record& record)
+        {
+            ASSERT(_header != nullptr);
+
+            const uint64_t head = __atomic_load_n(&_header->Head, __ATOMIC_RELAXED);
+
+            _records[head % _header->Capacity] = record;
+            __atomic_store_n(&_header->Head, head + 1, __ATOMIC_RELEASE);
+        }
+
+        // Reader side. Copies out what is in the ring, oldest first. Records the writer overwrote
+        // while copying are dropped.
+        void Snapshot(std::vector<Record>& records, std::vector<string>& names) const
+        {
+            ASSERT(_header != nullptr);
+
+            const uint32_t capacity = _header->Capacity;
+            const uint64_t head = __atomic_load_n(&_header->Head, __ATOMIC_ACQUIRE);
+            const uint64_t first = (head > capacity ? head - capacity : 0);
+            const uint32_t count = static_cast<uint32_t>(head - first);
+            const uint32_t start = static_cast<uint32_t>(first % capacity);
+            const uint32_t part = std::min(count, capacity - start);
+
+            records.resize(count);
+
+            if (count > 0) {
+                ::memcpy(&records[0], &_records[start], part * sizeof(Record));
+                ::memcpy(&records[part], &_records[0], (count - part) * sizeof(Record));
+            }
+
+            const uint32_t entries = std::min(__atomic_load_n(&_header->Names, __ATOMIC_ACQUIRE), _header->MaxNames);
+
+            names.clear();
+            for (uint32_t index = 0; index < entries; index++) {
+                const char* entry = &_dictionary[index * NameLength];
+                names.emplace_back(entry, ::strnlen(entry, NameLength));
+            }
+
+            // The slot of the record being written next is the one of the oldest record. Checked after
+            // reading the dictionary, so records of a name whose slot was reclaimed in between are dropped.
+            const uint64_t now = __atomic_load_n(&_header->Head, __ATOMIC_ACQUIRE);
+            const uint64_t valid = ((now + 1) > capacity ? (now + 1) - capacity : 0);
+
+            if (valid > first) {
+                records.erase(records.begin(), records.begin() + static_cast<uint32_t>(std::min(valid - first, static_cast<uint64_t>(count))));
+            }
+        }
+
+    private:
+        void Map(int fd, int protection, const uint32_t maxNames)
+        {
+            void* memory = ::mmap(nullptr, _size, protection, MAP_SHARED, fd, 0);
+
+            if (memory != MAP_FAILED) {
+                _header = reinterpret_cast<Header*>(memory);
+                _dictionary = &(reinterpret_cast<char*>(memory)[sizeof(Header)]);
+                _records = reinterpret_cast<Record*>(&(reinterpret_cast<uint8_t*>(memory)[RecordOffset(maxNames)]));
+            }
+        }
+        void Store(const uint16_t index, const string& name)
+        {
+            char* entry = &_dictionary[index * NameLength];
+
+            ::strncpy(entry, name.c_str(), NameLength - 1);
+            entry[NameLength - 1] = '\0';
+        }
+
+    private:
+        Header* _header;
+        char* _dictionary;
+        Record* _records;
+        uint32_t _size;
+        std::vector<string> _names; // Writer side copy of the dictionary
+        std::vector<uint64_t> _lastUse; // Writer side, sequence number of the last record per name
+    };
+
+    // Turns a snapshot of the ring into CSV or JSON, one row per sample. Rows are formatted when they
+    // are read, so an export never holds more than a single row of text.
+    class History {
+    public:
+        enum format {
+            CSV,
+            JSON
+        };
+
+    public:
+        History(const History&) = delete;
+        History& operator=(const History&) = delete;
+
+        History()
+            : _format(CSV)
+            , _records()
+            , _names()
+            , _values()
+            , _row()
+            , _index(0)
+            , _offset(0)
+            , _firstTimestamp(0)
+            , _header(false)
+            , _footer(false)
+        {
+        }
+        ~History()
+        {
+        }
+
+    public:
+        void Load(const RingFile& file, const format type)
+        {
+            _format = type;
+            file.Snapshot(_records, _names);
+            _values.resize(_names.size() * 3);
+            _firstTimestamp = (_records.empty() == true ? 0 : _records.front().Timestamp);
+            Rewind();
+        }
+        void Clear()
+        {
+            _records.clear();
+            _records.shrink_to_fit();
+            _names.clear();
+            _values.clear();
+            _row.clear();
+        }
+        // Total length of the export, without keeping it.
+        uint32_t Length()
+        {
+            uint32_t result = 0;
+
+            Rewind();
+            while (NextRow() == true) {
+                result += static_cast<uint32_t>(_row.length());
+            }
+            Rewind();
+
+            return (result);
+        }
+        uint16_t Read(uint8_t stream[], const uint16_t maxLength)
+        {
+            uint16_t result = 0;
+
+            while (result < maxLength) {
+                if ((_offset == _row.length()) && (NextRow() == false)) {
+                    break;
+                }
+
+                const uint16_t size = static_cast<uint16_t>(std::min(static_cast<size_t>(maxLength - result), _row.length() - _offset));
+
+                ::memcpy(&stream[result], &_row[_offset], size);
+                _offset += size;
+                result += size;
+            }
+
+            return (result);
+        }
+        void ToString(string& text)
+        {
+            text.reserve(Length());
+
+            while (NextRow() == true) {
+                text += _row;
+            }
+        }
+
+    private:
+        void Rewind()
+        {
+            _index = 0;
+            _offset = 0;
+            _row.clear();
+            _header = false;
+            _footer = false;
+        }
+        bool NextRow()
+        {
+            _row.clear();
+            _offset = 0;
+
+            if (_header == false) {
+                _header = true;
+                HeaderRow();
+            } else if (_index < _records.size()) {
+                SampleRow();
+            } else if (_footer == false) {
+                _footer = true;
+                if (_format == JSON) {
+                    _row = _T("]}\n");
+                }
+            }
+
+            return (_row.empty() == false);
+        }
+        void HeaderRow()
+        {
+            if (_format == CSV) {
+                _row = _T("time (s)\tJiffies");
+                for (const string& name : _names) {
+                    _row += '\t' + name + _T(" (VSS)\t") + name + _T(" (USS)\t") + name + _T(" (jiffies)");
+                }
+                _row += '\n';
+            } else {
+                _row = _T("{\"processes\":[");
+                for (uint32_t index = 0; index < _names.size(); index++) {
+                    _row += (index == 0 ? _T("\"") : _T(",\"")) + _names[index] + '\"';
+                }
+                _row += _T("],\"samples\":[");
+            }
+        }
+        void SampleRow()
+        {
+            const RingFile::Record& first(_records[_index]);
+
+            std::fill(_values.begin(), _values.end(), 0);
+
+            while ((_index < _records.size()) && (_records[_index].Sample == first.Sample)) {
+                const RingFile::Record& record(_records[_index]);
+
+                if (record.Name < _names.size()) {
+                    _values[(record.Name * 3) + 0] = record.VSS;
+                    _values[(record.Name * 3) + 1] = record.USS;
+                    _values[(record.Name * 3) + 2] = record.Jiffies;
+                }
+                _index++;
+            }
+
+            const string time(Core::NumberType<uint32_t>(first.Timestamp - _firstTimestamp).Text());
+            const string jiffies(Core::NumberType<uint64_t>(first.TotalJiffies).Text());
+
+            if (_format == CSV) {
+                _row = time + '\t' + jiffies;
+                for (const uint64_t value : _values) {
+                    _row += '\t' + Core::NumberType<uint64_t>(value).Text();
+                }
+                _row += '\n';
+            } else {
+                _row = (&first == &_records[0] ? _T("[") : _T(",[")) + time + ',' + jiffies;
+                for (const uint64_t value : _values) {
+                    _row += ',' + Core::NumberType<uint64_t>(value).Text();
+                }
+                _row += ']';
+            }
+        }
+
+    private:
+        format _format;
+        std::vector<RingFile::Record> _records;
+        std::vector<string> _names;
+        std::vector<uint64_t> _values;
+        string _row;
+        uint32_t _index;
+        uint32_t _offset;
+        uint32_t _firstTimestamp;
+        bool _header;
+        bool _footer;
+    };
+}
+}
@@ -47,15 +47,65 @@ namespace Plugin {
             RTSP_UNKNOWN
         };
 
+        // A "name: value" line of a received message, as offsets in message. The fields are located
+        // once when the message is parsed, looking one up does not copy or split anything.
+        struct Field {
+            uint16_t name;
+            uint16_t nameLength;
+            uint16_t value;
+            uint16_t valueLength;
+        };
+
+        RtspMessage()
+            : message()
+            , bSRM(false)
+            , sequence(0)
+            , fields()
+        {
+        }
+        virtual ~RtspMessage()
+        {
+        }
+
         virtual RtspMessage::Type getType()
         {
             return RTSP_UNKNOWN;
         }
 
+        bool HasHeader(const char name[]) const
+        {
+            return (Find(name) != nullptr);
+        }
+        // Value of the named field (case insensitive), empty if the message does not have it.
+        string Header(const char name[]) const
+        {
+            const Field* field = Find(name);
+
+            return (field != nullptr ? message.substr(field->value, field->valueLength) : string());
+        }
+
+    private:
+        const Field* Find(const char name[]) const
+        {
+            const size_t length = strlen(name);
+            const Field* result = nullptr;
+
+            for (const Field& field : fields) {
+                if ((field.nameLength == length) && (strncasecmp(&(message[field.name]), name, length) == 0)) {
+                    result = &field;
+                    break;
+                }
+            }
+
+            return (result);
+        }
+
     public:
         //RtspMessage::Type _type;
         string message;
         bool bSRM; // true: to/from SRM, false: to/from Pump
+        uint32_t sequence; // CSeq, pairs a response with its request
+        std::vector<Field> fields;
     };
 
     typedef std::shared_ptr<RtspMessage> RtspMessagePtr;
@@ -93,10 +143,13 @@ namespace Plugin {
         {
             return RTSP_RESPONSE;
         }
+        uint16_t GetCode() const
+        {
+            return _code;
+        }
 
     private:
         uint16_t _code;
-        uint32_t _sequence;
     };
 
     class RtspAnnounce : public RtspMessage {
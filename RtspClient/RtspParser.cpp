@@ -31,7 +31,7 @@
 namespace WPEFramework {
 namespace Plugin {
 
-    unsigned int RtspParser::_sequence = 0;
+    std::atomic<uint32_t> RtspParser::_sequence(0);
 
     RtspParser::RtspParser(RtspSessionInfo& info)
         : _sessionInfo(info)
@@ -42,6 +42,7 @@ namespace Plugin {
     RtspMessagePtr RtspParser::BuildSetupRequest(const std::string& server, const std::string& assetId)
     {
         RtspMessagePtr request = RtspMessagePtr(new RtspRequst);
+        const uint32_t seq = ++_sequence;
         std::stringstream ss;
 
         ss << "SETUP rtsp://" << server << "/" << assetId << "?";
@@ -50,7 +51,7 @@ namespace Plugin {
         ss << "StbId=943BB162A323&";
         ss << "CADeviceId=943BB162A323";
         ss << " RTSP/1.0" << RtspLineTerminator;
-        ss << "CSeq:" << ++_sequence << RtspLineTerminator;
+        ss << "CSeq:" << seq << RtspLineTerminator;
         ss << "User-Agent: Metro" << RtspLineTerminator;
         ss << "Transport: MP2T/DVBC/QAM;unicast;" << RtspLineTerminator;
         ss << RtspLineTerminator;
@@ -58,6 +59,8 @@ namespace Plugin {
         HexDump("SETUP", ss.str());
 
         request->message = ss.str();
+        request->sequence = seq;
+        request->bSRM = true;
 
         return request;
     }
@@ -68,6 +71,7 @@ namespace Plugin {
         std::stringstream ss;
         string sessionId;
         string cmd = (scale == 0) ? "PAUSE" : "PLAY";
+        const uint32_t seq = ++_sequence;
 
         if (_sessionInfo.bSrmIsRtspProxy) {
             sessionId = _sessionInfo.sessionId;
@@ -77,7 +81,7 @@ namespace Plugin {
             request->bSRM = false;
         }
         ss << cmd << " * RTSP/1.0" << RtspLineTerminator;
-        ss << "CSeq:" << ++_sequence << RtspLineTerminator;
+        ss << "CSeq:" << seq << RtspLineTerminator;
         ss << "Session:" << sessionId << RtspLineTerminator;
         ss << "Range: npt=" << position << RtspLineTerminator;
         ss << "Scale: " << scale << RtspLineTerminator;
@@ -86,6 +90,7 @@ namespace Plugin {
         HexDump("PLAY", ss.str());
 
         request->message = ss.str();
+        request->sequence = seq;
 
         return request;
     }
@@ -107,9 +112,10 @@ namespace Plugin {
             strParams = ssParams.str();
         }
 
+        const uint32_t seq = ++_sequence;
         std::stringstream ss;
         ss << "GET_PARAMETER * RTSP/1.0" << RtspLineTerminator;
-        ss << "CSeq:" << ++_sequence << RtspLineTerminator;
+        ss << "CSeq:" << seq << RtspLineTerminator;
         ss << "Session:" << sessId << RtspLineTerminator;
         ss << "Content-Type: text/parameters" << RtspLineTerminator;
         ss << "Content-Length: " << strParams.length() << RtspLineTerminator;
@@ -122,6 +128,8 @@ namespace Plugin {
         HexDump("GETPARAM", ss.str());
 
         request->message = ss.str();
+        request->sequence = seq;
+        request->bSRM = bSRM;
 
         return request;
     }
@@ -131,9 +139,10 @@ namespace Plugin {
         RtspMessagePtr request = RtspMessagePtr(new RtspRequst);
         std::stringstream ss;
         string strReason = "Cleint Intiated";
+        const uint32_t seq = ++_sequence;
 
         ss << "TEARDOWN * RTSP/1.0" << RtspLineTerminator;
-        ss << "CSeq:" << ++_sequence << RtspLineTerminator;
+        ss << "CSeq:" << seq << RtspLineTerminator;
         ss << "Session:" << _sessionInfo.sessionId << RtspLineTerminator;
         ss << "Reason:" << reason << " " << strReason << RtspLineTerminator;
         ss << RtspLineTerminator;
@@ -141,6 +150,8 @@ namespace Plugin {
         HexDump("TEARDOWN", ss.str());
 
         request->message = ss.str();
+        request->sequence = seq;
+        request->bSRM = true;
 
         return request;
     }
@@ -160,17 +171,16 @@ namespace Plugin {
         HexDump("ANNOUNCERESP", ss.str());
 
         request->message = ss.str();
+        request->bSRM = bSRM;
 
         return request;
     }
 
-    void RtspParser::ProcessSetupResponse(const std::string& response)
+    void RtspParser::ProcessSetupResponse(const RtspMessage& response)
     {
-        NAMED_ARRAY setupMap; // entire response
         NAMED_ARRAY params; // single line
-        Parse(response, setupMap, RtspLineTerminator, ": ");
 
-        string sess = setupMap["Session"];
+        string sess = response.Header("Session");
         TRACE_L2("%s: session id='%s'", __FUNCTION__, sess.c_str());
         if (sess.find(";") == string::npos) {
             _sessionInfo.sessionId = sess;
@@ -185,7 +195,7 @@ namespace Plugin {
                 _sessionInfo.sessionTimeout = SEC2MS(atoi(params["timeout"].c_str()));
         }
 
-        sess = setupMap["ControlSession"];
+        sess = response.Header("ControlSession");
         if (sess.size()) {
             if (sess.find(";") == string::npos) {
                 _sessionInfo.ctrlSessionId = sess;
@@ -206,37 +216,35 @@ namespace Plugin {
                 _sessionInfo.bSrmIsRtspProxy = false;
         }
 
-        string location = setupMap["Location"];
-        string chan = setupMap["Tuning"];
+        string location = response.Header("Location");
+        string chan = response.Header("Tuning");
         Parse(chan, params, ";", "=");
         _sessionInfo.frequency = atoi(params["frequency"].c_str()) * 100;
         _sessionInfo.modulation = atoi(params["modulation"].c_str());
         _sessionInfo.symbolRate = atoi(params["symbol_rate"].c_str());
 
-        string tune = setupMap["Channel"];
+        string tune = response.Header("Channel");
         Parse(tune, params, ";", "=");
         _sessionInfo.programNum = atoi(params["Svcid"].c_str());
 
-        _sessionInfo.bookmark = atof(setupMap["Bookmark"].c_str());
-        _sessionInfo.duration = atoi(setupMap["Duration"].c_str());
+        _sessionInfo.bookmark = atof(response.Header("Bookmark").c_str());
+        _sessionInfo.duration = atoi(response.Header("Duration").c_str());
 
         TRACE_L2("%s: f=%d p=%d m=%d s=%d bookmark=%f duration=%d",
             __FUNCTION__, _sessionInfo.frequency, _sessionInfo.programNum, _sessionInfo.modulation, _sessionInfo.symbolRate, _sessionInfo.bookmark, _sessionInfo.duration);
     }
 
-    void RtspParser::UpdateNPT(NAMED_ARRAY& playMap)
+    void RtspParser::UpdateNPT(const RtspMessage& playMap)
     {
         float nptStart = 0, nptEnd = 0;
         float oldScale = _sessionInfo.scale;
         float oldNPT = _sessionInfo.npt;
 
-        NAMED_ARRAY::iterator it = playMap.find("Scale");
-        if (it != playMap.end())
-            _sessionInfo.scale = atof(playMap["Scale"].c_str());
+        if (playMap.HasHeader("Scale"))
+            _sessionInfo.scale = atof(playMap.Header("Scale").c_str());
 
-        it = playMap.find("Range");
-        if (it != playMap.end()) {
-            string range = playMap["Range"];
+        if (playMap.HasHeader("Range")) {
+            string range = playMap.Header("Range");
             size_t posEq = range.find('=');
             size_t posHyphen = range.find('-');
             if (posEq != string::npos) {
@@ -253,24 +261,18 @@ namespace Plugin {
         }
     }
 
-    void RtspParser::ProcessPlayResponse(const std::string& response)
+    void RtspParser::ProcessPlayResponse(const RtspMessage& response)
     {
-        NAMED_ARRAY playMap;
-        Parse(response, playMap, RtspLineTerminator, ": ");
-        UpdateNPT(playMap);
+        UpdateNPT(response);
     }
 
-    void RtspParser::ProcessGetParamResponse(const std::string& response)
+    void RtspParser::ProcessGetParamResponse(const RtspMessage& response)
     {
-        NAMED_ARRAY playMap;
-        Parse(response, playMap, RtspLineTerminator, ": ");
-        UpdateNPT(playMap);
+        UpdateNPT(response);
     }
 
-    void RtspParser::ProcessTeardownResponse(const std::string& response)
+    void RtspParser::ProcessTeardownResponse(const RtspMessage& response)
     {
-        NAMED_ARRAY playMap;
-        Parse(response, playMap, RtspLineTerminator, ": ");
     }
 
     void RtspParser::Parse(const std::string& str, NAMED_ARRAY& contents, const string& sep1, const string& sep2)
@@ -310,46 +312,128 @@ namespace Plugin {
             TRACE_L4("%s: %s => '%s'", __FUNCTION__, it->first.c_str(), it->second.c_str());
     }
 
-    RtspMessagePtr RtspParser::ParseResponse(const std::string str)
+    /* static */ uint32_t RtspParser::Frame(const char data[], const uint32_t length, uint32_t& scanned)
+    {
+        static constexpr char HeaderEnd[] = "\r\n\r\n";
+        static constexpr char ContentLength[] = "Content-Length:";
+
+        uint32_t result = 0;
+        uint32_t index = (scanned > 3 ? scanned - 3 : 0);
+
+        // Find the empty line that ends the header. The part that was searched before can not have it.
+        while (((index + 4) <= length) && (memcmp(&data[index], HeaderEnd, 4) != 0)) {
+            index++;
+        }
+
+        if ((index + 4) > length) {
+            scanned = length;
+        } else {
+            uint32_t header = index + 4;
+            uint32_t body = 0;
+
+            // Only the length of the body is needed here, the rest of the header is left for ParseResponse.
+            for (uint32_t line = 0; line < index; line++) {
+                if (((line == 0) || (data[line - 1] == '\n')) && ((index - line) > (sizeof(ContentLength) - 1)) && (strncasecmp(&data[line], ContentLength, sizeof(ContentLength) - 1) == 0)) {
+                    body = static_cast<uint32_t>(strtoul(&data[line + sizeof(ContentLength) - 1], nullptr, 10));
+                    break;
+                }
+            }
+
+            scanned = index;
+
+            if ((header + body) <= length) {
+                result = header + body;
+            }
+        }
+
+        return result;
+    }
+
+    /* static */ void RtspParser::Index(RtspMessage& message)
+    {
+        const string& text = message.message;
+        size_t start = 0;
+
+        message.fields.clear();
+
+        while (start < text.length()) {
+            size_t end = text.find(RtspLineTerminator, start);
+
+            if (end == string::npos) {
+                end = text.length();
+            }
+
+            if (end > start) {
+                RtspMessage::Field field;
+                size_t separator = text.find(':', start);
+
+                field.name = static_cast<uint16_t>(start);
+
+                if ((separator == string::npos) || (separator > end)) {
+                    field.nameLength = static_cast<uint16_t>(end - start);
+                    field.value = static_cast<uint16_t>(end);
+                    field.valueLength = 0;
+                } else {
+                    field.nameLength = static_cast<uint16_t>(separator - start);
+
+                    separator++;
+                    while ((separator < end) && (text[separator] == ' ')) {
+                        separator++;
+                    }
+
+                    field.value = static_cast<uint16_t>(separator);
+                    field.valueLength = static_cast<uint16_t>(end - separator);
+                }
+
+                message.fields.push_back(field);
+            }
+
+            start = end + 2; // CRLF
+        }
+    }
+
+    RtspMessagePtr RtspParser::ParseResponse(const char data[], const uint32_t length)
     {
-        int rtspCode = 0;
         RtspMessagePtr response;
 
-        HexDump("Response: ", str);
+        HexDump("Response: ", data, length);
         // -------------------------------------------------------------------------
         // RTSP/1.0 200 OK
         // RTSP/1.0 400 Bad Request
         // ANNOUNCE rtsp://x.x.x.x:8060 RTSP/1.0
         // -------------------------------------------------------------------------
-        size_t pos = str.find(RtspLineTerminator);
-        if (pos != std::string::npos) {
-            string header = str.substr(0, pos);
-            std::vector<string> tokens;
-            Split(header, " ", tokens);
-            //TRACE_L2( "%s: header.length=%d tokens.size=%d", __FUNCTION__, header.length(), tokens.size());
-            //for (int i = 0; i < tokens.size(); i++)
-            //    TRACE_L2( "%s: %d. '%s'", __FUNCTION__, i, tokens.at(i).c_str());
+        const char* end = static_cast<const char*>(memchr(data, '\r', length));
+
+        if ((end != nullptr) && (length <= MaxMessageSize)) {
+            const uint32_t header = static_cast<uint32_t>(end - data);
+            const char* second = static_cast<const char*>(memchr(data, ' ', header));
 
             // Parse rest, only if the header is valid
-            if (tokens.size() >= 3) {
-                string first = tokens.at(0);
-                string rtspBody = str.substr(pos + 2); // +2 CRLR
-
-                if (first.compare("ANNOUNCE") == 0) {
-                    response = ParseAnnouncement(rtspBody, 0);
-                } else if (first.compare(0, 5, "RTSP/") == 0) {
-                    rtspCode = std::stoi(tokens.at(1));
-                    response = RtspMessagePtr(new RtspResponse(rtspCode));
-                    response->message = rtspBody;
+            if ((second != nullptr) && (memchr(second + 1, ' ', header - (second + 1 - data)) != nullptr)) {
+                RtspMessage parsed;
+
+                // This is the only copy made of a message, the fields refer to it.
+                parsed.message.assign(end + 2, length - header - 2); // +2 CRLF
+                Index(parsed);
+
+                if ((header >= 8) && (strncmp(data, "ANNOUNCE", 8) == 0)) {
+                    response = ParseAnnouncement(parsed);
+                } else if ((header >= 5) && (strncmp(data, "RTSP/", 5) == 0)) {
+                    response = RtspMessagePtr(new RtspResponse(static_cast<uint16_t>(atoi(second + 1))));
+                }
+
+                if (response) {
+                    response->sequence = static_cast<uint32_t>(atoi(parsed.Header("CSeq").c_str()));
+                    response->message.swap(parsed.message);
+                    response->fields.swap(parsed.fields);
                 }
-                //Parse(tokenStr, contents, ":", RtspLineTerminator);
             }
         }
 
         return response;
     }
 
-    RtspMessagePtr RtspParser::ParseAnnouncement(const std::string& response, bool bSRM)
+    RtspMessagePtr RtspParser::ParseAnnouncement(const RtspMessage& response)
     {
         /*
         contents.size=3
@@ -359,13 +443,10 @@ namespace Plugin {
     */
         int code = 0;
         string reason;
-        NAMED_ARRAY announceMap;
-        Parse(response, announceMap, RtspLineTerminator, ": ");
-        if (announceMap.size()) {
-            int respSeq = atoi(announceMap["CSeq"].c_str());
-            TRACE_L2("%s: respSeq=%d", __FUNCTION__, respSeq);
+        if (response.fields.size()) {
+            TRACE_L2("%s: respSeq=%s", __FUNCTION__, response.Header("CSeq").c_str());
 
-            string notice = announceMap["Notice"];
+            string notice = response.Header("Notice");
             size_t pos = notice.find(' ');
             if (pos != string::npos) {
                 size_t pos2;
@@ -382,33 +463,23 @@ namespace Plugin {
                 }
             }
         } else {
-            TRACE_L1("%s: ANNOUNCEMENT without body", __FUNCTION__, response.c_str());
+            TRACE_L1("%s: ANNOUNCEMENT without body", __FUNCTION__);
         }
 
         return RtspMessagePtr(new RtspAnnounce(code, reason));
     }
 
-    int RtspParser::Split(const string& str, const string& delim, std::vector<string>& tokens)
+    void RtspParser::HexDump(const char* label, const std::string& msg, uint16_t charsPerLine)
     {
-        size_t prev = 0, pos = 0;
-        do {
-            pos = str.find(delim, prev);
-            if (pos == string::npos)
-                pos = str.length();
-            string token = str.substr(prev, pos - prev);
-            if (!token.empty())
-                tokens.push_back(token);
-            prev = pos + delim.length();
-        } while (pos < str.length() && prev < str.length());
-
-        return tokens.size();
+        HexDump(label, msg.c_str(), static_cast<uint32_t>(msg.length()), charsPerLine);
     }
 
-    void RtspParser::HexDump(const char* label, const std::string& msg, uint16_t charsPerLine)
+    void RtspParser::HexDump(const char* label, const char msg[], const uint32_t length, uint16_t charsPerLine)
     {
+#if defined(_TRACE_LEVEL) && (_TRACE_LEVEL >= 2)
         std::stringstream ssHex, ss;
-        for (uint32_t i = 0; i < msg.length(); i++) {
-            int byte = (uint8_t)msg.at(i);
+        for (uint32_t i = 0; i < length; i++) {
+            int byte = (uint8_t)msg[i];
             ssHex << std::setfill('0') << std::setw(2) << std::hex << byte << " ";
             ss << char((byte < 32) ? '.' : byte);
 
@@ -419,6 +490,7 @@ namespace Plugin {
             }
         }
         TRACE_L2("%s: %s %s", label, ssHex.str().c_str(), ss.str().c_str());
+#endif
     }
 }
 } // WPEFramework::Plugin
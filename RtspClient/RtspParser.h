@@ -20,6 +20,7 @@
 #ifndef RTSPPARSER_H
 #define RTSPPARSER_H
 
+#include <atomic>
 #include <map>
 #include <string>
 
@@ -33,6 +34,9 @@ namespace Plugin {
 
     class RtspParser {
     public:
+        // Received messages larger than this are not accepted.
+        static constexpr uint32_t MaxMessageSize = 0xFFFF;
+
         RtspParser(RtspSessionInfo& sessionInfo);
         RtspMessagePtr BuildSetupRequest(const std::string& server, const std::string& assetId);
         RtspMessagePtr BuildPlayRequest(float scale = 1.0, uint32_t position = 0);
@@ -40,27 +44,33 @@ namespace Plugin {
         RtspMessagePtr BuildTeardownRequest(int reason);
         RtspMessagePtr BuildResponse(int seq, bool bSRM);
 
-        void ProcessSetupResponse(const std::string& response);
-        void ProcessPlayResponse(const std::string& response);
-        void ProcessGetParamResponse(const std::string& response);
-        void ProcessTeardownResponse(const std::string& response);
+        void ProcessSetupResponse(const RtspMessage& response);
+        void ProcessPlayResponse(const RtspMessage& response);
+        void ProcessGetParamResponse(const RtspMessage& response);
+        void ProcessTeardownResponse(const RtspMessage& response);
 
         void Parse(const std::string& str, NAMED_ARRAY& contents, const string& sep1, const string& sep2);
-        RtspMessagePtr ParseResponse(const std::string str);
-        RtspMessagePtr ParseAnnouncement(const std::string& response, bool bSRM);
+
+        // Incremental parsing of a stream: returns the length of the message at the start of data, or 0
+        // if it is not complete yet. scanned is where the search for the end of the header stopped,
+        // pass it back on the next call with more data, so the same bytes are not searched again.
+        static uint32_t Frame(const char data[], const uint32_t length, uint32_t& scanned);
+        RtspMessagePtr ParseResponse(const char data[], const uint32_t length);
+        RtspMessagePtr ParseAnnouncement(const RtspMessage& response);
 
         static void HexDump(const char* label, const std::string& msg, uint16_t charsPerLine = 32);
+        static void HexDump(const char* label, const char msg[], const uint32_t length, uint16_t charsPerLine = 32);
 
     private:
-        void UpdateNPT(NAMED_ARRAY& playMap);
-        int Split(const string& str, const string& delim, std::vector<string>& tokens);
+        void UpdateNPT(const RtspMessage& playMap);
+        static void Index(RtspMessage& message);
 
     public:
         RtspSessionInfo& _sessionInfo;
 
     private:
         static constexpr const char* const RtspLineTerminator = "\r\n";
-        static unsigned int _sequence;
+        static std::atomic<uint32_t> _sequence;
     };
 }
 } // WPEFramework::Plugin
@@ -30,8 +30,7 @@ namespace Plugin {
         , _srmSocket(nullptr)
         , _controlSocket(nullptr)
         , _parser(_sessionInfo)
-        , _requestQueue(64)
-        , _responseQueue(64)
+        , _pending()
         , _heartbeatTimer(Core::Thread::DefaultStackSize(), _T("RtspHeartbeatTimer"))
         , _isSessionActive(false)
         , _nextSRMHeartbeatMS(0)
@@ -87,19 +86,103 @@ namespace Plugin {
         }
         _adminLock.Unlock();
 
+        // Nothing will be answered anymore.
+        Abort();
+
         return ERR_OK; // Handle return value
     }
 
     RtspReturnCode RtspSession::Send(const RtspMessagePtr& request)
     {
-        _requestQueue.Post(request);
-        GetSocket(request->bSRM).Trigger();
+        GetSocket(request->bSRM).Submit(request);
 
         return ERR_OK; // Handle return value
     }
 
+    RtspReturnCode RtspSession::Send(const RtspMessagePtr& request, const Completion& completion)
+    {
+        Core::Time deadline = Core::Time::Now();
+        deadline.Add(ResponseWaitTime);
+
+        const Pending entry = { deadline.Ticks(), completion };
+
+        _pendingLock.Lock();
+        // Sequence numbers are unique, a collision would hand a response to the wrong request.
+        const bool added = _pending.emplace(request->sequence, entry).second;
+        _pendingLock.Unlock();
+
+        ASSERT(added == true);
+        DEBUG_VARIABLE(added);
+
+        return Send(request);
+    }
+
+    RtspReturnCode RtspSession::Send(const RtspMessagePtr& request, RtspMessagePtr& response)
+    {
+        Core::Event signal(false, true);
+        RtspReturnCode rc = ERR_TIMED_OUT;
+
+        Send(request, [&](const RtspReturnCode result, const RtspMessagePtr& answer) {
+            rc = result;
+            response = answer;
+            signal.SetEvent();
+        });
+
+        if (signal.Lock(ResponseWaitTime) != Core::ERROR_NONE) {
+            if (Revoke(request->sequence) == false) {
+                // The completion is running right now, it uses our stack, so wait for it.
+                signal.Lock(Core::infinite);
+            }
+        }
+
+        return rc;
+    }
+
+    bool RtspSession::Revoke(const uint32_t sequence)
+    {
+        _pendingLock.Lock();
+        bool found = (_pending.erase(sequence) != 0);
+        _pendingLock.Unlock();
+
+        return found;
+    }
+
+    void RtspSession::Expire(const uint64_t now)
+    {
+        std::list<Completion> expired;
+
+        _pendingLock.Lock();
+        std::map<uint32_t, Pending>::iterator index(_pending.begin());
+        while ((index != _pending.end()) && (index->second.deadline <= now)) {
+            TRACE_L1("%s: No response on CSeq %d", __FUNCTION__, index->first);
+            expired.push_back(std::move(index->second.completion));
+            index = _pending.erase(index);
+        }
+        _pendingLock.Unlock();
+
+        for (const Completion& completion : expired) {
+            completion(ERR_TIMED_OUT, RtspMessagePtr());
+        }
+    }
+
+    void RtspSession::Abort()
+    {
+        std::map<uint32_t, Pending> aborted;
+
+        _pendingLock.Lock();
+        aborted.swap(_pending);
+        _pendingLock.Unlock();
+
+        for (std::pair<const uint32_t, Pending>& entry : aborted) {
+            entry.second.completion(ERR_NO_ACTIVE_SESSION, RtspMessagePtr());
+        }
+    }
+
     uint64_t RtspSession::Timed(const uint64_t scheduledTime)
     {
+        // The heartbeat tick doubles as the timeout sweep for the requests nobody is waiting on.
+        Expire(Core::Time::Now().Ticks());
+
         if (_isSessionActive) {
             _sessionInfo.npt += NptUpdateInterwal * _sessionInfo.scale;
             TRACE(Trace::Information, ("npt=%.3f_nextSRMHeartbeat=%d _nextPumpHeartbeat=%d sessionTimeout=%d ctrlSessionTimeout=%d", _sessionInfo.npt, _nextSRMHeartbeatMS, _nextPumpHeartbeatMS, _sessionInfo.sessionTimeout, _sessionInfo.ctrlSessionTimeout));
@@ -121,19 +204,13 @@ namespace Plugin {
 
         if (!_isSessionActive) {
             _sessionInfo.reset();
-            // new session, flush any remaining message in the queue
-            while (!_responseQueue.IsEmpty()) {
-                TRACE_L1("%s: Removing old message", __FUNCTION__);
-                _responseQueue.Extract(response, 0);
-            }
 
             _isSessionActive = true;
             RtspMessagePtr request = _parser.BuildSetupRequest(_sessionInfo.srm.name, assetId);
-            Send(request);
 
-            if (_responseQueue.Extract(response, ResponseWaitTime)) {
+            if (Send(request, response) == ERR_OK) {
                 _adminLock.Lock();
-                _parser.ProcessSetupResponse(response->message);
+                _parser.ProcessSetupResponse(*response);
 
                 Core::Time NextTick = Core::Time::Now();
                 NextTick.Add(NptUpdateInterwal);
@@ -178,9 +255,8 @@ namespace Plugin {
 
         if (_isSessionActive) {
             RtspMessagePtr request = _parser.BuildTeardownRequest(reason);
-            Send(request);
-            if (_responseQueue.Extract(response, ResponseWaitTime)) {
-                _parser.ProcessTeardownResponse(response->message);
+            if (Send(request, response) == ERR_OK) {
+                _parser.ProcessTeardownResponse(*response);
             } else {
                 TRACE_L1("%s: Failed to get Response", __FUNCTION__);
                 rc = ERR_TIMED_OUT;
@@ -204,9 +280,10 @@ namespace Plugin {
             RtspMessagePtr response;
 
             RtspMessagePtr request = _parser.BuildPlayRequest(scale, position);
-            Send(request);
-            if (_responseQueue.Extract(response, ResponseWaitTime)) {
-                _parser.ProcessPlayResponse(response->message);
+            if (Send(request, response) == ERR_OK) {
+                _adminLock.Lock();
+                _parser.ProcessPlayResponse(*response);
+                _adminLock.Unlock();
             } else {
                 TRACE_L1("%s: Failed to get Response", __FUNCTION__);
                 rc = ERR_TIMED_OUT;
@@ -231,26 +308,36 @@ namespace Plugin {
         return rc;
     }
 
-    RtspReturnCode RtspSession::ProcessResponse(const string& responseStr, bool bSRM)
+    RtspReturnCode RtspSession::ProcessResponse(const RtspMessagePtr& response, bool bSRM)
     {
         RtspReturnCode rc = ERR_OK;
 
-        if (responseStr.length()) {
-            RtspMessagePtr response = _parser.ParseResponse(responseStr);
-            if (dynamic_cast<RtspAnnounce*>(response.get()) != nullptr) {
-                RtspAnnounce& announcement = *dynamic_cast<RtspAnnounce*>(response.get());
-                // rc = sendResponse(respSeq, bSRM);
+        if (dynamic_cast<RtspAnnounce*>(response.get()) != nullptr) {
+            RtspAnnounce& announcement = *dynamic_cast<RtspAnnounce*>(response.get());
+            // rc = sendResponse(respSeq, bSRM);
 
-                // reset scale & npt
-                if (announcement.GetCode() == RtspAnnounce::EosReached) {
-                    _sessionInfo.scale = 1;
-                    _sessionInfo.npt = 0;
-                }
-                _announcementHandler.announce(announcement);
-            } else if (dynamic_cast<RtspResponse*>(response.get()) != nullptr) {
-                _responseQueue.Post(response);
+            // reset scale & npt
+            if (announcement.GetCode() == RtspAnnounce::EosReached) {
+                _sessionInfo.scale = 1;
+                _sessionInfo.npt = 0;
+            }
+            _announcementHandler.announce(announcement);
+        } else if (dynamic_cast<RtspResponse*>(response.get()) != nullptr) {
+            Completion completion;
+
+            _pendingLock.Lock();
+            std::map<uint32_t, Pending>::iterator index(_pending.find(response->sequence));
+            if (index != _pending.end()) {
+                completion = std::move(index->second.completion);
+                _pending.erase(index);
+            }
+            _pendingLock.Unlock();
+
+            if (completion) {
+                response->bSRM = bSRM;
+                completion(ERR_OK, response);
             } else {
-                TRACE_L1("%s: UNKNOWN response '%s'", __FUNCTION__, responseStr.c_str());
+                TRACE_L1("%s: No request waiting for CSeq %d", __FUNCTION__, response->sequence);
             }
         }
         return rc;
@@ -269,20 +356,18 @@ namespace Plugin {
 
     RtspReturnCode RtspSession::SendHeartbeat(bool bSRM)
     {
-        RtspReturnCode rc = ERR_OK;
-        RtspMessagePtr response;
-
         RtspMessagePtr request = _parser.BuildGetParamRequest(bSRM);
-        Send(request);
-
-        if (_responseQueue.Extract(response, ResponseWaitTime)) {
-            _parser.ProcessGetParamResponse(response->message);
-        } else {
-            TRACE_L1("%s: Failed to get Response", __FUNCTION__);
-            rc = ERR_TIMED_OUT;
-        }
 
-        return rc;
+        // Do not hold up the timer (and so the other heartbeat) waiting for the answer.
+        return Send(request, [this](const RtspReturnCode result, const RtspMessagePtr& response) {
+            if (result == ERR_OK) {
+                _adminLock.Lock();
+                _parser.ProcessGetParamResponse(*response);
+                _adminLock.Unlock();
+            } else {
+                TRACE_L1("%s: Failed to get Response", __FUNCTION__);
+            }
+        });
     }
 
     RtspReturnCode RtspSession::SendHeartbeats()
@@ -315,6 +400,11 @@ namespace Plugin {
     RtspSession::Socket::Socket(const Core::NodeId& local, const Core::NodeId& remote, RtspSession& rtspSession)
         : Core::SocketStream(false, local, remote, 4096, 4096)
         , _rtspSession(rtspSession)
+        , _lock()
+        , _requestQueue()
+        , _sendOffset(0)
+        , _receiveBuffer()
+        , _scanned(0)
     {
         Open(1000, "");
     };
@@ -324,16 +414,39 @@ namespace Plugin {
         Close(1000);
     };
 
-    uint16_t RtspSession::Socket::SendData(uint8_t* dataFrame, const uint16_t maxSendSize)
+    void RtspSession::Socket::Submit(const RtspMessagePtr& request)
     {
-        TRACE_L4("%s: _requestQueue.IsEmpty=%d ", __FUNCTION__, _rtspSession._requestQueue.IsEmpty());
+        _lock.Lock();
+        _requestQueue.push_back(request);
+        _lock.Unlock();
 
+        Trigger();
+    }
+
+    uint16_t RtspSession::Socket::SendData(uint8_t* dataFrame, const uint16_t maxSendSize)
+    {
         uint16_t len = 0;
-        if (!_rtspSession._requestQueue.IsEmpty()) {
-            RtspMessagePtr request;
-            _rtspSession._requestQueue.Extract(request, 0);
-            len = request->message.size();
-            memcpy(dataFrame, request->message.c_str(), len);
+
+        _lock.Lock();
+
+        // Requests go out back to back, a request does not wait for the response on the previous one.
+        while ((len < maxSendSize) && (_requestQueue.empty() == false)) {
+            const string& message(_requestQueue.front()->message);
+            const uint16_t size = static_cast<uint16_t>(std::min(static_cast<size_t>(maxSendSize - len), message.size() - _sendOffset));
+
+            memcpy(&dataFrame[len], &(message[_sendOffset]), size);
+            len += size;
+            _sendOffset += size;
+
+            if (_sendOffset == message.size()) {
+                _requestQueue.pop_front();
+                _sendOffset = 0;
+            }
+        }
+
+        _lock.Unlock();
+
+        if (len != 0) {
             TRACE(Trace::Information, ("%s: maxSendSize=%d bytesToSend=%d", __FUNCTION__, maxSendSize, len));
         }
 
@@ -343,12 +456,52 @@ namespace Plugin {
     uint16_t RtspSession::Socket::ReceiveData(uint8_t* dataFrame, const uint16_t receivedSize)
     {
         TRACE(Trace::Information, ("%s: receivedSize=%d", __FUNCTION__, receivedSize));
-        string response((char*)dataFrame, receivedSize);
-        bool bSRM = (_rtspSession._srmSocket == this);
-        _rtspSession.ProcessResponse(response, bSRM);
+
+        if (_receiveBuffer.empty() == true) {
+            // Messages that arrived completely are parsed straight from the socket buffer, only a
+            // trailing part of a message is kept until the rest arrives.
+            uint32_t used = Deliver(reinterpret_cast<const char*>(dataFrame), receivedSize);
+
+            _receiveBuffer.assign(reinterpret_cast<const char*>(&dataFrame[used]), receivedSize - used);
+        } else {
+            _receiveBuffer.append(reinterpret_cast<const char*>(dataFrame), receivedSize);
+
+            uint32_t used = Deliver(_receiveBuffer.c_str(), static_cast<uint32_t>(_receiveBuffer.length()));
+
+            _receiveBuffer.erase(0, used);
+        }
+
+        if (_receiveBuffer.length() > RtspParser::MaxMessageSize) {
+            TRACE_L1("%s: Dropping %d bytes, message too large", __FUNCTION__, static_cast<uint32_t>(_receiveBuffer.length()));
+            _receiveBuffer.clear();
+            _scanned = 0;
+        }
+
         return receivedSize;
     }
 
+    uint32_t RtspSession::Socket::Deliver(const char data[], const uint32_t length)
+    {
+        const bool bSRM = (_rtspSession._srmSocket == this);
+        uint32_t offset = 0;
+        uint32_t size;
+
+        while ((size = RtspParser::Frame(&data[offset], length - offset, _scanned)) != 0) {
+            RtspMessagePtr response = _rtspSession._parser.ParseResponse(&data[offset], size);
+
+            if (response) {
+                _rtspSession.ProcessResponse(response, bSRM);
+            } else {
+                TRACE_L1("%s: UNKNOWN response of %d bytes", __FUNCTION__, size);
+            }
+
+            offset += size;
+            _scanned = 0;
+        }
+
+        return offset;
+    }
+
     void RtspSession::Socket::StateChange()
     {
         if (State() == 0) {
@@ -25,31 +25,42 @@
 #include <sys/un.h>
 
 #include <core/NodeId.h>
-#include <core/Queue.h>
 #include <core/SocketPort.h>
 #include <core/Timer.h>
 
+#include <functional>
+
 #include "RtspCommon.h"
 #include "RtspParser.h"
 
 namespace WPEFramework {
 namespace Plugin {
 
-    typedef Core::QueueType<RtspMessagePtr> RequestQueue;
-    typedef Core::QueueType<RtspMessagePtr> ResponseQueue;
-
     class RtspSession {
     public:
+        // Called once for every request sent with a completion: with the response, or with the reason
+        // there is none (ERR_TIMED_OUT, ERR_NO_ACTIVE_SESSION).
+        typedef std::function<void(const RtspReturnCode result, const RtspMessagePtr& response)> Completion;
+
         class Socket : public Core::SocketStream {
         public:
             Socket(const Core::NodeId& local, const Core::NodeId& remote, RtspSession& rtspSession);
             virtual ~Socket();
+            void Submit(const RtspMessagePtr& request);
             uint16_t SendData(uint8_t* dataFrame, const uint16_t maxSendSize);
             uint16_t ReceiveData(uint8_t* dataFrame, const uint16_t receivedSize);
             void StateChange();
 
+        private:
+            uint32_t Deliver(const char data[], const uint32_t length);
+
         private:
             RtspSession& _rtspSession;
+            Core::CriticalSection _lock;
+            std::list<RtspMessagePtr> _requestQueue;
+            uint32_t _sendOffset;
+            string _receiveBuffer; // Only holds the part of a message that did not arrive yet
+            uint32_t _scanned;
         };
 
         class AnnouncementHandler {
@@ -88,6 +99,12 @@ namespace Plugin {
             RtspSession* _parent;
         };
 
+    private:
+        struct Pending {
+            uint64_t deadline;
+            Completion completion;
+        };
+
     public:
         RtspSession(RtspSession::AnnouncementHandler& handler);
         ~RtspSession();
@@ -99,14 +116,18 @@ namespace Plugin {
         RtspReturnCode Get(const string name, string& value) const;
         RtspReturnCode Set(const string& name, const string& value);
 
+        // Send without waiting for anything, the completion is called when the response (matched on
+        // CSeq) arrives or when it timed out. Any number of requests can be outstanding.
+        RtspReturnCode Send(const RtspMessagePtr& request, const Completion& completion);
+        // Send and wait (at most ResponseWaitTime) for the response.
+        RtspReturnCode Send(const RtspMessagePtr& request, RtspMessagePtr& response);
+        // Send something that is not answered (a response to an announcement).
         RtspReturnCode Send(const RtspMessagePtr& request);
         RtspReturnCode SendHeartbeat(bool bSRM);
         RtspReturnCode SendHeartbeats();
 
-        RtspReturnCode ProcessResponse(const string& response, bool bSRM);
-        RtspReturnCode ProcessAnnouncement(const std::string& response, bool bSRM);
+        RtspReturnCode ProcessResponse(const RtspMessagePtr& response, bool bSRM);
         RtspReturnCode SendResponse(int respSeq, bool bSRM);
-        RtspReturnCode SendAnnouncement(int code, const string& reason);
 
         uint64_t Timed(const uint64_t scheduledTime);
 
@@ -121,6 +142,10 @@ namespace Plugin {
             return _sessionInfo.bSrmIsRtspProxy;
         }
 
+        bool Revoke(const uint32_t sequence);
+        void Expire(const uint64_t now);
+        void Abort();
+
     private:
         static constexpr uint16_t ResponseWaitTime = 3000;
         static constexpr uint16_t NptUpdateInterwal = 1000;
@@ -135,8 +160,10 @@ namespace Plugin {
         RtspParser _parser;
         RtspSessionInfo _sessionInfo;
         Core::CriticalSection _adminLock;
-        RequestQueue _requestQueue;
-        ResponseQueue _responseQueue;
+        Core::CriticalSection _pendingLock;
+        // Outstanding requests by CSeq. All requests get the same time to complete, so this is in the
+        // order of their deadlines as well, expiring them only needs to look at the front.
+        std::map<uint32_t, Pending> _pending;
         Core::TimerType<HeartbeatTimer> _heartbeatTimer;
 
         bool _isSessionActive;
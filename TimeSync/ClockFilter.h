@@ -0,0 +1,212 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TIMESYNC_CLOCKFILTER_H
+#define TIMESYNC_CLOCKFILTER_H
+
+#include "Module.h"
+
+#include <cmath>
+
+namespace WPEFramework {
+namespace Plugin {
+
+    // The sample processing of RFC 5905 (appendix A.5.2 - A.5.5), without the parts that only make
+    // sense for a continuously running daemon (poll adjustment, aging, clustering). All values are in
+    // seconds.
+    class ClockFilter {
+    public:
+        static constexpr uint8_t Stages = 8; // Size of the filter register (NSTAGE)
+        static constexpr double Tolerance = 15e-6; // Frequency tolerance (PHI), in s/s
+        static constexpr double MinimumDispersion = 0.005; // MINDISP
+        static constexpr double MaximumDistance = 1.5; // MAXDIST, larger root distances are not trusted
+
+        struct Sample {
+            double Offset;
+            double Delay;
+            double Dispersion;
+        };
+
+        // What the filter concluded about one server.
+        struct Peer {
+            double Offset;
+            double Delay;
+            double Dispersion;
+            double Jitter;
+            double Distance; // Root distance: the maximum error of Offset, as far as we can tell
+            uint32_t Source; // Not used by the filter, for the caller to tell the servers apart
+        };
+
+    public:
+        ClockFilter(const ClockFilter&) = delete;
+        ClockFilter& operator=(const ClockFilter&) = delete;
+
+        ClockFilter()
+            : _samples()
+        {
+        }
+        ~ClockFilter()
+        {
+        }
+
+    public:
+        inline bool IsEmpty() const
+        {
+            return (_samples.empty());
+        }
+        inline void Clear()
+        {
+            _samples.clear();
+        }
+        void Add(const Sample& sample)
+        {
+            if (_samples.size() == Stages) {
+                _samples.erase(_samples.begin());
+            }
+            _samples.push_back(sample);
+        }
+        // The sample with the lowest delay suffered the least from queueing on the way, so it is the most
+        // accurate one. The spread of the other samples around it is the jitter.
+        bool Evaluate(const double rootDelay, const double rootDispersion, Peer& peer) const
+        {
+            bool result = false;
+
+            if (_samples.empty() == false) {
+                std::vector<Sample> sorted(_samples);
+
+                std::sort(sorted.begin(), sorted.end(), [](const Sample& lhs, const Sample& rhs) { return (lhs.Delay < rhs.Delay); });
+
+                peer.Offset = sorted[0].Offset;
+                peer.Delay = sorted[0].Delay;
+                peer.Dispersion = 0;
+                peer.Jitter = 0;
+
+                double weight = 0.5;
+                for (const Sample& entry : sorted) {
+                    peer.Dispersion += (entry.Dispersion * weight);
+                    peer.Jitter += ((entry.Offset - peer.Offset) * (entry.Offset - peer.Offset));
+                    weight /= 2;
+                }
+
+                peer.Jitter = (sorted.size() > 1 ? std::sqrt(peer.Jitter / (sorted.size() - 1)) : 0);
+                peer.Distance = (std::max(static_cast<double>(MinimumDispersion), rootDelay + peer.Delay) / 2) + rootDispersion + peer.Dispersion + peer.Jitter;
+
+                result = (peer.Distance < MaximumDistance);
+            }
+
+            return (result);
+        }
+
+        // Intersection (Marzullo) over the correctness intervals [offset - distance, offset + distance]
+        // of the servers: the servers that are not part of the largest agreeing majority (falsetickers)
+        // are removed. The survivors are combined, weighted by their distance. Fails if there is no
+        // majority. On success, peers holds the survivors, the best one first.
+        static bool Combine(std::vector<Peer>& peers, double& offset, double& jitter)
+        {
+            struct Endpoint {
+                double Value;
+                int8_t Type; // -1 lower bound, 0 midpoint, +1 upper bound
+            };
+
+            const uint32_t count = static_cast<uint32_t>(peers.size());
+            std::vector<Endpoint> endpoints;
+            double low = 0;
+            double high = 0;
+            bool found = false;
+
+            endpoints.reserve(count * 3);
+            for (const Peer& peer : peers) {
+                endpoints.push_back({ peer.Offset - peer.Distance, -1 });
+                endpoints.push_back({ peer.Offset, 0 });
+                endpoints.push_back({ peer.Offset + peer.Distance, +1 });
+            }
+            std::sort(endpoints.begin(), endpoints.end(), [](const Endpoint& lhs, const Endpoint& rhs) { return (lhs.Value < rhs.Value); });
+
+            // Allow for an increasing number of falsetickers, until a majority agrees.
+            for (uint32_t allow = 0; ((found == false) && ((2 * allow) < count)); allow++) {
+                uint32_t midpoints = 0;
+                int32_t chime = 0;
+
+                low = HUGE_VAL;
+                for (uint32_t index = 0; index < endpoints.size(); index++) {
+                    chime -= endpoints[index].Type;
+                    if (chime >= static_cast<int32_t>(count - allow)) {
+                        low = endpoints[index].Value;
+                        break;
+                    }
+                    if (endpoints[index].Type == 0) {
+                        midpoints++;
+                    }
+                }
+
+                chime = 0;
+                high = -HUGE_VAL;
+                for (uint32_t index = static_cast<uint32_t>(endpoints.size()); index-- > 0;) {
+                    chime += endpoints[index].Type;
+                    if (chime >= static_cast<int32_t>(count - allow)) {
+                        high = endpoints[index].Value;
+                        break;
+                    }
+                    if (endpoints[index].Type == 0) {
+                        midpoints++;
+                    }
+                }
+
+                found = ((midpoints <= allow) && (low < high));
+            }
+
+            if (found == true) {
+                std::vector<Peer>::iterator index(peers.begin());
+
+                while (index != peers.end()) {
+                    if (((index->Offset + index->Distance) < low) || ((index->Offset - index->Distance) > high)) {
+                        index = peers.erase(index);
+                    } else {
+                        index++;
+                    }
+                }
+
+                std::sort(peers.begin(), peers.end(), [](const Peer& lhs, const Peer& rhs) { return (lhs.Distance < rhs.Distance); });
+
+                double weights = 0;
+                double sum = 0;
+                for (const Peer& peer : peers) {
+                    weights += (1 / peer.Distance);
+                    sum += (peer.Offset / peer.Distance);
+                }
+                offset = (sum / weights);
+
+                double spread = 0;
+                for (const Peer& peer : peers) {
+                    spread += (((peer.Offset - peers[0].Offset) * (peer.Offset - peers[0].Offset)) / peer.Distance);
+                }
+                jitter = std::sqrt((peers[0].Jitter * peers[0].Jitter) + (spread / weights));
+            }
+
+            return (found);
+        }
+
+    private:
+        std::vector<Sample> _samples;
+    };
+
+} // namespace Plugin
+} // namespace WPEFramework
+
+#endif // TIMESYNC_CLOCKFILTER_H
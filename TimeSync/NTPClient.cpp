@@ -20,6 +20,11 @@
 #include "NTPClient.h"
 #include <stdio.h>
 
+#ifndef __WINDOWS__
+#include <sys/time.h>
+#include <sys/timex.h>
+#endif
+
 namespace WPEFramework {
 namespace Plugin {
 
@@ -34,9 +39,16 @@ namespace Plugin {
         , _packet()
         , _syncedTimestamp()
         , _state(INITIAL)
-        , _fired(true)
         , _WaitForNetwork(2000) // Wait for 2 Seconds for a new attempt
         , _retryAttempts(5)
+        , _currentAttempt(0)
+        , _samples(4)
+        , _servers()
+        , _queue()
+        , _source()
+        , _offset(0)
+        , _lastCorrection(0)
+        , _frequency(0)
         , _activity(Core::ProxyType<Activity>::Create(this))
         , _clients()
     {
@@ -61,10 +73,12 @@ namespace Plugin {
         Close(Core::infinite);
     }
 
-    void NTPClient::Initialize(SourceIterator& sources, const uint16_t retries, const uint16_t delay)
+    void NTPClient::Initialize(SourceIterator& sources, const uint16_t retries, const uint16_t delay, const uint8_t samples)
     {
         _retryAttempts = retries;
         _WaitForNetwork = (delay * 1000); /* in ms */
+        _samples = std::max(static_cast<uint8_t>(1), std::min(samples, static_cast<uint8_t>(ClockFilter::Stages)));
+        _queue.clear();
         _servers.clear();
 
         while (sources.Next() == true) {
@@ -82,11 +96,9 @@ namespace Plugin {
                     hostname += ':' + Core::NumberType<uint16_t>(Core::URL::Port(url.Type())).Text();
                 }
 
-                _servers.push_back(hostname);
+                _servers.emplace_back(hostname);
             }
         }
-
-        _serverIndex = ServerIterator(_servers);
     }
 
     /* virtual */ uint32_t NTPClient::Synchronize()
@@ -97,7 +109,7 @@ namespace Plugin {
 
         _adminLock.Lock();
 
-        if ((_state == INITIAL) || (_state == SUCCESS) || ((_state == FAILED) && (_serverIndex.IsValid() == false))) {
+        if ((_state == INITIAL) || (_state == SUCCESS) || (_state == FAILED)) {
             result = Core::ERROR_NONE;
             _state = SENDREQUEST;
             Core::IWorkerPool::Instance().Submit(_activity);
@@ -136,7 +148,11 @@ namespace Plugin {
 
     /* virtual */ string NTPClient::Source() const
     {
-        return (_serverIndex.IsValid() == true ? string(_T("NTP://")) + (*_serverIndex) + '/' : _T("NTP:///"));
+        _adminLock.Lock();
+        const string result(string(_T("NTP://")) + _source + '/');
+        _adminLock.Unlock();
+
+        return (result);
     }
 
     /* virtual */ void NTPClient::Register(Exchange::ITimeSync::INotification* notification)
@@ -174,17 +190,24 @@ namespace Plugin {
 
         _adminLock.Lock();
 
-        if (_fired == false) {
+        if (_queue.empty() == false) {
 
-            _fired = true;
+            // One datagram per call, the socket keeps asking as long as we have something to send.
+            Server* server = _queue.front();
+            _queue.pop_front();
 
+            RemoteNode(server->Node);
+
+            Core::Time now(Core::Time::Now());
             DataFrame newFrame(dataFrame, maxSendSize);
             DataFrame::Writer writer(newFrame, 0);
-            _packet.TransmitTimestamp(NTPPacket::Timestamp(Core::Time::Now()));
+            _packet.TransmitTimestamp(NTPPacket::Timestamp(now));
             _packet.Serialize(writer);
 
+            server->Transmit = static_cast<double>(now.Ticks()) / MicroSeconds;
+
             result = newFrame.Size();
-            TRACE_L1("Timesync: Send data: %d bytes", result);
+            TRACE_L1("Timesync: Send data: %d bytes to %s", result, server->Name.c_str());
         }
 
         _adminLock.Unlock();
@@ -192,20 +215,15 @@ namespace Plugin {
         return result;
     }
 
-    inline static uint64_t SecondsToTicks(double seconds)
-    {
-        return static_cast<uint64_t>(seconds * NTPClient::MicroSeconds);
-    }
-
     /* virtual */ uint16_t NTPClient::ReceiveData(uint8_t* dataFrame, const uint16_t receivedSize)
     {
-        double received = static_cast<double>(Core::Time::Now().Ticks() / MicroSeconds);
+        const double received = static_cast<double>(Core::Time::Now().Ticks()) / MicroSeconds;
 
         TRACE_L1("Timesync: Received data: %d bytes", receivedSize);
 
         _adminLock.Lock();
 
-        if (receivedSize == NTPPacket::PacketSize) {
+        if ((receivedSize == NTPPacket::PacketSize) && (_state == INPROGRESS)) {
 
             DataFrame frame(dataFrame, receivedSize, receivedSize);
             NTPPacket packet;
@@ -215,49 +233,56 @@ namespace Plugin {
 // packet.DisplayPacket();
 #endif
 
-            double receivedServerTS = packet.ReceiveTimestamp().TimeSeconds();
-            double sentServerTS = packet.TransmitTimestamp().TimeSeconds();
-            double sentTS = packet.OriginalTimestamp().TimeSeconds();
-
-            double diffRequest = receivedServerTS - sentTS;
-            double diffResponse = sentServerTS - received;
-            double offset = (diffRequest + diffResponse) / 2;
-
-#ifdef __DEBUG__
-            double elapsedServer = sentServerTS - receivedServerTS;
-            double elapsedTotal = received - sentTS;
-            double roundTrip = elapsedTotal - elapsedServer;
-#endif
+            std::list<Server>::iterator server(_servers.begin());
+            while ((server != _servers.end()) && ((server->Pending == false) || (server->Node != ReceivedNode()))) {
+                server++;
+            }
 
-            TRACE_L1("Request time diff  = %lf", diffRequest);
-            TRACE_L1("Response time diff = %lf", diffResponse);
-            TRACE_L1("Offset time        = %lf", offset);
+            if (server == _servers.end()) {
+                TRACE_L1("TimeSync: Dropped an unexpected response from %s", ReceivedNode().HostAddress().c_str());
+            } else {
+                // The four timestamps of an exchange, T1 and T4 on our clock, T2 and T3 on the clock of the server.
+                const double sentTS = packet.OriginalTimestamp().TimeSeconds();
+                const double receivedServerTS = packet.ReceiveTimestamp().TimeSeconds();
+                const double sentServerTS = packet.TransmitTimestamp().TimeSeconds();
+
+                if (std::fabs(sentTS - server->Transmit) > 1e-6) {
+                    // Not the answer to our last request (a duplicate, or a late one), keep waiting.
+                    TRACE_L1("TimeSync: Dropped a stale response from %s", server->Name.c_str());
+                } else {
+                    server->Pending = false;
 
-#ifdef __DEBUG__
-            TRACE_L1("Server elapsed time = %lf", elapsedServer);
-            TRACE_L1("Total elapsed time  = %lf", elapsedTotal);
-            TRACE_L1("Round trip time     = %lf", roundTrip);
-#endif
-            TRACE(Trace::Information, (_T("TimeSync: Request time diff   = %lf s"), diffRequest));
-            TRACE(Trace::Information, (_T("TimeSync: Response time diff  = %lf s"), diffResponse));
-            TRACE(Trace::Information, (_T("TimeSync: Offset time         = %lf s"), offset));
+                    if ((packet.NTPMode() != 4 /* server */) || (packet.Stratum() == 0) || (packet.Stratum() >= 16) || (packet.LeapIndicator() == 3 /* unsynchronized */)) {
+                        TRACE(Trace::Warning, (_T("TimeSync: NTP Server [%s] is not synchronized"), server->Name.c_str()));
+                    } else {
+                        const double Fraction_16_16 = 65536.0;
 
-            uint64_t receivedTicks = SecondsToTicks(received);
-            TRACE(Trace::Information, (_T("TimeSync: Current time: %s"), Core::Time(receivedTicks).ToRFC1123(false).c_str()));
-            _syncedTimestamp = Core::Time(receivedTicks + SecondsToTicks(offset));
-            TRACE(Trace::Information, (_T("TimeSync: New time:     %s"), _syncedTimestamp.ToRFC1123(false).c_str()));
+                        ClockFilter::Sample sample;
+                        sample.Offset = ((receivedServerTS - sentTS) + (sentServerTS - received)) / 2;
+                        sample.Delay = std::max(0.0, (received - sentTS) - (sentServerTS - receivedServerTS));
+                        sample.Dispersion = std::ldexp(1.0, static_cast<int8_t>(packet.Precision()))
+                            + std::ldexp(1.0, static_cast<int8_t>(_packet.Precision()))
+                            + (ClockFilter::Tolerance * (received - sentTS));
 
-            _state = SUCCESS;
+                        server->Filter.Add(sample);
+                        server->RootDelay = packet.RootDelay() / Fraction_16_16;
+                        server->RootDispersion = packet.RootDispersion() / Fraction_16_16;
 
-            // We don't need the socket anymore, so close it
-            TRACE_L1("TimeSync: %s", "Closing socket, no longer needed");
-            Close(0);
+                        TRACE(Trace::Information, (_T("TimeSync: [%s] offset = %lf s, delay = %lf s"), server->Name.c_str(), sample.Offset, sample.Delay));
+                    }
 
-            // Lets remove the watchdog subject, we do not want to wait anymore, we got an answer.
-            Core::IWorkerPool::Instance().Revoke(_activity);
+                    server = _servers.begin();
+                    while ((server != _servers.end()) && (server->Pending == false)) {
+                        server++;
+                    }
 
-            // Schedule it again to broadcast the successfull update of the time.
-            Core::IWorkerPool::Instance().Submit(_activity);
+                    if (server == _servers.end()) {
+                        // Every server answered, no need to wait for the timeout before asking the next sample.
+                        Core::IWorkerPool::Instance().Revoke(_activity);
+                        Core::IWorkerPool::Instance().Submit(_activity);
+                    }
+                }
+            }
         }
 
         _adminLock.Unlock();
@@ -275,9 +300,60 @@ namespace Plugin {
         }
     }
 
-    bool NTPClient::FireRequest()
+    bool NTPClient::Adjust()
     {
+        bool slewed = false;
+
+        _adminLock.Lock();
+
+        const uint64_t now = Core::Time::Now().Ticks();
+
+#ifndef __WINDOWS__
+        if ((_offset < SlewThreshold) && (_offset > -static_cast<int64_t>(SlewThreshold))) {
+
+            if ((_lastCorrection != 0) && (now > _lastCorrection)) {
+                const double elapsed = static_cast<double>(now - _lastCorrection) / MicroSeconds;
+
+                if (elapsed >= DriftInterval) {
+                    // What built up since the last correction is caused by the frequency error of our clock,
+                    // an offset in us over a period in s is a frequency error in ppm.
+                    _frequency = std::max(-MaximumFrequency, std::min(static_cast<double>(MaximumFrequency), _frequency + (_offset / elapsed)));
+
+                    struct timex frequency;
+                    ::memset(&frequency, 0, sizeof(frequency));
+                    frequency.modes = ADJ_FREQUENCY;
+                    frequency.freq = static_cast<long>(_frequency * 65536); // ppm with a 16 bit fraction
 
+                    if (::adjtimex(&frequency) == -1) {
+                        TRACE(Trace::Warning, (_T("TimeSync: Could not correct the clock frequency [%d]"), errno));
+                    } else {
+                        TRACE(Trace::Information, (_T("TimeSync: Clock frequency corrected by %lf ppm"), _frequency));
+                    }
+                }
+            }
+
+            struct timeval delta;
+            delta.tv_sec = static_cast<time_t>(_offset / MicroSeconds);
+            delta.tv_usec = static_cast<suseconds_t>(_offset % MicroSeconds);
+
+            slewed = (::adjtime(&delta, nullptr) == 0);
+
+            if (slewed == false) {
+                TRACE(Trace::Warning, (_T("TimeSync: Could not slew the clock [%d]"), errno));
+            }
+        }
+#endif
+
+        _lastCorrection = now;
+
+        _adminLock.Unlock();
+
+        return (slewed);
+    }
+
+    // Resolve the servers and open the socket all requests go out on.
+    bool NTPClient::Start()
+    {
         bool activated = false;
 
         // Make sure socket is closed otherwise an assert will fire.
@@ -286,52 +362,112 @@ namespace Plugin {
             Close(1000);
         }
 
-        if (true == IsClosed() && (_serverIndex.Count() > 0)) {
+        if (IsClosed() == true) {
+            Core::NodeId local;
 
-            uint32_t lastonetried = _serverIndex.Index();
+            for (Server& server : _servers) {
+                server.Node = Core::NodeId(server.Name.c_str(), Core::NodeId::TYPE_IPV4);
+
+                if (server.Node.IsValid() == false) {
+                    TRACE(Trace::Warning, (_T("Could not resolve NTP Server [%s]"), server.Name.c_str()));
+                } else if (local.IsValid() == false) {
+                    local = server.Node.AnyInterface();
+                    RemoteNode(server.Node);
+                }
+            }
 
-            do {
+            if (local.IsValid() == true) {
+                LocalNode(local);
 
-                // next server
-                if( _serverIndex.Index() >= _serverIndex.Count() ) {
-                    _serverIndex.Reset(0);
+                // UDP should open by definition directly...
+                uint32_t status = Open(100);
+
+                if ((status == Core::ERROR_NONE) || (status == Core::ERROR_INPROGRESS)) {
+                    activated = true;
+                } else {
+                    TRACE(Trace::Warning, (_T("Could not open a socket for the NTP Servers")));
                 }
-                _serverIndex.Next();
-                ASSERT(_serverIndex.IsValid());
+            }
+        }
 
-                TRACE(Trace::Information, (_T("Trying NTP Server: [%s]"), (*_serverIndex).c_str()));
+        return (activated);
+    }
 
-                // Set the socket to send to the remote
-                Core::NodeId remote((*_serverIndex).c_str(), Core::NodeId::TYPE_IPV4);
+    // Ask the next sample of every server that did not give all of them yet. A request that is still
+    // pending by now is considered lost.
+    bool NTPClient::Query()
+    {
+        _queue.clear();
 
-                if (remote.IsValid() == true) {
-                    // Set the remote endpoint for the socket to the selected NTP server
-                    RemoteNode(remote);
-                    LocalNode(remote.AnyInterface());
+        for (Server& server : _servers) {
+            server.Pending = false;
 
-                    // UDP should open by definition directly...
-                    uint32_t status = Open(100);
+            if ((server.Node.IsValid() == true) && (server.Sent < _samples)) {
+                server.Sent++;
+                server.Pending = true;
+                _queue.push_back(&server);
+            }
+        }
 
-                    if ((status == Core::ERROR_NONE) || (status == Core::ERROR_INPROGRESS)) {
+        if (_queue.empty() == false) {
+            Trigger();
+        }
 
-                        activated = true;
-                        _fired = false;
-                        Trigger();
-                    }
-                    else {
-                        TRACE(Trace::Warning, (_T("Could not open connection to NTP Server [%s]"), (*_serverIndex).c_str()));
-                    }
-                }
-                else {
-                    TRACE(Trace::Warning, (_T("Could not resolve NTP Server [%s]"), (*_serverIndex).c_str()));
-                }
+        return (_queue.empty() == false);
+    }
+
+    bool NTPClient::Select()
+    {
+        bool result = false;
+        std::vector<ClockFilter::Peer> peers;
+        uint32_t index = 0;
+
+        for (const Server& server : _servers) {
+            ClockFilter::Peer peer;
+
+            if (server.Filter.Evaluate(server.RootDelay, server.RootDispersion, peer) == true) {
+                peer.Source = index;
+                peers.push_back(peer);
             }
-            while ((activated == false) && ( ((lastonetried != 0) && (lastonetried != _serverIndex.Index())) ||
-                                             ((lastonetried == 0) && (_serverIndex.Index() != _serverIndex.Count())) 
-                                           ) );
+            index++;
         }
 
-        return (activated);
+        const uint32_t candidates = static_cast<uint32_t>(peers.size());
+        double offset = 0;
+        double jitter = 0;
+
+        if (candidates == 0) {
+            TRACE(Trace::Warning, (_T("TimeSync: None of the NTP Servers gave a usable response")));
+        } else if (ClockFilter::Combine(peers, offset, jitter) == false) {
+            TRACE(Trace::Warning, (_T("TimeSync: The NTP Servers do not agree on the time")));
+        } else {
+            std::list<Server>::const_iterator best(_servers.begin());
+            std::advance(best, peers[0].Source);
+
+            _source = best->Name;
+            _offset = static_cast<int64_t>(offset * MicroSeconds);
+            _syncedTimestamp = Core::Time(Core::Time::Now().Ticks() + _offset);
+
+            TRACE(Trace::Information, (_T("TimeSync: Offset time         = %lf s"), offset));
+            TRACE(Trace::Information, (_T("TimeSync: Jitter              = %lf s"), jitter));
+            TRACE(Trace::Information, (_T("TimeSync: %d of %d NTP Servers selected, best is [%s]"), static_cast<uint32_t>(peers.size()), candidates, _source.c_str()));
+            TRACE(Trace::Information, (_T("TimeSync: New time:     %s"), _syncedTimestamp.ToRFC1123(false).c_str()));
+
+            result = true;
+        }
+
+        return (result);
+    }
+
+    void NTPClient::Reset()
+    {
+        _queue.clear();
+
+        for (Server& server : _servers) {
+            server.Filter.Clear();
+            server.Sent = 0;
+            server.Pending = false;
+        }
     }
 
     void NTPClient::Update()
@@ -360,27 +496,39 @@ namespace Plugin {
 
         switch (_state) {
         case SENDREQUEST: {
-            // This case means that nothing has started yet, let reset the list of servers and start at the beginning...
-            _serverIndex.Reset(0);
+            // This case means that nothing has started yet, let forget the samples of the previous time and start over...
+            Reset();
             _state = INPROGRESS;
             _currentAttempt = _retryAttempts;
         }
         case INPROGRESS: {
-            // If we end up here in this state, it means that the package was send but no response was received,
-            // or a response was received but is was not properly formatted...
-            // Lets move to the next server in the list, see if that one responds correctly, if we tried all servers let's
-            // start at the first one again, this time it might work
-            if (FireRequest() == true) {
-              result = WaitForResponse;
-            } else {
+            // All servers are asked in parallel, a sample at a time. We end up here when all of them answered
+            // or the previous round of requests timed out.
+            if ((IsOpen() == true) || (Start() == true)) {
+                if (Query() == true) {
+                    result = WaitForResponse;
+                } else if (Select() == true) {
+                    // We don't need the socket anymore, so close it
+                    TRACE_L1("TimeSync: %s", "Closing socket, no longer needed");
+                    Close(0);
+
+                    _state = SUCCESS;
+                    Update();
+                    break;
+                } else {
+                    Close(0);
+                    Reset();
+                }
+            }
+
+            if (result == Core::infinite) {
                 if (_currentAttempt-- != 0) {
 
                     // Looks like there is no network connectivity, Just sleep and retry later
                     result = _WaitForNetwork;
                 } else {
 
-                    // Looks like there is no valid server anymore that we could use. There where servers
-                    // that did resolve correctly, so it is not a network connectivity problem.
+                    // Looks like there is no valid server anymore that we could use.
                     _state = FAILED;
 
                     // Report the failure. Always report back when we are finished.
@@ -21,6 +21,7 @@
 #define TIMESYNC_NTPCLIENT_H
 
 #include "Module.h"
+#include "ClockFilter.h"
 #include <interfaces/ITimeSync.h>
 
 namespace WPEFramework {
@@ -34,9 +35,14 @@ namespace Plugin {
 
         using SourceIterator = Core::JSON::ArrayType<Core::JSON::String>::Iterator;
 
+        // Offsets below this are corrected by slewing the clock, larger ones by stepping it (STEPT).
+        static constexpr uint32_t SlewThreshold = 128 * MilliSeconds; // us
+        // The frequency error is only estimated over (at least) this period, so a slew started by the
+        // previous synchronisation has certainly completed.
+        static constexpr uint32_t DriftInterval = 1024; // s
+        static constexpr double MaximumFrequency = 500; // ppm
+
     private:
-        using ServerList = std::vector<string>;
-        using ServerIterator = Core::IteratorType<const ServerList, const string&, ServerList::const_iterator>;
         using DataFrame = Core::FrameType<0>;
 
         // This enum tracks the state for actions begin performed. As the Worker() method is re-entered,
@@ -44,9 +50,9 @@ namespace Plugin {
         enum state {
             INITIAL, // Initial state
             SENDREQUEST, // Let send out an NTP request to a legitimate server.
-            INPROGRESS, // A request has been sent to a NTP server, waiting for a response
-            SUCCESS, // Action succeeded, we received a valid response from an NTP server
-            FAILED // Action failed, we did not receive any valid response from any of the NTP servers
+            INPROGRESS, // Requests are being sent to the NTP servers, collecting samples
+            SUCCESS, // Action succeeded, the samples of the NTP servers agree on the time
+            FAILED // Action failed, we did not receive enough valid responses from the NTP servers
         };
         // As this forms the exact package to be sent for NTP, we need to make sure all members are byte
         // aligned
@@ -328,6 +334,34 @@ namespace Plugin {
                 // bit (NTP time)
         };
 
+        // An NTP server and the samples it gave in the current synchronisation.
+        struct Server {
+            Server() = delete;
+            Server(const Server&) = delete;
+            Server& operator=(const Server&) = delete;
+
+            explicit Server(const string& name)
+                : Name(name)
+                , Node()
+                , Filter()
+                , Transmit(0)
+                , RootDelay(0)
+                , RootDispersion(0)
+                , Sent(0)
+                , Pending(false)
+            {
+            }
+
+            string Name;
+            Core::NodeId Node;
+            ClockFilter Filter;
+            double Transmit; // Local time the outstanding request was sent, in seconds
+            double RootDelay; // As reported by the server, in seconds
+            double RootDispersion; // As reported by the server, in seconds
+            uint8_t Sent;
+            bool Pending; // Waiting for a response on the request sent last
+        };
+
         class Activity : public Core::IDispatchType<void> {
         private:
             Activity() = delete;
@@ -363,7 +397,10 @@ namespace Plugin {
         virtual ~NTPClient();
 
     public:
-        void Initialize(SourceIterator& sources, const uint16_t retries, const uint16_t delay);
+        void Initialize(SourceIterator& sources, const uint16_t retries, const uint16_t delay, const uint8_t samples);
+        // Correct the clock gradually towards the last synchronised time. Returns false if the offset is
+        // too large for that, and the clock needs to be set.
+        bool Adjust();
         virtual void Register(Exchange::ITimeSync::INotification* notification) override;
         virtual void Unregister(Exchange::ITimeSync::INotification* notification) override;
 
@@ -393,19 +430,26 @@ namespace Plugin {
 
         void Update();
         void Dispatch();
-        bool FireRequest();
+        bool Start();
+        bool Query();
+        bool Select();
+        void Reset();
 
     private:
-        Core::CriticalSection _adminLock;
+        mutable Core::CriticalSection _adminLock;
         NTPPacket _packet;
         Core::Time _syncedTimestamp;
         state _state;
-        bool _fired;
         uint32_t _WaitForNetwork;
         uint32_t _retryAttempts;
         uint32_t _currentAttempt;
-        ServerList _servers;
-        ServerIterator _serverIndex;
+        uint8_t _samples;
+        std::list<Server> _servers;
+        std::list<Server*> _queue;
+        string _source;
+        int64_t _offset; // Of the last synchronisation, in us
+        uint64_t _lastCorrection;
+        double _frequency; // Correction of the local clock frequency, in ppm
         Core::ProxyType<Core::IDispatchType<void>> _activity;
         std::list<Exchange::ITimeSync::INotification*> _clients;
     };
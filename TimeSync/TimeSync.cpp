@@ -65,7 +65,7 @@ namespace Plugin {
 
         NTPClient::SourceIterator index(config.Sources.Elements());
 
-        static_cast<NTPClient*>(_client)->Initialize(index, config.Retries.Value(), config.Interval.Value());
+        static_cast<NTPClient*>(_client)->Initialize(index, config.Retries.Value(), config.Interval.Value(), config.Samples.Value());
 
         ASSERT(service != nullptr);
         ASSERT(_service == nullptr);
@@ -174,9 +174,14 @@ namespace Plugin {
     {
         Core::Time newTime(time);
 
-        TRACE(Trace::Information, (_T("Syncing time to %s."), newTime.ToRFC1123(false).c_str()));
+        // Small offsets are slewed away, so the time never jumps (backwards) for anyone using it.
+        if (static_cast<NTPClient*>(_client)->Adjust() == true) {
+            TRACE(Trace::Information, (_T("Slewing time to %s."), newTime.ToRFC1123(false).c_str()));
+        } else {
+            TRACE(Trace::Information, (_T("Syncing time to %s."), newTime.ToRFC1123(false).c_str()));
 
-        Core::SystemInfo::Instance().SetTime(newTime);
+            Core::SystemInfo::Instance().SetTime(newTime);
+        }
 
         if (_periodicity != 0) {
             Core::Time newSyncTime(Core::Time::Now());
@@ -155,12 +155,14 @@ namespace Plugin {
                 , Retries(8)
                 , Sources()
                 , Periodicity(0)
+                , Samples(4)
             {
                 Add(_T("deferred"), &Deferred);
                 Add(_T("interval"), &Interval);
                 Add(_T("retries"), &Retries);
                 Add(_T("sources"), &Sources);
                 Add(_T("periodicity"), &Periodicity);
+                Add(_T("samples"), &Samples);
             }
             ~Config()
             {
@@ -172,6 +174,7 @@ namespace Plugin {
             Core::JSON::DecUInt8 Retries;
             Core::JSON::ArrayType<Core::JSON::String> Sources;
             Core::JSON::DecUInt16 Periodicity;
+            Core::JSON::DecUInt8 Samples;
         };
 
         class PeriodicSync : public Core::IDispatch {
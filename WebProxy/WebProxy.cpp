@@ -225,6 +225,17 @@ namespace Plugin {
         config.FromString(service->ConfigLine());
 
         _maxConnections = config.Connections.Value();
+        // Larger link buffers move more data per system call, but there is no use in going beyond the ring buffers.
+        _bufferSize = std::min(config.BufferSize.Value(), static_cast<uint16_t>(Connector::RelayBufferSize));
+
+        // A link without buffers can not relay anything, fall back to the default size.
+        if (_bufferSize == 0) {
+            _bufferSize = config.BufferSize.Default();
+            SYSLOG(Logging::Startup, (_T("WebProxy buffersize 0 is invalid, using %d bytes"), _bufferSize));
+        }
+
+        // The connection count is bounded, so size the table once and never rehash on the data path.
+        _connectionMap.reserve(_maxConnections);
 
         // Copy all predefined links...
         if ((config.Links.IsSet() == true) && (config.Links.Length() != 0)) {
@@ -258,7 +269,7 @@ namespace Plugin {
         Core::NodeId nodeId;
 
         // First do a cleanup of all "completely" closed channels.
-        std::map<const uint32_t, Connector*>::iterator connection(_connectionMap.begin());
+        ConnectionMap::iterator connection(_connectionMap.begin());
 
         while (connection != _connectionMap.end()) {
             if (connection->second->IsClosed() == true) {
@@ -274,7 +285,7 @@ namespace Plugin {
             Connector* newLink = CreateConnector(channel);
 
             if (newLink != nullptr) {
-                _connectionMap.insert(std::pair<uint32_t, Connector*>(channel.Id(), newLink));
+                _connectionMap.emplace(channel.Id(), newLink);
                 TRACE(Trace::Information, (Trace::Format(_T("Proxy connection channel ID [%d] to %s"), channel.Id(), newLink->RemoteId().c_str()).c_str()));
                 added = true;
 
@@ -288,7 +299,7 @@ namespace Plugin {
     /* virtual */ void WebProxy::Detach(PluginHost::Channel& channel)
     {
         // See if we can forward this info..
-        std::map<const uint32_t, Connector*>::iterator connection = _connectionMap.find(channel.Id());
+        ConnectionMap::iterator connection = _connectionMap.find(channel.Id());
 
         if (connection != _connectionMap.end()) {
             connection->second->Detach();
@@ -310,7 +321,7 @@ namespace Plugin {
         uint32_t result = length;
 
         // See if we can forward this info..
-        std::map<const uint32_t, Connector*>::iterator connection = _connectionMap.find(ID);
+        ConnectionMap::iterator connection = _connectionMap.find(ID);
 
         if (connection != _connectionMap.end()) {
             result = connection->second->ChannelReceive(data, length);
@@ -326,7 +337,7 @@ namespace Plugin {
         uint32_t result = 0;
 
         // See if we can forward this info..
-        std::map<const uint32_t, Connector*>::const_iterator connection = _connectionMap.find(ID);
+        ConnectionMap::const_iterator connection = _connectionMap.find(ID);
 
         if (connection != _connectionMap.end()) {
             result = connection->second->ChannelSend(data, length);
@@ -395,12 +406,12 @@ namespace Plugin {
             Core::NodeId remote(host.Text().c_str());
 
             if (datagram == true) {
-                result = new ConnectorWrapper<DatagramChannel>(channel, 1024, remote);
+                result = new ConnectorWrapper<DatagramChannel>(channel, _bufferSize, remote);
             } else {
-                result = new ConnectorWrapper<StreamChannel>(channel, 1024, remote);
+                result = new ConnectorWrapper<StreamChannel>(channel, _bufferSize, remote);
             }
         } else if ((device.Length() > 0) && (host.Length() == 0)) {
-            result = new ConnectorWrapper<DeviceChannel>(channel, 1024, device.Text(), baudRate, parity, dataBits, stopBits, flowControl);
+            result = new ConnectorWrapper<DeviceChannel>(channel, _bufferSize, device.Text(), baudRate, parity, dataBits, stopBits, flowControl);
         }
 
         if ((result != nullptr) && (text == true)) {
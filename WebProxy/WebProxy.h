@@ -22,6 +22,8 @@
 
 #include "Module.h"
 
+#include <unordered_map>
+
 namespace WPEFramework {
 namespace Plugin {
 
@@ -30,6 +32,14 @@ namespace Plugin {
         WebProxy(const WebProxy&) = delete;
         WebProxy& operator=(const WebProxy&) = delete;
 
+    public:
+        class Connector;
+
+    private:
+        // Every Inbound/Outbound call needs to find the connector of the channel, keep this a
+        // constant time lookup, independent of the number of open connections.
+        typedef std::unordered_map<uint32_t, Connector*> ConnectionMap;
+
     public:
         class Connector {
         private:
@@ -37,6 +47,9 @@ namespace Plugin {
             Connector& operator=(const Connector&) = delete;
 
         public:
+            // Size of the ring buffers between the websocket and the link, in each direction.
+            static constexpr uint16_t RelayBufferSize = 8192;
+
             Connector(PluginHost::Channel& channel, Core::IStream* link)
                 : _link(link)
                 , _channel(&channel)
@@ -161,8 +174,8 @@ namespace Plugin {
             Core::IStream* _link;
             PluginHost::Channel* _channel;
             mutable Core::CriticalSection _adminLock;
-            Core::CyclicDataBuffer<Core::ScopedStorage<8192>> _channelBuffer;
-            Core::CyclicDataBuffer<Core::ScopedStorage<8192>> _socketBuffer;
+            Core::CyclicDataBuffer<Core::ScopedStorage<RelayBufferSize>> _channelBuffer;
+            Core::CyclicDataBuffer<Core::ScopedStorage<RelayBufferSize>> _socketBuffer;
         };
         class Config : public Core::JSON::Container {
         public:
@@ -318,8 +331,10 @@ namespace Plugin {
             Config()
                 : Core::JSON::Container()
                 , Connections(10)
+                , BufferSize(1024)
             {
                 Add(_T("connections"), &Connections);
+                Add(_T("buffersize"), &BufferSize);
                 Add(_T("links"), &Links);
             }
             ~Config()
@@ -328,12 +343,18 @@ namespace Plugin {
 
         public:
             Core::JSON::DecUInt16 Connections;
+            // Socket/serial buffer size of the links, in bytes, capped at the relay ring buffers.
+            Core::JSON::DecUInt16 BufferSize;
             Core::JSON::ArrayType<Link> Links;
         };
 
     public:
         WebProxy()
-            : _connectionMap()
+            : _prefix()
+            , _maxConnections(0)
+            , _bufferSize(0)
+            , _connectionMap()
+            , _linkInfo()
         {
         }
         virtual ~WebProxy()
@@ -389,7 +410,8 @@ namespace Plugin {
     private:
         string _prefix;
         uint32_t _maxConnections;
-        std::map<const uint32_t, Connector*> _connectionMap;
+        uint16_t _bufferSize;
+        ConnectionMap _connectionMap;
         std::map<const string, Config::Link> _linkInfo;
     };
 }
@@ -21,6 +21,10 @@
 #include <interfaces/IMemory.h>
 #include <interfaces/IWebServer.h>
 
+#ifndef __WINDOWS__
+#include <sys/inotify.h>
+#endif
+
 namespace WPEFramework {
 namespace Plugin {
 
@@ -85,6 +89,35 @@ namespace Plugin {
             std::string _text;
         };
 
+        class ProxyStatistics {
+        private:
+            ProxyStatistics(const ProxyStatistics& a_Copy) = delete;
+            ProxyStatistics& operator=(const ProxyStatistics& a_RHS) = delete;
+
+        public:
+            ProxyStatistics(const string& path, const uint32_t requests, const uint32_t averageLatency, const uint32_t maxLatency, const uint32_t maxQueueDepth)
+            {
+                _text = Trace::Format(_T("Proxy [%s]: requests: %u, latency avg: %u us, max: %u us, max queue depth: %u"),
+                    path.c_str(), requests, averageLatency, maxLatency, maxQueueDepth);
+            }
+            ~ProxyStatistics()
+            {
+            }
+
+        public:
+            inline const char* Data() const
+            {
+                return (_text.c_str());
+            }
+            inline uint16_t Length() const
+            {
+                return (static_cast<uint16_t>(_text.length()));
+            }
+
+        private:
+            std::string _text;
+        };
+
         class Config : public Core::JSON::Container {
         private:
             Config(const Config&) = delete;
@@ -101,20 +134,28 @@ namespace Plugin {
                     , Path()
                     , Subst()
                     , Server()
+                    , Connections(1)
+                    , Pipeline(1)
                 {
                     Add(_T("path"), &Path);
                     Add(_T("subst"), &Subst);
                     Add(_T("server"), &Server);
+                    Add(_T("connections"), &Connections);
+                    Add(_T("pipeline"), &Pipeline);
                 }
                 Proxy(const Proxy& copy)
                     : Core::JSON::Container()
                     , Path(copy.Path)
                     , Subst(copy.Subst)
                     , Server(copy.Server)
+                    , Connections(copy.Connections)
+                    , Pipeline(copy.Pipeline)
                 {
                     Add(_T("path"), &Path);
                     Add(_T("subst"), &Subst);
                     Add(_T("server"), &Server);
+                    Add(_T("connections"), &Connections);
+                    Add(_T("pipeline"), &Pipeline);
                 }
                 virtual ~Proxy()
                 {
@@ -124,6 +165,31 @@ namespace Plugin {
                 Core::JSON::String Path;
                 Core::JSON::String Subst;
                 Core::JSON::String Server;
+                Core::JSON::DecUInt8 Connections; // Maximum number of keep-alive connections to the server
+                Core::JSON::DecUInt8 Pipeline; // Maximum number of requests in flight per connection
+            };
+
+            class Cache : public Core::JSON::Container {
+            private:
+                Cache(const Cache&) = delete;
+                Cache& operator=(const Cache&) = delete;
+
+            public:
+                Cache()
+                    : Core::JSON::Container()
+                    , Size(0)
+                    , FileSize(256)
+                {
+                    Add(_T("size"), &Size);
+                    Add(_T("filesize"), &FileSize);
+                }
+                ~Cache()
+                {
+                }
+
+            public:
+                Core::JSON::DecUInt32 Size; // Total cache size in KB, 0 disables the cache
+                Core::JSON::DecUInt32 FileSize; // Largest file (in KB) that is kept in the cache
             };
 
         public:
@@ -134,6 +200,7 @@ namespace Plugin {
                 , Interface()
                 , Path(_T("www"))
                 , IdleTime(180)
+                , FileCache()
             {
                 Add(_T("port"), &Port);
                 Add(_T("binding"), &Binding);
@@ -141,6 +208,7 @@ namespace Plugin {
                 Add(_T("path"), &Path);
                 Add(_T("idletime"), &IdleTime);
                 Add(_T("proxies"), &Proxies);
+                Add(_T("cache"), &FileCache);
             }
             ~Config()
             {
@@ -153,6 +221,7 @@ namespace Plugin {
             Core::JSON::String Path;
             Core::JSON::DecUInt16 IdleTime;
             Core::JSON::ArrayType<Proxy> Proxies;
+            Cache FileCache;
         };
 
         class RequestFactory {
@@ -197,18 +266,449 @@ namespace Plugin {
             }
         };
 
+        // Static content that is requested over and over again (e.g. UI bundles loaded by all clients at boot)
+        // is kept resident in a bounded LRU cache. This saves the open/stat/read cycle of a Web::FileBody on
+        // every request. Entries are watched through inotify and dropped as soon as the file on disk is changed,
+        // replaced or removed, so the cache never serves stale content. Resident content is also served in byte
+        // ranges. Without inotify (Windows) nothing is cached and all files are served from disk, as a whole.
+#ifdef __WINDOWS__
+        class FileCache {
+#else
+        class FileCache : public Core::IResource {
+#endif
+        public:
+            // A private copy of the file. Cached files are small and a copy, unlike a mapping, can not
+            // fault when the file is truncated on disk while it is being served.
+            class Content {
+            public:
+                Content() = delete;
+                Content(const Content&) = delete;
+                Content& operator=(const Content&) = delete;
+
+                Content(const string& fileName)
+                    : _data()
+                {
+                    Core::File file(fileName);
+
+                    if (file.Open(true) == true) {
+                        const uint32_t size = static_cast<uint32_t>(file.Size());
+                        uint32_t loaded = 0;
+                        uint32_t result;
+
+                        _data.resize(size);
+
+                        while ((loaded < size) && ((result = file.Read(&(_data[loaded]), size - loaded)) != 0)) {
+                            loaded += result;
+                        }
+
+                        // Changed underneath us, do not cache a partial snapshot.
+                        if (loaded != size) {
+                            _data.clear();
+                        }
+
+                        file.Close();
+                    }
+                }
+                ~Content()
+                {
+                }
+
+            public:
+                inline bool IsValid() const
+                {
+                    return (_data.empty() == false);
+                }
+                inline uint32_t Size() const
+                {
+                    return (static_cast<uint32_t>(_data.size()));
+                }
+                inline const uint8_t* Data() const
+                {
+                    return (_data.data());
+                }
+
+            private:
+                std::vector<uint8_t> _data;
+            };
+
+            // Body that streams straight from the (shared) cached content, the file is not reread. It
+            // covers the whole file, or a byte range of it.
+            class Body : public Web::IBody {
+            private:
+                Body(const Body&) = delete;
+                Body& operator=(const Body&) = delete;
+
+            public:
+                Body()
+                    : _content()
+                    , _begin(0)
+                    , _length(0)
+                    , _offset(0)
+                {
+                }
+                ~Body() override
+                {
+                }
+
+            public:
+                inline void Content(const Core::ProxyType<FileCache::Content>& content, const uint32_t begin, const uint32_t length)
+                {
+                    ASSERT((content.IsValid() == true) && ((begin + length) <= content->Size()));
+
+                    _content = content;
+                    _begin = begin;
+                    _length = length;
+                    _offset = 0;
+                }
+
+            private:
+                uint32_t Serialize() const override
+                {
+                    _offset = 0;
+                    return (_content.IsValid() == true ? _length : 0);
+                }
+                uint32_t Deserialize() override
+                {
+                    // This body is only used for outbound traffic.
+                    ASSERT(false);
+                    return (0);
+                }
+                void End() const override
+                {
+                    // Do not keep evicted content alive while this body is waiting in the pool.
+                    _content.Release();
+                }
+                uint16_t Serialize(uint8_t stream[], const uint16_t maxLength) const override
+                {
+                    uint16_t result = 0;
+
+                    if (_content.IsValid() == true) {
+                        result = static_cast<uint16_t>(std::min(static_cast<uint32_t>(maxLength), _length - _offset));
+
+                        ::memcpy(stream, &(_content->Data()[_begin + _offset]), result);
+                        _offset += result;
+                    }
+
+                    return (result);
+                }
+                uint16_t Deserialize(const uint8_t[], const uint16_t) override
+                {
+                    ASSERT(false);
+                    return (0);
+                }
+
+            private:
+                mutable Core::ProxyType<FileCache::Content> _content;
+                uint32_t _begin;
+                uint32_t _length;
+                mutable uint32_t _offset;
+            };
+
+        private:
+            class Entry {
+            public:
+                Entry() = delete;
+                Entry& operator=(const Entry&) = delete;
+
+                Entry(const string& path, const Core::ProxyType<FileCache::Content>& content, const Web::MIMETypes type, const int watch)
+                    : Path(path)
+                    , Content(content)
+                    , Type(type)
+                    , Watch(watch)
+                {
+                }
+                Entry(const Entry& copy)
+                    : Path(copy.Path)
+                    , Content(copy.Content)
+                    , Type(copy.Type)
+                    , Watch(copy.Watch)
+                {
+                }
+                ~Entry()
+                {
+                }
+
+            public:
+                const string Path;
+                const Core::ProxyType<FileCache::Content> Content;
+                const Web::MIMETypes Type;
+                const int Watch;
+            };
+
+            typedef std::list<Entry> Entries;
+            typedef std::unordered_map<string, Entries::iterator> Lookup;
+            typedef std::unordered_map<int, Entries::iterator> Watches;
+
+        public:
+            FileCache(const FileCache&) = delete;
+            FileCache& operator=(const FileCache&) = delete;
+
+            FileCache()
+                : _adminLock()
+                , _notifyFd(-1)
+                , _maxSize(0)
+                , _maxFileSize(0)
+                , _size(0)
+                , _entries()
+                , _lookup()
+                , _watches()
+                , _bodies(2)
+            {
+            }
+#ifdef __WINDOWS__
+            ~FileCache()
+#else
+            ~FileCache() override
+#endif
+            {
+                Close();
+            }
+
+        public:
+            inline bool IsEnabled() const
+            {
+                return (_notifyFd != -1);
+            }
+            void Configure(const uint32_t maxSize, const uint32_t maxFileSize)
+            {
+                Close();
+
+                _maxSize = maxSize;
+                _maxFileSize = std::min(maxSize, maxFileSize);
+
+#ifndef __WINDOWS__
+                if (_maxFileSize > 0) {
+                    _notifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+                    if (_notifyFd != -1) {
+                        Core::ResourceMonitor::Instance().Register(*this);
+                    }
+                }
+#endif
+            }
+            void Close()
+            {
+#ifndef __WINDOWS__
+                if (_notifyFd != -1) {
+                    Core::ResourceMonitor::Instance().Unregister(*this);
+
+                    _adminLock.Lock();
+
+                    _lookup.clear();
+                    _watches.clear();
+                    _entries.clear();
+                    _size = 0;
+
+                    ::close(_notifyFd);
+                    _notifyFd = -1;
+
+                    _adminLock.Unlock();
+                }
+#endif
+            }
+            // Returns the cached content for the requested path, an invalid proxy if it is not cached.
+            Core::ProxyType<FileCache::Content> Find(const string& path, Web::MIMETypes& contentType)
+            {
+                Core::ProxyType<FileCache::Content> result;
+
+                _adminLock.Lock();
+
+                Lookup::iterator index(_lookup.find(path));
+
+                if (index != _lookup.end()) {
+                    // Hit, make it the most recently used one.
+                    _entries.splice(_entries.begin(), _entries, index->second);
+                    contentType = index->second->Type;
+                    result = index->second->Content;
+                }
+
+                _adminLock.Unlock();
+
+                return (result);
+            }
+            // Loads the file into the cache, if it is a candidate for caching. An invalid proxy is
+            // returned if the file should be served from disk.
+            Core::ProxyType<FileCache::Content> Add(const string& path, const string& fileName, const Web::MIMETypes type)
+            {
+                _adminLock.Lock();
+
+                Core::ProxyType<FileCache::Content> result(Load(path, fileName, type));
+
+                _adminLock.Unlock();
+
+                return (result);
+            }
+            inline Core::ProxyType<Body> Element(const Core::ProxyType<FileCache::Content>& content, const uint32_t begin, const uint32_t length)
+            {
+                Core::ProxyType<Body> body(_bodies.Element());
+
+                body->Content(content, begin, length);
+
+                return (body);
+            }
+            // Resolves a single "bytes=" range (RFC 7233) against the size of the content. Anything else,
+            // including multiple ranges and ranges that can not be satisfied, yields false, so the whole
+            // content is served instead, which is what a server that ignores the range does.
+            static bool Range(const string& range, const uint32_t size, uint32_t& begin, uint32_t& length)
+            {
+                static const TCHAR Unit[] = _T("bytes=");
+                const uint32_t unitLength = static_cast<uint32_t>((sizeof(Unit) / sizeof(TCHAR)) - 1);
+                bool result = false;
+
+                if ((size > 0) && (range.compare(0, unitLength, Unit) == 0) && (range.find(',') == string::npos)) {
+                    const string::size_type dash = range.find('-', unitLength);
+
+                    if (dash != string::npos) {
+                        const string first(range.substr(unitLength, dash - unitLength));
+                        const string last(range.substr(dash + 1));
+
+                        if ((first.empty() == true) && (last.empty() == false)) {
+                            // Suffix: the last N bytes.
+                            const uint64_t suffix = Core::NumberType<uint64_t>(Core::TextFragment(last)).Value();
+
+                            if (suffix > 0) {
+                                length = static_cast<uint32_t>(std::min(suffix, static_cast<uint64_t>(size)));
+                                begin = size - length;
+                                result = true;
+                            }
+                        } else if (first.empty() == false) {
+                            const uint64_t start = Core::NumberType<uint64_t>(Core::TextFragment(first)).Value();
+                            const uint64_t end = (last.empty() == true ? (size - 1) : std::min(Core::NumberType<uint64_t>(Core::TextFragment(last)).Value(), static_cast<uint64_t>(size - 1)));
+
+                            if ((start < size) && (start <= end)) {
+                                begin = static_cast<uint32_t>(start);
+                                length = static_cast<uint32_t>(end - start + 1);
+                                result = true;
+                            }
+                        }
+                    }
+                }
+
+                return (result);
+            }
+
+        private:
+            Core::ProxyType<FileCache::Content> Load(const string& path, const string& fileName, const Web::MIMETypes type)
+            {
+                Core::ProxyType<FileCache::Content> result;
+#ifndef __WINDOWS__
+                Core::File file(fileName);
+
+                if ((file.Exists() == true) && (file.IsDirectory() == false) && (file.Size() > 0) && (file.Size() <= _maxFileSize)) {
+
+                    // Start watching before reading, so a change in between is not missed.
+                    int watch = inotify_add_watch(_notifyFd, fileName.c_str(), IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF);
+
+                    // The same inode might be cached under another path (e.g. index.html), do not share watches.
+                    if ((watch >= 0) && (_watches.find(watch) == _watches.end())) {
+                        Core::ProxyType<FileCache::Content> content(Core::ProxyType<FileCache::Content>::Create(fileName));
+
+                        if (content->IsValid() == false) {
+                            inotify_rm_watch(_notifyFd, watch);
+                        } else {
+                            _entries.emplace_front(path, content, type, watch);
+                            _lookup.emplace(path, _entries.begin());
+                            _watches.emplace(watch, _entries.begin());
+                            _size += content->Size();
+
+                            // Make room, least recently used ones go first.
+                            while (_size > _maxSize) {
+                                Remove(std::prev(_entries.end()), true);
+                            }
+
+                            result = content;
+                        }
+                    }
+                }
+#endif
+
+                return (result);
+            }
+            void Remove(Entries::iterator entry, const bool stopWatching)
+            {
+#ifndef __WINDOWS__
+                if (stopWatching == true) {
+                    inotify_rm_watch(_notifyFd, entry->Watch);
+                }
+#endif
+
+                _size -= entry->Content->Size();
+                _watches.erase(entry->Watch);
+                _lookup.erase(entry->Path);
+                _entries.erase(entry);
+            }
+
+#ifndef __WINDOWS__
+            Core::IResource::handle Descriptor() const override
+            {
+                return (_notifyFd);
+            }
+            uint16_t Events() override
+            {
+                return (POLLIN);
+            }
+            void Handle(const uint16_t events) override
+            {
+                if ((events & POLLIN) != 0) {
+                    uint8_t eventBuffer[16 * (sizeof(struct inotify_event) + NAME_MAX + 1)];
+                    int length;
+
+                    do {
+                        length = ::read(_notifyFd, eventBuffer, sizeof(eventBuffer));
+
+                        int offset = 0;
+
+                        _adminLock.Lock();
+
+                        while (offset < length) {
+                            const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(&(eventBuffer[offset]));
+
+                            Watches::iterator index(_watches.find(event->wd));
+
+                            if (index != _watches.end()) {
+                                TRACE_L1("Evicting changed file from cache: %s", index->second->Path.c_str());
+
+                                // If the watch is already gone (file deleted), the kernel removed it for us.
+                                Remove(index->second, ((event->mask & IN_IGNORED) == 0));
+                            }
+
+                            offset += static_cast<int>(sizeof(struct inotify_event) + event->len);
+                        }
+
+                        _adminLock.Unlock();
+
+                    } while (length > 0);
+                }
+            }
+#endif
+
+        private:
+            Core::CriticalSection _adminLock;
+            int _notifyFd;
+            uint32_t _maxSize;
+            uint32_t _maxFileSize;
+            uint32_t _size;
+            Entries _entries;
+            Lookup _lookup;
+            Watches _watches;
+            Core::ProxyPoolType<Body> _bodies;
+        };
+
         // IMPORTANT NOTE:
-        // There is no need to lock/unlock usage on this server as all action->response senarious take place on
-        // the communication thread from the SoketPortMonitor. There is only 1 such thread per process.
-        // Given this, make sure that all actions done by the ProxyMap are deterministic and short <100ms as it
-        // upholds all other network traffic.
+        // Requests are relayed and responses handled on the communication thread from the SocketPortMonitor,
+        // while the timer thread reaps idle connections and collects the statistics. The connections and
+        // statistics of a Backend are therefore guarded by its lock. Make sure that all actions done by the
+        // ProxyMap are deterministic and short <100ms as it upholds all other network traffic.
         class ProxyMap {
         private:
+            class Backend;
+
             class OutgoingChannel : public Web::WebLinkType<Core::SocketStream, Web::Response, Web::Request, ResponseFactory> {
             private:
                 struct OutstandingMessage {
                     Core::ProxyType<Web::Request> Request;
                     uint32_t Id;
+                    uint64_t Queued;
                 };
 
             public:
@@ -216,12 +716,13 @@ namespace Plugin {
                 OutgoingChannel(const OutgoingChannel&) = delete;
                 OutgoingChannel& operator=(const OutgoingChannel&) = delete;
 
-                OutgoingChannel(const string& path, const string& replacement, ProxyMap& proxyMap, const Core::NodeId& remoteId)
-                    : Web::WebLinkType<Core::SocketStream, Web::Response, Web::Request, ResponseFactory>(2, false, remoteId.AnyInterface(), remoteId, 1024, 1024)
-                    , _path(path)
-                    , _replacement(replacement)
+                OutgoingChannel(Backend& backend, const Core::NodeId& remoteId, const uint8_t pipeline)
+                    : Web::WebLinkType<Core::SocketStream, Web::Response, Web::Request, ResponseFactory>(std::max(pipeline, static_cast<uint8_t>(2)), false, remoteId.AnyInterface(), remoteId, 1024, 1024)
                     , _outstandingMessages()
-                    , _proxyMap(proxyMap)
+                    , _backend(backend)
+                    , _pipeline(pipeline)
+                    , _submitted(0)
+                    , _connecting(false)
                 {
                 }
                 
@@ -231,24 +732,27 @@ namespace Plugin {
 
                 void ProxyRequest(Core::ProxyType<Web::Request>& request, uint32_t id)
                 {
-
-                    OutstandingMessage message = { request, id };
+                    OutstandingMessage message = { request, id, Core::Time::Now().Ticks() };
 
                     _outstandingMessages.push_back(message);
 
-                    if (_outstandingMessages.size() == 1) {
-                        if (IsOpen() == false) {
-                            Open(0);
-                        } else {
-                            Submit(request);
-                        }
+                    if (IsOpen() == true) {
+                        Flush();
+                    } else if (_connecting == false) {
+                        _connecting = true;
+                        Open(0);
                     }
                 }
 
             public:
-                inline const string& Path() const
+                // Requests that are queued or in flight on this connection.
+                inline uint32_t Pending() const
                 {
-                    return (_path);
+                    return (static_cast<uint32_t>(_outstandingMessages.size()));
+                }
+                inline bool IsIdle()
+                {
+                    return ((_outstandingMessages.empty() == true) && (HasActivity() == false));
                 }
                 virtual void LinkBody(Core::ProxyType<Web::Response>& response)
                 {
@@ -268,23 +772,182 @@ namespace Plugin {
                     index->Request.Release();
                 }
                 // Whenever there is a state change on the link, it is reported here.
-                virtual void StateChange()
+                virtual void StateChange();
+                virtual void Received(Core::ProxyType<Web::Response>& response);
+
+            private:
+                // Pipeline requests on the keep-alive connection, up to the configured depth.
+                // Responses are returned in order, so the front of the list is always the next to complete.
+                void Flush()
                 {
-                    if (IsOpen() == true) {
+                    std::list<OutstandingMessage>::iterator index(_outstandingMessages.begin());
+
+                    std::advance(index, _submitted);
+
+                    while ((index != _outstandingMessages.end()) && (_submitted < _pipeline)) {
+                        ASSERT(index->Request.IsValid() == true);
+
+                        _submitted++;
+                        Submit(index->Request);
+                        index++;
+                    }
+                }
+                void Fail(const uint32_t count);
+
+            private:
+                std::list<OutstandingMessage> _outstandingMessages;
+                Backend& _backend;
+                const uint8_t _pipeline;
+                uint8_t _submitted;
+                bool _connecting;
+            };
+
+            // All connections towards a single proxied server. Requests are dispatched to the connection
+            // with the least outstanding requests, so a slow request does not block the ones behind it.
+            class Backend {
+            public:
+                Backend() = delete;
+                Backend(const Backend&) = delete;
+                Backend& operator=(const Backend&) = delete;
+
+                Backend(ProxyMap& proxyMap, const string& path, const string& replacement, const Core::NodeId& remoteId, const uint8_t connections, const uint8_t pipeline)
+                    : _proxyMap(proxyMap)
+                    , _path(path)
+                    , _replacement(replacement)
+                    , _remoteId(remoteId)
+                    , _maxConnections(std::max(connections, static_cast<uint8_t>(1)))
+                    , _pipeline(std::max(pipeline, static_cast<uint8_t>(1)))
+                    , _adminLock()
+                    , _channels()
+                    , _requests(0)
+                    , _totalLatency(0)
+                    , _maxLatency(0)
+                    , _maxQueueDepth(0)
+                {
+                }
+                ~Backend()
+                {
+                    for (OutgoingChannel* channel : _channels) {
+                        delete channel;
+                    }
+                    _channels.clear();
+                }
+
+            public:
+                inline const string& Path() const
+                {
+                    return (_path);
+                }
+                // The channels are served by the socket thread and reaped by the timer thread.
+                inline void Lock() const
+                {
+                    _adminLock.Lock();
+                }
+                inline void Unlock() const
+                {
+                    _adminLock.Unlock();
+                }
+                void Relay(Core::ProxyType<Web::Request>& request, const uint32_t id)
+                {
+                    OutgoingChannel* selected = nullptr;
+                    uint32_t queueDepth = 0;
 
-                        if (!_outstandingMessages.empty()) {
-                            Submit(_outstandingMessages.front().Request);
+                    _adminLock.Lock();
+
+                    for (OutgoingChannel* channel : _channels) {
+                        queueDepth += channel->Pending();
+
+                        if ((selected == nullptr) || (channel->Pending() < selected->Pending())) {
+                            selected = channel;
                         }
                     }
+
+                    // Only grow the pool if all connections have a full pipeline.
+                    if (((selected == nullptr) || (selected->Pending() >= _pipeline)) && (_channels.size() < _maxConnections)) {
+                        selected = new OutgoingChannel(*this, _remoteId, _pipeline);
+                        _channels.push_back(selected);
+                    }
+
+                    _maxQueueDepth = std::max(_maxQueueDepth, queueDepth + 1);
+
+                    selected->ProxyRequest(request, id);
+
+                    _adminLock.Unlock();
+                }
+                void Submit(const uint32_t id, Core::ProxyType<Web::Response>& response, const uint64_t queued)
+                {
+                    uint64_t latency = Core::Time::Now().Ticks() - queued;
+
+                    _adminLock.Lock();
+
+                    _requests++;
+                    _totalLatency += latency;
+                    _maxLatency = std::max(_maxLatency, latency);
+
+                    _adminLock.Unlock();
+
+                    _proxyMap.Submit(id, response);
+                }
+                // Drop the connections that have not been used since the last check from the pool, new
+                // ones are created on demand.
+                void Reap()
+                {
+                    std::list<OutgoingChannel*> idle;
+
+                    _adminLock.Lock();
+
+                    std::vector<OutgoingChannel*>::iterator index(_channels.begin());
+
+                    while (index != _channels.end()) {
+                        if ((*index)->IsIdle() == true) {
+                            // Out of the pool first, so Relay can not pick it while it is being closed.
+                            idle.push_back(*index);
+                            index = _channels.erase(index);
+                        } else {
+                            (*index)->ResetActivity();
+                            index++;
+                        }
+                    }
+
+                    _adminLock.Unlock();
+
+                    // Closing waits for the communication thread, which might need our lock to report on
+                    // another channel, so the reaped channels go without holding it.
+                    for (OutgoingChannel* channel : idle) {
+                        delete channel;
+                    }
+                }
+                void Statistics(uint32_t& requests, uint32_t& averageLatency, uint32_t& maxLatency, uint32_t& maxQueueDepth)
+                {
+                    _adminLock.Lock();
+
+                    requests = _requests;
+                    averageLatency = (_requests == 0 ? 0 : static_cast<uint32_t>(_totalLatency / _requests));
+                    maxLatency = static_cast<uint32_t>(_maxLatency);
+                    maxQueueDepth = _maxQueueDepth;
+
+                    _requests = 0;
+                    _totalLatency = 0;
+                    _maxLatency = 0;
+                    _maxQueueDepth = 0;
+
+                    _adminLock.Unlock();
                 }
-                virtual void Received(Core::ProxyType<Web::Response>& response);
 
             private:
+                ProxyMap& _proxyMap;
                 const string _path;
                 const string _replacement;
-
-                std::list<OutstandingMessage> _outstandingMessages;
-                ProxyMap& _proxyMap;
+                const Core::NodeId _remoteId;
+                const uint8_t _maxConnections;
+                const uint8_t _pipeline;
+                mutable Core::CriticalSection _adminLock;
+                std::vector<OutgoingChannel*> _channels;
+
+                uint32_t _requests;
+                uint64_t _totalLatency;
+                uint64_t _maxLatency;
+                uint32_t _maxQueueDepth;
             };
 
         private:
@@ -321,7 +984,7 @@ namespace Plugin {
 
                     if (address.IsValid() == true) {
 
-                        _proxies.push_back(new OutgoingChannel(path, subst, *this, address));
+                        _proxies.push_back(new Backend(*this, path, subst, address, index.Current().Connections.Value(), index.Current().Pipeline.Value()));
                     }
                 }
             }
@@ -329,7 +992,7 @@ namespace Plugin {
             void Destroy()
             {
 
-                std::list<OutgoingChannel*>::iterator index(_proxies.begin());
+                std::list<Backend*>::iterator index(_proxies.begin());
 
                 while (index != _proxies.end()) {
 
@@ -345,7 +1008,7 @@ namespace Plugin {
 
                 bool found = false;
                 const string& originalPath = request->Path;
-                std::list<OutgoingChannel*>::iterator index(_proxies.begin());
+                std::list<Backend*>::iterator index(_proxies.begin());
                 string proxyPath;
 
                 while ((found == false) && (index != _proxies.end())) {
@@ -367,7 +1030,7 @@ namespace Plugin {
 
                     request->Path = (proxyPath + request->Path.substr(proxyPath.length()));
 
-                    (*index)->ProxyRequest(request, channelId);
+                    (*index)->Relay(request, channelId);
                 }
 
                 return (found);
@@ -379,12 +1042,12 @@ namespace Plugin {
 
                 if (node.IsValid() == true) {
 
-                    _proxies.push_back(new OutgoingChannel(path, subst, *this, node));
+                    _proxies.push_back(new Backend(*this, path, subst, node, 1, 1));
                 }
             }
             inline void RemoveProxy(const string& path)
             {
-                std::list<OutgoingChannel*>::iterator index(_proxies.begin());
+                std::list<Backend*>::iterator index(_proxies.begin());
 
                 while ((index != _proxies.end()) && ((*index)->Path() != path)) {
 
@@ -401,10 +1064,24 @@ namespace Plugin {
             {
                 _server.Submit(channelId, response);
             }
+            void Reap()
+            {
+                for (Backend* backend : _proxies) {
+                    uint32_t requests, averageLatency, maxLatency, maxQueueDepth;
+
+                    backend->Statistics(requests, averageLatency, maxLatency, maxQueueDepth);
+
+                    if (requests > 0) {
+                        TRACE(ProxyStatistics, (backend->Path(), requests, averageLatency, maxLatency, maxQueueDepth));
+                    }
+
+                    backend->Reap();
+                }
+            }
 
         private:
             ChannelMap& _server;
-            std::list<OutgoingChannel*> _proxies;
+            std::list<Backend*> _proxies;
         };
 
         class IncomingChannel : public Web::WebLinkType<Core::SocketStream, Web::Request, Web::Response, RequestFactory> {
@@ -515,6 +1192,7 @@ namespace Plugin {
                 , _connectionCheckTimer(0)
                 , _cleanupTimer(Core::Thread::DefaultStackSize(), _T("ConnectionChecker"))
                 , _proxyMap(*this)
+                , _fileCache()
             {
             }
 #ifdef __WINDOWS__
@@ -554,6 +1232,8 @@ namespace Plugin {
 
                 _proxyMap.Create(index);
 
+                _fileCache.Configure(configuration.FileCache.Size.Value() * 1024, configuration.FileCache.FileSize.Value() * 1024);
+
                 if (configuration.Interface.Value().empty() == false) {
                     Core::NodeId selectedNode = Plugin::Config::IPV4UnicastNode(configuration.Interface.Value());
 
@@ -618,6 +1298,10 @@ namespace Plugin {
             {
                 return (_accessor);
             }
+            inline FileCache& Cache()
+            {
+                return (_fileCache);
+            }
             void Close(IncomingChannel& data)
             {
             }
@@ -640,6 +1324,9 @@ namespace Plugin {
                 // First clear all shit from last time..
                 Cleanup();
 
+                // Close the proxy connections that were not used and report on the ones that were.
+                _proxyMap.Reap();
+
                 // Now suspend those that have no activity.
                 BaseClass::Iterator index(BaseClass::Clients());
 
@@ -663,6 +1350,7 @@ namespace Plugin {
             uint32_t _connectionCheckTimer;
             Core::TimerType<TimeHandler> _cleanupTimer;
             ProxyMap _proxyMap;
+            FileCache _fileCache;
         };
 
     private:
@@ -765,25 +1453,52 @@ namespace Plugin {
         if (_parent.Relay(request, Id()) == false) {
 
             Core::ProxyType<Web::Response> response(PluginHost::IFactories::Instance().Response());
-            Core::ProxyType<Web::FileBody> fileBody(PluginHost::IFactories::Instance().FileBody());
-
-            // If so, don't deal with it ourselves.
+            FileCache& cache(_parent.Cache());
+            Core::ProxyType<FileCache::Content> content;
             Web::MIMETypes result;
-            string fileToService = _parent.PrefixPath();
 
-            if (Web::MIMETypeForFile(request->Path, fileToService, result) == false) {
+            if (cache.IsEnabled() == true) {
+                // Known paths do not need the MIME lookup, the cache remembers it.
+                content = cache.Find(request->Path, result);
+            }
 
-                string fullPath = fileToService + _T("index.html");
+            if (content.IsValid() == false) {
+                // If so, don't deal with it ourselves.
+                string fileToService = _parent.PrefixPath();
 
-                // No filename gives, be default, we go for the index.html page..
-                *fileBody = fileToService + _T("index.html");
-                response->ContentType = Web::MIME_HTML;
-                response->Body<Web::FileBody>(fileBody);
-            } else {
-                *fileBody = fileToService;
-                response->ContentType = result;
-                response->Body<Web::FileBody>(fileBody);
+                if (Web::MIMETypeForFile(request->Path, fileToService, result) == false) {
+                    // No filename gives, be default, we go for the index.html page..
+                    fileToService += _T("index.html");
+                    result = Web::MIME_HTML;
+                }
+
+                if (cache.IsEnabled() == true) {
+                    content = cache.Add(request->Path, fileToService, result);
+                }
+
+                if (content.IsValid() == false) {
+                    Core::ProxyType<Web::FileBody> fileBody(PluginHost::IFactories::Instance().FileBody());
+
+                    *fileBody = fileToService;
+                    response->Body<Web::FileBody>(fileBody);
+                }
             }
+
+            if (content.IsValid() == true) {
+                uint32_t begin = 0;
+                uint32_t length = content->Size();
+
+                if ((request->Range.IsSet() == true) && (FileCache::Range(request->Range.Value(), content->Size(), begin, length) == true)) {
+                    response->ErrorCode = Web::STATUS_PARTIAL_CONTENT;
+                    response->ContentRange = _T("bytes ") + Core::NumberType<uint32_t>(begin).Text() + '-' + Core::NumberType<uint32_t>(begin + length - 1).Text() + '/' + Core::NumberType<uint32_t>(content->Size()).Text();
+                }
+
+                // Resident content can be served in parts, let the client know.
+                response->AcceptRange = _T("bytes");
+                response->Body<FileCache::Body>(cache.Element(content, begin, length));
+            }
+
+            response->ContentType = result;
             Submit(response);
         }
     }
@@ -792,20 +1507,63 @@ namespace Plugin {
     {
         // Is response to our front of the list
         ASSERT(_outstandingMessages.empty() == false);
+        ASSERT(_submitted > 0);
         ASSERT(_outstandingMessages.front().Request.IsValid() == false);
 
+        _backend.Lock();
+
         if (_outstandingMessages.empty() == false) {
-            _proxyMap.Submit(_outstandingMessages.front().Id, response);
+            _backend.Submit(_outstandingMessages.front().Id, response, _outstandingMessages.front().Queued);
             _outstandingMessages.pop_front();
+            _submitted--;
+
+            // See if there is a next one to send.
+            Flush();
+        }
+
+        _backend.Unlock();
+    }
+
+    /* virtual */ void WebServerImplementation::ProxyMap::OutgoingChannel::StateChange()
+    {
+        _backend.Lock();
+
+        if (IsOpen() == true) {
+            _connecting = false;
 
-            // See if ther is a next one to send.
-            if (_outstandingMessages.size() > 0) {
+            Flush();
+        } else if (_connecting == true) {
+            // Could not reach the server, do not leave the clients waiting.
+            _connecting = false;
 
-                ASSERT(_outstandingMessages.front().Request.IsValid() == true);
+            Fail(Pending());
+        } else {
+            // The server closed the connection, whatever was in flight is lost. Requests that
+            // were not yet submitted are sent over a new connection.
+            Fail(_submitted);
 
-                Submit(_outstandingMessages.front().Request);
+            if (_outstandingMessages.empty() == false) {
+                _connecting = true;
+                Open(0);
             }
         }
+
+        _backend.Unlock();
+    }
+
+    void WebServerImplementation::ProxyMap::OutgoingChannel::Fail(const uint32_t count)
+    {
+        for (uint32_t index = 0; ((index < count) && (_outstandingMessages.empty() == false)); index++) {
+            Core::ProxyType<Web::Response> response(PluginHost::IFactories::Instance().Response());
+
+            response->ErrorCode = Web::STATUS_BAD_GATEWAY;
+            response->Message = _T("Proxied server not reachable");
+
+            _backend.Submit(_outstandingMessages.front().Id, response, _outstandingMessages.front().Queued);
+            _outstandingMessages.pop_front();
+        }
+
+        _submitted = 0;
     }
 
 } /* namespace Plugin */
@@ -178,8 +178,17 @@ namespace WPASupplicant {
     {
         uint16_t result = 0;
         _adminLock.Lock();
-        if ((_requests.size() > 0) && (_requests.front()->Message().empty() == false)) {
-            string& data = _requests.front()->Message();
+
+        // Skip the requests that are on the wire, awaiting their response, as long as the pipeline allows.
+        std::list<Request*>::iterator index(_requests.begin());
+        uint8_t pending = 0;
+        while ((index != _requests.end()) && ((*index)->IsSent() == true) && (pending < PipelineDepth)) {
+            index++;
+            pending++;
+        }
+
+        if ((index != _requests.end()) && (pending < PipelineDepth) && ((*index)->IsSent() == false)) {
+            string& data = (*index)->Message();
             TRACE(Communication, (_T("Send: [%s]"), data.c_str()));
             result = (data.length() > maxSendSize ? maxSendSize : data.length());
             memcpy(dataFrame, data.c_str(), result);
@@ -319,9 +328,9 @@ namespace WPASupplicant {
             }
         } else {
             _adminLock.Lock();
-            size_t requestsNumber = _requests.size();
+            bool pending = ((_requests.size() > 0) && (_requests.front()->IsSent() == true));
             _adminLock.Unlock();
-            if (requestsNumber > 0) {
+            if (pending == true) {
                 _adminLock.Lock();
                 Request* current = _requests.front();
                 _requests.pop_front();
@@ -342,9 +351,15 @@ namespace WPASupplicant {
     // Completion of requests are running in a locked context, so oke to update maps/lists
     void Controller::Add(const uint64_t& bssid, const NetworkInfo& entry)
     {
-        TRACE(Communication, (_T("Added SSID: %llX - %s"), bssid, entry.SSID().c_str()));
-        _networks[bssid] = entry;
-        Reevaluate();
+        NetworkInfoContainer::iterator index(_networks.find(bssid));
+
+        if (index == _networks.end()) {
+            TRACE(Communication, (_T("Added SSID: %llX - %s"), bssid, entry.SSID().c_str()));
+            _networks[bssid] = entry;
+        } else {
+            // Known BSS, the supplicant keeps its id, so only refresh what the scan reports and keep the details.
+            index->second.Set(entry.SSID(), entry.Frequency(), entry.Signal(), entry.Pair(), entry.Key());
+        }
     }
     void Controller::Add(const string& ssid, const bool current, const uint64_t& bssid)
     {
@@ -365,7 +380,7 @@ namespace WPASupplicant {
 
         Reevaluate();
     }
-    void Controller::Update(const uint64_t& bssid, const string& ssid, const uint32_t id, uint32_t frequency, const int32_t signal, const uint16_t pairs, const uint32_t keys, const uint32_t throughput)
+    void Controller::Update(const uint64_t& bssid, const string& ssid, const uint32_t id, uint32_t frequency, const int32_t signal, const uint16_t pairs, const uint32_t keys, const uint32_t throughput, const bool evaluate)
     {
 
         bool scanInProgress = false;
@@ -383,7 +398,9 @@ namespace WPASupplicant {
             _networks[bssid] = NetworkInfo(id, ssid, frequency, signal, pairs, keys, throughput);
         }
 
-        if (scanInProgress == true) {
+        if (evaluate == false) {
+            // Part of a bulk update, the caller reevaluates once all entries are in.
+        } else if (scanInProgress == true) {
             Reevaluate();
         } else if (_callback != nullptr) {
             _callback->Dispatch(CTRL_EVENT_NETWORK_CHANGED);
@@ -410,6 +427,19 @@ namespace WPASupplicant {
 
         Reevaluate();
     }
+    void Controller::Scanned()
+    {
+        // New scan results, the bulk request can cover the full BSS table again.
+        _rangeFirst = 0;
+        Reevaluate();
+    }
+    void Controller::Ranged(const uint32_t count, const uint32_t last)
+    {
+        // If the reply got truncated, continue after the last reported BSS. If nothing came
+        // back, whatever is still missing is not in the table, so ask for those one by one.
+        _rangeFirst = (count > 0 ? last + 1 : static_cast<uint32_t>(~0));
+        Reevaluate();
+    }
     void Controller::Reevaluate()
     {
 
@@ -419,7 +449,18 @@ namespace WPASupplicant {
             index++;
         }
         if (index != _networks.end()) {
-            if (_detailRequest.Set(index->first) == true) {
+            NetworkInfoContainer::const_iterator next(std::next(index));
+
+            while ((next != _networks.end()) && (next->second.HasDetail() == true)) {
+                next++;
+            }
+
+            if ((next != _networks.end()) && (_rangeFirst != static_cast<uint32_t>(~0))) {
+                // More than one BSS lacks details, fetch them all in a single round trip.
+                if (_rangeRequest.Set(_rangeFirst) == true) {
+                    Submit(&_rangeRequest);
+                }
+            } else if ((_rangeRequest.InProgress() == false) && (_detailRequest.Set(index->first) == true)) {
                 // send out a request for detail.
                 Submit(&_detailRequest);
             }
@@ -123,6 +123,9 @@ namespace WPASupplicant {
 
     private:
         static constexpr uint32_t MaxConnectionTime = 3000;
+        // The supplicant handles the datagrams on its control socket in order, so responses arrive in
+        // the order the requests were sent. This allows to have a few requests on the wire at once.
+        static constexpr uint8_t PipelineDepth = 4;
 
         Controller() = delete;
         Controller(const Controller&) = delete;
@@ -347,6 +350,9 @@ namespace WPASupplicant {
             inline bool InProgress() const {
                 return (_settable == false);
             }
+            inline bool IsSent() const {
+                return (_request.empty() == true);
+            }
             string& Message()
             {
                 return (_request);
@@ -434,6 +440,9 @@ namespace WPASupplicant {
                         NetworkInfo newEntry;
                         _parent.Add(Transform(element, newEntry), newEntry);
                     }
+
+                    // All results are in, see in one go what details are still missing.
+                    _parent.Scanned();
                 }
                 if (_eventReporting != static_cast<uint32_t>(~0)) {
                     _parent.Notify(static_cast<events>(_eventReporting));
@@ -686,6 +695,112 @@ namespace WPASupplicant {
             Controller& _parent;
             uint64_t _bssid;
         };
+        class RangeRequest : public Request {
+        private:
+            RangeRequest() = delete;
+            RangeRequest(const RangeRequest&) = delete;
+            RangeRequest& operator=(const RangeRequest&) = delete;
+
+        public:
+            RangeRequest(Controller& parent)
+                : Request()
+                , _parent(parent)
+                , _first(0)
+            {
+            }
+            virtual ~RangeRequest()
+            {
+            }
+
+        public:
+            // Request the details of all BSS entries, starting at the given BSS id, in one go. The
+            // mask limits the report to: id, bssid, freq, level, flags, ssid, delimiter and est_throughput.
+            bool Set(const uint32_t first)
+            {
+                string range(first == 0 ? string(_T("ALL")) : Core::NumberType<uint32_t>(first).Text() + '-');
+
+                if (Request::Set(string(_TXT("BSS RANGE=")) + range + _T(" MASK=0x121887")) == true) {
+                    _first = first;
+                    return (true);
+                }
+                return (false);
+            }
+            virtual void Completed(const string& response, const bool abort) override
+            {
+                if (abort == false) {
+                    Core::TextFragment data(response);
+
+                    uint32_t count = 0;
+                    uint32_t last = _first;
+                    uint64_t bssid = 0;
+                    string ssid;
+                    uint32_t id = static_cast<uint32_t>(~1);
+                    uint32_t freq = 0;
+                    int32_t signal = 0;
+                    uint16_t pair = 0;
+                    uint32_t keys = 0;
+                    uint32_t throughput = 0;
+                    uint32_t marker = 0;
+                    uint32_t markerEnd = data.ForwardFind('\n', marker);
+
+                    while (marker != markerEnd) {
+
+                        Core::TextFragment line(data, marker, (markerEnd - marker));
+
+                        if (line.Text() == _T("====")) {
+                            // The supplicant only reports complete entries, if the reply does not fit
+                            // the remainder is left out, so every delimiter closes a full entry.
+                            if (bssid != 0) {
+                                _parent.Update(bssid, ssid, id, freq, signal, pair, keys, throughput, false);
+                                last = std::max(last, id);
+                                count++;
+                            }
+                            bssid = 0;
+                            ssid.clear();
+                            id = static_cast<uint32_t>(~1);
+                            freq = 0;
+                            signal = 0;
+                            pair = 0;
+                            keys = 0;
+                            throughput = 0;
+                        } else {
+                            Core::TextSegmentIterator index(line, false, '=');
+
+                            if (index.Next() == true) {
+
+                                string name(index.Current().Text());
+
+                                if (index.Next() == true) {
+                                    if (name == _T("bssid")) {
+                                        bssid = BSSID(index.Current().Text());
+                                    } else if (name == _T("id")) {
+                                        id = Core::NumberType<uint32_t>(index.Current());
+                                    } else if (name == _T("est_throughput")) {
+                                        throughput = Core::NumberType<uint32_t>(index.Current());
+                                    } else if (name == _T("ssid")) {
+                                        ssid = index.Current().Text();
+                                    } else if (name == _T("freq")) {
+                                        freq = Core::NumberType<uint32_t>(index.Current());
+                                    } else if (name == _T("level")) {
+                                        signal = Core::NumberType<int32_t>(index.Current());
+                                    } else if (name == _T("flags")) {
+                                        pair = KeyPair(index.Current(), keys);
+                                    }
+                                }
+                            }
+                        }
+                        marker = (markerEnd < data.Length() ? markerEnd + 1 : markerEnd);
+                        markerEnd = data.ForwardFind('\n', marker);
+                    }
+
+                    _parent.Ranged(count, last);
+                }
+            }
+
+        private:
+            Controller& _parent;
+            uint32_t _first;
+        };
         class NetworkRequest : public Request {
         private:
             NetworkRequest() = delete;
@@ -988,6 +1103,26 @@ namespace WPASupplicant {
             string _response;
             uint32_t _result;
         };
+        class DiscardRequest : public Request {
+        private:
+            DiscardRequest(const DiscardRequest&) = delete;
+            DiscardRequest& operator=(const DiscardRequest&) = delete;
+
+        public:
+            // Takes the place of a revoked request that was already sent, it swallows its late response.
+            DiscardRequest()
+                : Request()
+            {
+            }
+            virtual ~DiscardRequest()
+            {
+            }
+
+        public:
+            virtual void Completed(const string&, const bool) override
+            {
+            }
+        };
         typedef std::map<const uint64_t, NetworkInfo> NetworkInfoContainer;
         typedef std::map<const string, ConfigInfo> EnabledContainer;
         typedef Core::StreamType<Core::SocketDatagram> BaseClass;
@@ -1003,6 +1138,9 @@ namespace WPASupplicant {
             , _callback(nullptr)
             , _scanRequest(*this)
             , _detailRequest(*this)
+            , _rangeRequest(*this)
+            , _discardRequest()
+            , _rangeFirst(0)
             , _networkRequest(*this)
             , _statusRequest(*this)
             , _connectRequest(*this)
@@ -1108,7 +1246,8 @@ namespace WPASupplicant {
         {
             return (_error);
         }
-        inline uint32_t Scan()
+        // A frequency limits the scan to that single channel, which completes in a fraction of a full scan.
+        inline uint32_t Scan(const uint32_t frequency = 0)
         {
 
             uint32_t result = Core::ERROR_INPROGRESS;
@@ -1119,7 +1258,7 @@ namespace WPASupplicant {
             if (activated == true) {
                 result = Core::ERROR_NONE;
 
-                CustomRequest exchange(string(_TXT("SCAN")));
+                CustomRequest exchange(frequency == 0 ? string(_TXT("SCAN")) : string(_TXT("SCAN freq=")) + Core::NumberType<uint32_t>(frequency).Text());
 
                 Submit(&exchange);
 
@@ -1871,9 +2010,11 @@ namespace WPASupplicant {
         void Add(const uint64_t& bssid, const NetworkInfo& entry);
         void Add(const string& ssid, const bool current, const uint64_t& bssid);
         void Update(const string& status);
-        void Update(const uint64_t& bssid, const string& ssid, const uint32_t id, uint32_t frequency, const int32_t signal, const uint16_t pairs, const uint32_t keys, const uint32_t throughput);
+        void Update(const uint64_t& bssid, const string& ssid, const uint32_t id, uint32_t frequency, const int32_t signal, const uint16_t pairs, const uint32_t keys, const uint32_t throughput, const bool evaluate = true);
         void Update(const uint64_t& bssid, const uint32_t id, const uint32_t throughput);
         void Update(const string& ssid, const uint32_t id, const bool succeeded);
+        void Scanned();
+        void Ranged(const uint32_t count, const uint32_t last);
         void Reevaluate();
         virtual uint16_t SendData(uint8_t* dataFrame, const uint16_t maxSendSize);
         virtual uint16_t ReceiveData(uint8_t* dataFrame, const uint16_t receivedSize);
@@ -1887,7 +2028,14 @@ namespace WPASupplicant {
             if (index != _requests.end()) {
                 bool retrigger(index == _requests.begin());
                 (*index)->Processing(false);
-                _requests.erase(index);
+                if ((*index)->IsSent() == true) {
+                    // The response is still on its way, keep the slot so the responses that follow
+                    // are still matched to the right request.
+                    *index = &_discardRequest;
+                    retrigger = false;
+                } else {
+                    _requests.erase(index);
+                }
                 _adminLock.Unlock();
 
                 if (retrigger == true) {
@@ -1926,7 +2074,7 @@ namespace WPASupplicant {
             data->Processing(true);
             _requests.push_back(data);
 
-            if (_requests.size() == 1) {
+            if (_requests.size() <= PipelineDepth) {
                 _adminLock.Unlock();
 
                 const_cast<Controller*>(this)->Trigger();
@@ -1963,6 +2111,9 @@ namespace WPASupplicant {
         Core::IDispatchType<const events>* _callback;
         ScanRequest _scanRequest;
         DetailRequest _detailRequest;
+        RangeRequest _rangeRequest;
+        mutable DiscardRequest _discardRequest;
+        uint32_t _rangeFirst;
         NetworkRequest _networkRequest;
         StatusRequest _statusRequest;
         ConnectRequest _connectRequest;
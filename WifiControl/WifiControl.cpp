@@ -123,6 +123,9 @@ namespace Plugin
                     else {
                         _autoConnectEnabled = true;
                         _retryInterval = config.RetryInterval.Value();
+                        if (service->PersistentPath().empty() == false) {
+                            _autoConnect.Load(service->PersistentPath() + "autoconnect.json");
+                        }
                         _autoConnect.Connect(config.Preferred.Value(), _retryInterval, ~0);
                     }
                 }
@@ -28,6 +28,8 @@
 #include "Controller.h"
 #endif
 #include <interfaces/json/JsonData_WifiControl.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 namespace WPEFramework {
 namespace Plugin {
@@ -132,6 +134,10 @@ namespace Plugin {
         class AutoConnect : public WPASupplicant::Controller::IConnectCallback
         {
         private:
+            // Give both the channel scan and the connect to a remembered BSS this long, before falling
+            // back to a full scan.
+            static constexpr uint32_t ReconnectTime = 5000;
+
             class AccessPoint 
             {
             public:
@@ -139,10 +145,11 @@ namespace Plugin {
                 AccessPoint(const AccessPoint&) = delete;
                 AccessPoint& operator= (const AccessPoint&) = delete;
 
-                AccessPoint(const int32_t strength, const uint64_t& bssid, const string& SSID) 
+                AccessPoint(const int32_t strength, const uint64_t& bssid, const string& SSID, const uint32_t frequency) 
                     : _strength(strength)
                     , _bssid(bssid)
-                    , _ssid(SSID) {
+                    , _ssid(SSID)
+                    , _frequency(frequency) {
                 }
                 ~AccessPoint() {
                 }
@@ -157,18 +164,87 @@ namespace Plugin {
                 int32_t Signal() const {
                     return (_strength);
                 }
+                uint32_t Frequency() const {
+                    return (_frequency);
+                }
 
             private:
                 int32_t _strength;
                 uint64_t _bssid;
                 string _ssid;
+                uint32_t _frequency;
+            };
+            class KnownList : public Core::JSON::Container {
+            public:
+                class Entry : public Core::JSON::Container {
+                public:
+                    Entry()
+                        : Core::JSON::Container()
+                        , SSID()
+                        , BSSID()
+                        , Frequency()
+                    {
+                        Add(_T("ssid"), &SSID);
+                        Add(_T("bssid"), &BSSID);
+                        Add(_T("frequency"), &Frequency);
+                    }
+                    Entry(const Entry& copy)
+                        : Core::JSON::Container()
+                        , SSID(copy.SSID)
+                        , BSSID(copy.BSSID)
+                        , Frequency(copy.Frequency)
+                    {
+                        Add(_T("ssid"), &SSID);
+                        Add(_T("bssid"), &BSSID);
+                        Add(_T("frequency"), &Frequency);
+                    }
+                    ~Entry() override
+                    {
+                    }
+
+                    Entry& operator=(const Entry& RHS)
+                    {
+                        SSID = RHS.SSID;
+                        BSSID = RHS.BSSID;
+                        Frequency = RHS.Frequency;
+
+                        return (*this);
+                    }
+
+                public:
+                    Core::JSON::String SSID;
+                    Core::JSON::DecUInt64 BSSID;
+                    Core::JSON::DecUInt32 Frequency;
+                };
+
+            public:
+                KnownList(const KnownList&) = delete;
+                KnownList& operator=(const KnownList&) = delete;
+
+                KnownList()
+                    : Core::JSON::Container()
+                    , AccessPoints()
+                {
+                    Add(_T("accesspoints"), &AccessPoints);
+                }
+                ~KnownList() override
+                {
+                }
+
+            public:
+                Core::JSON::ArrayType<Entry> AccessPoints;
             };
             using Job = Core::WorkerPool::JobType<AutoConnect&>;
             using SSIDList = std::list<AccessPoint>;
+            // Last BSSID and frequency we successfully connected to, per SSID.
+            using KnownMap = std::map<string, std::pair<uint64_t, uint32_t>>;
 
             enum class states : uint8_t
             {
                 IDLE,
+                REFRESHING,
+                REFRESHED,
+                RECONNECTING,
                 SCANNING,
                 SCANNED,
                 CONNECTING,
@@ -189,6 +265,11 @@ namespace Plugin {
                 , _interval(0)
                 , _attempts(0)
                 , _preferred()
+                , _known()
+                , _current()
+                , _storage()
+                , _started(0)
+                , _dispatching(false)
             {
             }
             ~AutoConnect() override
@@ -196,6 +277,34 @@ namespace Plugin {
             }
 
         public:
+            void Load(const string& storage)
+            {
+                _adminLock.Lock();
+
+                _storage = storage;
+                _known.clear();
+
+                Core::File file(_storage);
+
+                if (file.Open(true) == true) {
+                    KnownList list;
+                    Core::OptionalType<Core::JSON::Error> error;
+                    list.IElement::FromFile(file, error);
+                    if (error.IsSet() == true) {
+                        SYSLOG(Logging::ParsingError, (_T("Parsing failed with %s"), ErrorDisplayMessage(error.Value()).c_str()));
+                    }
+
+                    auto index(list.AccessPoints.Elements());
+
+                    while (index.Next() == true) {
+                        if ((index.Current().SSID.Value().empty() == false) && (index.Current().BSSID.Value() != 0)) {
+                            _known[index.Current().SSID.Value()] = std::make_pair(index.Current().BSSID.Value(), index.Current().Frequency.Value());
+                        }
+                    }
+                }
+
+                _adminLock.Unlock();
+            }
             uint32_t Connect(const string& SSID, const uint8_t scheduleInterval, const uint32_t attempts) 
             {
                 uint32_t result = Core::ERROR_INPROGRESS;
@@ -209,7 +318,8 @@ namespace Plugin {
                     _preferred = SSID;
                     _attempts = attempts;
                     _interval = (scheduleInterval * 1000);
-                    result = Scan();
+                    _started = Core::Time::Now().Ticks();
+                    result = Reconnect();
                 }
 
                 _adminLock.Unlock();
@@ -259,6 +369,12 @@ namespace Plugin {
 
                     _job.Submit();
                }
+               else if (_state == states::REFRESHING) {
+                    // The supplicant has a fresh entry for the remembered BSS, it can be connected to.
+                    MoveState(states::REFRESHED);
+
+                    _job.Submit();
+               }
 
                 _adminLock.Unlock();
             }
@@ -269,7 +385,8 @@ namespace Plugin {
 
                 if ((reason == WPASupplicant::Controller::WLAN_REASON_NOINFO_GIVEN)
                         && (_state == states::IDLE) && (_attempts > 0)) {
-                    Scan();
+                    _started = Core::Time::Now().Ticks();
+                    Reconnect();
                 }
                 _adminLock.Unlock();
             }
@@ -278,8 +395,40 @@ namespace Plugin {
             {
                 _adminLock.Lock();
 
+                _dispatching = true;
+
                 // Oke, the Job timed out, or we need a new CONNECTION request....
-                if (_state == states::SCANNING) {
+                if (_state == states::REFRESHED) {
+                    ASSERT(_ssidList.size() == 1);
+
+                    const uint32_t result = _controller->Connect(this, _ssidList.front().SSID(), _ssidList.front().BSSID());
+
+                    if (result == Core::ERROR_NONE) {
+                        MoveState(states::RECONNECTING);
+                        _job.Schedule(Core::Time::Now().Add(ReconnectTime));
+                    }
+                    else if (result == Core::ERROR_ALREADY_CONNECTED) {
+                        MoveState(states::IDLE);
+                        _ssidList.clear();
+                    }
+                    else {
+                        // Fall back to a full scan right away.
+                        MoveState(states::RECONNECTING);
+                        _job.Submit();
+                    }
+                }
+                else if ((_state == states::REFRESHING) || (_state == states::RECONNECTING)) {
+                    // The remembered BSS did not make it (in time), fall back to a full scan.
+                    TRACE(Trace::Information, (_T("Reconnect to the last known BSS failed, scanning")));
+
+                    _controller->Revoke(this);
+                    _ssidList.clear();
+                    MoveState(states::SCANNING);
+                    _controller->Scan();
+
+                    _job.Schedule(Core::Time::Now().Add(_interval));
+                }
+                else if (_state == states::SCANNING) {
                     // Seems that the Scan did not complete in time. Lets reschedule for later...
                     _state = states::RETRY;
                     _job.Schedule(Core::Time::Now().Add(_interval));
@@ -307,7 +456,7 @@ namespace Plugin {
                             while ((index != _ssidList.end()) && (index->Signal() > strength)) {
                                 index++;
                             }
-                            _ssidList.emplace(index, strength, net.BSSID(), net.SSID());
+                            _ssidList.emplace(index, strength, net.BSSID(), net.SSID(), net.Frequency());
                         }
                     }
 
@@ -351,6 +500,8 @@ namespace Plugin {
                     }
                 }
 
+                _dispatching = false;
+
                 _adminLock.Unlock();
             }
 
@@ -367,18 +518,129 @@ namespace Plugin {
             }
 
         private:
+            // Called from the job itself, there is nothing to revoke: the job is running, and revoking it
+            // would wait for itself to complete. Whatever it schedules next replaces a pending submit.
             void MoveState(const states newState) {
-                _state = states::IDLE;
+                if (_dispatching == false) {
+                    _state = states::IDLE;
 
-                _adminLock.Unlock();
+                    _adminLock.Unlock();
 
-                _job.Revoke();
+                    _job.Revoke();
 
-                _adminLock.Lock();
+                    _adminLock.Lock();
+                }
 
                 _state = newState;
             }
 
+            // Try the BSS we were last connected to first, preferably the one of the preferred SSID. A
+            // single channel scan refreshes the supplicant's view on it, so it can associate without
+            // waiting for a full scan. The connect is only issued once the results of that scan are in
+            // (see Scanned). A full scan remains the fallback.
+            uint32_t Reconnect()
+            {
+                uint32_t result = Core::ERROR_UNAVAILABLE;
+                KnownMap::const_iterator index(_known.find(_preferred));
+
+                if (index == _known.end()) {
+                    index = _known.find(_current);
+                }
+
+                if ((index != _known.end()) && (index->second.second != 0)) {
+                    const string ssid(index->first);
+                    const uint64_t bssid(index->second.first);
+                    const uint32_t frequency(index->second.second);
+
+                    MoveState(states::REFRESHING);
+
+                    _ssidList.clear();
+                    _ssidList.emplace_back(Core::NumberType<int32_t>::Max(), bssid, ssid, frequency);
+
+                    result = _controller->Scan(frequency);
+
+                    if (result == Core::ERROR_NONE) {
+                        _job.Schedule(Core::Time::Now().Add(ReconnectTime));
+                    }
+                    else {
+                        _ssidList.clear();
+                    }
+                }
+
+                return (result == Core::ERROR_NONE ? result : Scan());
+            }
+
+            void Remember(const AccessPoint& accessPoint)
+            {
+                std::pair<uint64_t, uint32_t>& entry(_known[accessPoint.SSID()]);
+
+                _current = accessPoint.SSID();
+
+                if ((entry.first != accessPoint.BSSID()) || (entry.second != accessPoint.Frequency())) {
+                    entry = std::make_pair(accessPoint.BSSID(), accessPoint.Frequency());
+
+                    if (_storage.empty() == false) {
+                        KnownList list;
+                        KnownMap::const_iterator index(_known.begin());
+
+                        while (index != _known.end()) {
+                            KnownList::Entry element;
+                            element.SSID = index->first;
+                            element.BSSID = index->second.first;
+                            element.Frequency = index->second.second;
+                            list.AccessPoints.Add(element);
+                            index++;
+                        }
+
+                        if (Store(list) == false) {
+                            TRACE(Trace::Information, (_T("Failed to write the known access points to %s"), _storage.c_str()));
+                        }
+                    }
+                }
+            }
+
+            // Written next to the table and renamed over it, so a power loss leaves either the old or
+            // the new table behind, never a partial one.
+            bool Store(const KnownList& list) const
+            {
+                const string temporary(_storage + _T(".tmp"));
+                bool result = false;
+
+                Core::File file(temporary);
+
+                if (file.Create() == true) {
+                    result = list.IElement::ToFile(file);
+                    file.Close();
+
+                    if (result == true) {
+                        int fd = ::open(temporary.c_str(), O_RDONLY | O_CLOEXEC);
+                        result = ((fd != -1) && (::fsync(fd) == 0));
+
+                        if (fd != -1) {
+                            ::close(fd);
+                        }
+                    }
+
+                    if ((result == true) && (::rename(temporary.c_str(), _storage.c_str()) == 0)) {
+                        string::size_type slash = _storage.find_last_of('/');
+                        const string directory(slash == string::npos ? string(_T(".")) : (slash == 0 ? string(_T("/")) : _storage.substr(0, slash)));
+
+                        int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+                        result = ((fd != -1) && (::fsync(fd) == 0));
+
+                        if (fd != -1) {
+                            ::close(fd);
+                        }
+                    }
+                    else {
+                        result = false;
+                        file.Destroy();
+                    }
+                }
+
+                return (result);
+            }
+
             void Completed(const uint32_t result) override {
 
                 _controller->Revoke(this);
@@ -387,10 +649,25 @@ namespace Plugin {
 
                 if ((result == Core::ERROR_NONE) || (result == Core::ERROR_ALREADY_CONNECTED)) {
 
+                    if (_ssidList.size() > 0) {
+                        const uint32_t elapsed(static_cast<uint32_t>((Core::Time::Now().Ticks() - _started) / Core::Time::TicksPerMillisecond));
+
+                        TRACE(Trace::Information, (_T("Connected to %s in %u ms (%s)"), _ssidList.front().SSID().c_str(), elapsed,
+                            (_state == states::RECONNECTING ? _T("last known BSS") : _T("scan"))));
+
+                        Remember(_ssidList.front());
+                    }
+
                     MoveState(states::IDLE);
 
                     _ssidList.clear();
                 }
+                else if (_state == states::RECONNECTING) {
+                    // Let the job fall back to a full scan.
+                    MoveState(states::RECONNECTING);
+
+                    _job.Submit();
+                }
                 else {
                     MoveState(states::CONNECTING);
 
@@ -409,6 +686,11 @@ namespace Plugin {
             uint32_t _interval;
             uint32_t _attempts;
             string _preferred;
+            KnownMap _known;
+            string _current;
+            string _storage;
+            uint64_t _started;
+            bool _dispatching;
         };
 
     public:
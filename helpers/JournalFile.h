@@ -0,0 +1,307 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2020 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __JOURNALFILE_H__
+#define __JOURNALFILE_H__
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifdef __WINDOWS__
+#include <io.h>
+#else
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace WPEFramework {
+namespace Plugin {
+
+    // Append-only file of records, the storage underneath the journals of the plugins. Every record
+    // is appended with a single write. The layout of a record is up to the user of the journal, who
+    // tells the replay where a record ends. A record that is cut short (e.g. power loss during the
+    // write) ends the replay, and is cut off the file, so records appended after it are not lost on
+    // the next replay.
+    class JournalFile {
+    private:
+        static constexpr uint8_t MaxParts = 4;
+
+    public:
+        struct IRecord {
+            virtual ~IRecord() {}
+            // Length of the record the data starts with, 0 if it does not start with a complete record.
+            virtual uint32_t Length(const uint8_t data[], const uint32_t available) const = 0;
+            virtual void Replay(const uint8_t data[], const uint32_t length) = 0;
+        };
+
+        struct Part {
+            const void* Data;
+            uint32_t Length;
+        };
+
+    public:
+        JournalFile(const JournalFile&) = delete;
+        JournalFile& operator=(const JournalFile&) = delete;
+
+        JournalFile()
+            : _fileName()
+            , _fd(-1)
+            , _size(0)
+            , _dirty(false)
+        {
+        }
+        ~JournalFile()
+        {
+            Close();
+        }
+
+    public:
+        inline bool IsOpen() const
+        {
+            return (_fd != -1);
+        }
+        // Number of bytes appended since the journal was (re)started.
+        inline uint32_t Size() const
+        {
+            return (_size);
+        }
+        bool Open(const string& fileName)
+        {
+            ASSERT(_fd == -1);
+
+            _fileName = fileName;
+#ifdef __WINDOWS__
+            _fd = ::_open(_fileName.c_str(), _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY | _O_NOINHERIT, _S_IREAD | _S_IWRITE);
+#else
+            _fd = ::open(_fileName.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, S_IRUSR | S_IWUSR);
+#endif
+
+            if (_fd != -1) {
+#ifdef __WINDOWS__
+                long length = ::_lseek(_fd, 0, SEEK_END);
+#else
+                off_t length = ::lseek(_fd, 0, SEEK_END);
+#endif
+                _size = (length > 0 ? static_cast<uint32_t>(length) : 0);
+            } else {
+                TRACE_L1("Could not open journal %s [%d]", _fileName.c_str(), errno);
+            }
+
+            return (_fd != -1);
+        }
+        void Close()
+        {
+            if (_fd != -1) {
+#ifdef __WINDOWS__
+                ::_commit(_fd);
+                ::_close(_fd);
+#else
+                ::fdatasync(_fd);
+                ::close(_fd);
+#endif
+                _fd = -1;
+            }
+            _size = 0;
+            _dirty = false;
+        }
+        // The parts of a record go out in one system call, so a record is never interleaved with another one.
+        bool Append(const Part parts[], const uint8_t count)
+        {
+            bool result = false;
+
+            ASSERT(count <= MaxParts);
+
+            if (_fd != -1) {
+                int expected = 0;
+
+#ifdef __WINDOWS__
+                string record;
+
+                for (uint8_t index = 0; index < count; index++) {
+                    record.append(static_cast<const char*>(parts[index].Data), parts[index].Length);
+                }
+                expected = static_cast<int>(record.length());
+
+                result = (::_write(_fd, record.data(), expected) == expected);
+#else
+                struct iovec vector[MaxParts];
+
+                for (uint8_t index = 0; index < count; index++) {
+                    vector[index].iov_base = const_cast<void*>(parts[index].Data);
+                    vector[index].iov_len = parts[index].Length;
+                    expected += static_cast<int>(parts[index].Length);
+                }
+
+                result = (::writev(_fd, vector, count) == expected);
+#endif
+
+                if (result == true) {
+                    _size += static_cast<uint32_t>(expected);
+                    _dirty = true;
+                } else {
+                    TRACE_L1("Could not append to journal %s [%d]", _fileName.c_str(), errno);
+                }
+            }
+
+            return (result);
+        }
+        // Flush whatever was appended since the last call to storage.
+        void Sync()
+        {
+            if ((_fd != -1) && (_dirty == true)) {
+#ifdef __WINDOWS__
+                ::_commit(_fd);
+#else
+                ::fdatasync(_fd);
+#endif
+                _dirty = false;
+            }
+        }
+        // Move the current journal aside (to be deleted once the file containing its changes is
+        // written) and start a fresh one.
+        bool Rotate(const string& oldFileName)
+        {
+            bool result = false;
+
+            if (_fd != -1) {
+                Close();
+
+#ifdef __WINDOWS__
+                // Unlike POSIX, rename does not replace an existing file here.
+                ::_unlink(oldFileName.c_str());
+#endif
+                result = (::rename(_fileName.c_str(), oldFileName.c_str()) == 0);
+
+                Open(_fileName);
+            }
+
+            return (result);
+        }
+
+        // Flush the content of a (closed) file to storage.
+        static bool SyncFile(const string& fileName)
+        {
+#ifdef __WINDOWS__
+            int fd = ::_open(fileName.c_str(), _O_WRONLY | _O_BINARY);
+            bool result = ((fd != -1) && (::_commit(fd) == 0));
+
+            if (fd != -1) {
+                ::_close(fd);
+            }
+#else
+            int fd = ::open(fileName.c_str(), O_RDONLY | O_CLOEXEC);
+            bool result = ((fd != -1) && (::fsync(fd) == 0));
+
+            if (fd != -1) {
+                ::close(fd);
+            }
+#endif
+            return (result);
+        }
+        // Flush a rename into the directory holding the file to storage.
+        static bool SyncDirectory(const string& fileName)
+        {
+#ifdef __WINDOWS__
+            // NTFS journals its metadata, a rename is durable once it returns.
+            DEBUG_VARIABLE(fileName);
+            return (true);
+#else
+            string::size_type slash = fileName.find_last_of('/');
+            const string directory(slash == string::npos ? string(_T(".")) : (slash == 0 ? string(_T("/")) : fileName.substr(0, slash)));
+            int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            bool result = ((fd != -1) && (::fsync(fd) == 0));
+
+            if (fd != -1) {
+                ::close(fd);
+            }
+            return (result);
+#endif
+        }
+
+        // Hands the records over one by one, returns the number of records replayed.
+        static uint32_t Replay(const string& fileName, IRecord& sink)
+        {
+            uint32_t count = 0;
+            Core::File file(fileName);
+
+            if ((file.Exists() == true) && (file.Open(true) == true)) {
+                const uint32_t length = static_cast<uint32_t>(file.Size());
+                uint8_t* buffer = new uint8_t[length];
+                uint32_t offset = 0;
+                bool valid = (file.Read(buffer, length) == length);
+
+                if (valid == true) {
+                    while (offset < length) {
+                        const uint32_t size = sink.Length(&buffer[offset], length - offset);
+
+                        if ((size == 0) || (size > (length - offset))) {
+                            TRACE_L1("Journal %s is truncated at offset %d", fileName.c_str(), offset);
+                            break;
+                        }
+
+                        sink.Replay(&buffer[offset], size);
+
+                        offset += size;
+                        count++;
+                    }
+                }
+
+                delete[] buffer;
+                file.Close();
+
+                if ((valid == true) && (offset < length) && (Truncate(fileName, offset) == false)) {
+                    TRACE_L1("Could not cut journal %s back to %d bytes [%d]", fileName.c_str(), offset, errno);
+                }
+            }
+
+            return (count);
+        }
+
+    private:
+        // Cut a torn tail off, and make that durable before anything is appended behind it.
+        static bool Truncate(const string& fileName, const uint32_t length)
+        {
+#ifdef __WINDOWS__
+            int fd = ::_open(fileName.c_str(), _O_WRONLY | _O_BINARY);
+            bool result = ((fd != -1) && (::_chsize_s(fd, length) == 0) && (::_commit(fd) == 0));
+
+            if (fd != -1) {
+                ::_close(fd);
+            }
+#else
+            int fd = ::open(fileName.c_str(), O_WRONLY | O_CLOEXEC);
+            bool result = ((fd != -1) && (::ftruncate(fd, length) == 0) && (::fsync(fd) == 0));
+
+            if (fd != -1) {
+                ::close(fd);
+            }
+#endif
+            return (result);
+        }
+
+    private:
+        string _fileName;
+        int _fd;
+        uint32_t _size;
+        bool _dirty;
+    };
+}
+}
+
+#endif // __JOURNALFILE_H__